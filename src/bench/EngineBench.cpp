@@ -0,0 +1,294 @@
+// arp_bench – mikrobenchmarki gorących ścieżek silnika (bez RtMidi, bez urządzeń).
+//
+// Zegar wirtualny + wyjście "do nikąd", więc mierzymy czysty koszt rdzenia:
+//  - PatternEngine::tick()        dla różnej liczby patternów i wielkości akordu,
+//  - PatternEngine::on_midi_in(),
+//  - ChordState::note_on/note_off,
+//  - flush NoteOff-ów przy pełnej kolejce (OffQueue::pop_due – to, co robi flush_due_offs_),
+//  - ArpEngine::tick() (kolejność "up" i pozostałe polityki NoteOrder),
+//  - otwarcie banku patternów w pamięci (BankView) + wczytanie slotu,
+//  - całe takty przez uprząż symulacji (sim/Harness.hpp) – ile taktów/s.
+// Wynik: JSON (ns/op, zdarzenia/s) – do porównywania wydań.
+//
+// Użycie: arp_bench [--quick] [--out plik.json]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "core/ArpEngine.hpp"
+#include "core/OffQueue.hpp"
+#include "core/PatternBank.hpp"
+#include "core/PatternEngine.hpp"
+#include "sim/Harness.hpp"
+#include "sim/VirtualClock.hpp"
+
+namespace {
+
+using bench_clock = std::chrono::steady_clock;
+
+// Wyjście, które tylko liczy komunikaty
+class NullOut final : public ports::IMidiOut {
+public:
+  void send(const ports::MidiMsg& m) override { ++count; sink ^= m.data1; }
+  uint64_t count{0};
+  uint64_t sink{0};
+};
+
+struct Result {
+  std::string name;
+  std::size_t patterns;
+  std::size_t chord;
+  uint64_t ops;
+  uint64_t events;
+  double ns_per_op;
+  double events_per_sec;
+};
+
+struct Timer {
+  bench_clock::time_point t0 = bench_clock::now();
+  double ns() const {
+    return std::chrono::duration<double, std::nano>(bench_clock::now() - t0).count();
+  }
+};
+
+// Bariera dla optymalizatora: obiekt "mógł się zmienić/zostać odczytany"
+template<class T>
+inline void clobber(T& obj) { asm volatile("" : : "g"(&obj) : "memory"); }
+
+Result make(const char* name, std::size_t patterns, std::size_t chord,
+            uint64_t ops, uint64_t events, double ns) {
+  return Result{name, patterns, chord, ops, events,
+                ops ? ns / static_cast<double>(ops) : 0.0,
+                ns > 0 ? static_cast<double>(events) * 1e9 / ns : 0.0};
+}
+
+// Pattern testowy: 16 kroków po kolejnych indeksach akordu, różne division
+void setup_patterns(core::PatternEngine& eng) {
+  for (std::size_t i = 0; i < eng.num_patterns(); ++i) {
+    auto& p = eng.pattern(i);
+    p.channel  = static_cast<uint8_t>(1 + i % 16);
+    p.division = static_cast<uint16_t>(1u << (i % 4));    // 1/4, 1/8, 1/16, 1/32
+    p.length   = 16;
+    for (std::size_t k = 0; k < p.length; ++k) {
+      auto& s = p.steps[k];
+      s.note_index = static_cast<uint8_t>(1 + (k + i) % core::MAX_HELD_NOTES);
+      s.gate_pct   = static_cast<uint8_t>(50 + (k % 4) * 40);   // 50..170%
+      s.octave     = static_cast<int8_t>(k % 3);
+    }
+  }
+}
+
+template<class Engine>
+void hold_chord(Engine& eng, std::size_t chord) {
+  for (std::size_t n = 0; n < chord; ++n)
+    eng.on_midi_in(ports::MidiMsg{0x90, static_cast<uint8_t>(48 + 3 * n), 100, 0});
+}
+
+// tick() w terminach z next_deadline_us() – tak jak pętla aplikacji
+template<class Engine>
+std::pair<uint64_t, double> drive(Engine& eng, VirtualClock& clock, uint64_t ticks) {
+  Timer t;
+  for (uint64_t k = 0; k < ticks; ++k) {
+    if (const auto dl = eng.next_deadline_us()) clock.set_us(*dl);
+    eng.tick();
+  }
+  return {ticks, t.ns()};
+}
+
+Result bench_pattern_tick(std::size_t patterns, std::size_t chord, uint64_t ticks) {
+  VirtualClock clock;
+  NullOut out;
+  core::PatternEngine eng(out, clock, patterns);
+  eng.set_engine_config(core::EngineConfig{});
+  setup_patterns(eng);
+  hold_chord(eng, chord);
+  drive(eng, clock, ticks / 10);                   // rozgrzewka (kolejka OFF-ów w stanie ustalonym)
+  const uint64_t ev0 = out.count;
+  const auto [ops, ns] = drive(eng, clock, ticks);
+  return make("pattern_tick", patterns, chord, ops, out.count - ev0, ns);
+}
+
+Result bench_pattern_midi_in(std::size_t patterns, std::size_t chord, uint64_t ops) {
+  VirtualClock clock;
+  NullOut out;
+  core::PatternEngine eng(out, clock, patterns);
+  eng.set_engine_config(core::EngineConfig{});
+  setup_patterns(eng);
+  hold_chord(eng, chord > 0 ? chord - 1 : 0);
+  drive(eng, clock, 100);                          // silnik w ruchu, zegar > 0
+  // zmiana akordu "na żywo": jedna nuta w górę i w dół, znacznik = teraz
+  const uint64_t ev0 = out.count;
+  Timer t;
+  for (uint64_t k = 0; k < ops; k += 2) {
+    const auto note = static_cast<uint8_t>(90 + (k >> 1) % 8);
+    eng.on_midi_in(ports::MidiMsg{0x90, note, 100, clock.now_us()});
+    eng.on_midi_in(ports::MidiMsg{0x80, note, 0,   clock.now_us()});
+  }
+  return make("pattern_on_midi_in", patterns, chord, ops, out.count - ev0, t.ns());
+}
+
+Result bench_chord_state(std::size_t chord, uint64_t ops) {
+  core::ChordState cs;
+  for (std::size_t n = 0; n + 1 < chord; ++n) cs.note_on(static_cast<uint8_t>(40 + 5 * n));
+  Timer t;
+  for (uint64_t k = 0; k < ops; k += 2) {
+    const auto note = static_cast<uint8_t>(38 + (k >> 1) % 48);
+    cs.note_on(note);
+    clobber(cs);
+    cs.note_off(note);
+    clobber(cs);
+  }
+  const double ns = t.ns();
+  return make("chord_note_on_off", 0, chord, ops, 0, ns);
+}
+
+// flush_due_offs_ = pop_due + send; kolejka pełna (rozmiar jak w silniku z N patternami)
+Result bench_flush_full(std::size_t patterns, uint64_t rounds) {
+  core::OffQueue q(std::max(core::MAX_PENDING_OFFS, patterns * core::OFFS_PER_PATTERN));
+  NullOut out;
+  uint64_t now = 0, ops = 0;
+  uint32_t x = 12345;
+  double ns = 0;
+  for (uint64_t r = 0; r < rounds; ++r) {
+    while (!q.full()) {                             // napełnianie poza pomiarem
+      x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+      q.push(now + 1 + x % 1'000'000, static_cast<uint8_t>(x & 0x0F), static_cast<uint8_t>(x >> 8 & 0x7F));
+    }
+    now += 1'000'000;
+    Timer t;
+    q.pop_due(now, [&](const core::OffQueue::Entry& e) {
+      out.send(ports::MidiMsg{static_cast<uint8_t>(0x80 | e.ch), e.note, 0, now});
+    });
+    ns += t.ns();
+    ops += q.capacity();
+  }
+  return make("flush_due_offs_full", patterns, 0, ops, out.count, ns);
+}
+
+// Bank o 'patterns' slotach w pamięci (jak po mmap): sprawdzenie nagłówka + kopia jednego slotu
+Result bench_bank_load(std::size_t patterns, uint64_t ops) {
+  std::vector<unsigned char> file(sizeof(core::BankHeader) + patterns * sizeof(core::BankRecord));
+  const auto hdr = core::make_bank_header(static_cast<uint32_t>(patterns));
+  std::memcpy(file.data(), &hdr, sizeof hdr);
+  core::PatternConfig cfg{};
+  cfg.length = core::MAX_STEPS;
+  for (std::size_t s = 0; s < patterns; ++s) {
+    cfg.seed = static_cast<uint32_t>(s);
+    const auto rec = core::to_bank_record(cfg);
+    std::memcpy(file.data() + sizeof hdr + s * sizeof rec, &rec, sizeof rec);
+  }
+  core::PatternConfig out{};
+  Timer t;
+  for (uint64_t k = 0; k < ops; ++k) {
+    const core::BankView v(file.data(), file.size());
+    v.load(k % patterns, out);
+    clobber(out);
+  }
+  return make("bank_open_load_slot", patterns, 0, ops, 0, t.ns());
+}
+
+template<class Order = core::order::Up>
+Result bench_arp_tick(std::size_t chord, uint64_t ticks, const char* name = "arp_tick") {
+  VirtualClock clock;
+  NullOut out;
+  core::BasicArpEngine<Order> eng(out, clock);
+  core::ArpConfig c;
+  c.division = 4;
+  c.gate_percent = 150;
+  eng.set_config(c);
+  hold_chord(eng, chord);
+  drive(eng, clock, ticks / 10);
+  const uint64_t ev0 = out.count;
+  const auto [ops, ns] = drive(eng, clock, ticks);
+  return make(name, 1, chord, ops, out.count - ev0, ns);
+}
+
+void write_json(std::FILE* f, const std::vector<Result>& rs, bool quick) {
+  std::fprintf(f, "{\n  \"benchmark\": \"arp_bench\",\n  \"schema\": 1,\n  \"quick\": %s,\n  \"results\": [\n",
+               quick ? "true" : "false");
+  for (std::size_t i = 0; i < rs.size(); ++i) {
+    const auto& r = rs[i];
+    std::fprintf(f, "    {\"name\": \"%s\", \"patterns\": %zu, \"chord\": %zu, \"ops\": %llu, "
+                    "\"events\": %llu, \"ns_per_op\": %.2f, \"events_per_sec\": %.0f}%s\n",
+                 r.name.c_str(), r.patterns, r.chord,
+                 static_cast<unsigned long long>(r.ops), static_cast<unsigned long long>(r.events),
+                 r.ns_per_op, r.events_per_sec, i + 1 < rs.size() ? "," : "");
+  }
+  std::fprintf(f, "  ]\n}\n");
+}
+
+} // namespace
+
+// Takt po takcie przez run_until, wyjście do wektora (tak jak render i porównania
+// ze złotym wyjściem); ops = takty
+Result bench_sim_bars(std::size_t patterns, std::size_t chord, uint64_t bars) {
+  VirtualClock clock;
+  VectorMidiOut out;
+  core::PatternEngine eng(out, clock, patterns);
+  const core::EngineConfig ec{};
+  eng.set_engine_config(ec);
+  setup_patterns(eng);
+  hold_chord(eng, chord);
+  const auto bar_us = static_cast<uint64_t>(60e6 / ec.bpm * core::BEATS_PER_BAR);
+  uint64_t events = 0;
+  Timer t;
+  for (uint64_t b = 1; b <= bars; ++b) {
+    run_until(eng, clock, b * bar_us);
+    events += out.msgs.size();
+    out.clear();
+  }
+  return make("sim_bar", patterns, chord, bars, events, t.ns());
+}
+
+int main(int argc, char** argv) {
+  bool quick = false;
+  const char* out_path = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    if (!std::strcmp(argv[i], "--quick")) quick = true;
+    else if (!std::strcmp(argv[i], "--out") && i + 1 < argc) out_path = argv[++i];
+    else {
+      std::fprintf(stderr, "Usage: arp_bench [--quick] [--out file.json]\n");
+      return 1;
+    }
+  }
+  const uint64_t scale = quick ? 1 : 10;
+
+  std::vector<Result> rs;
+  const std::size_t pattern_counts[] = {1, 4, 16, 64, 256, 1024};
+  const std::size_t chord_sizes[]    = {1, 4, 8};
+
+  for (auto p : pattern_counts)
+    for (auto c : chord_sizes)
+      rs.push_back(bench_pattern_tick(p, c, 20'000 * scale));
+  for (auto p : {std::size_t{4}, std::size_t{256}})
+    for (auto c : chord_sizes)
+      rs.push_back(bench_pattern_midi_in(p, c, 100'000 * scale));
+  for (auto c : chord_sizes)
+    rs.push_back(bench_chord_state(c, 1'000'000 * scale));
+  for (auto p : pattern_counts)
+    rs.push_back(bench_flush_full(p, 200 * scale));
+  for (auto c : chord_sizes)
+    rs.push_back(bench_arp_tick(c, 50'000 * scale));
+  for (const char* o : {"down", "updown", "played", "random", "converge", "diverge", "chord"}) {
+    const std::string name = std::string("arp_tick_") + o;
+    core::order::with_order(o, [&](auto tag) {
+      rs.push_back(bench_arp_tick<decltype(tag)>(8, 50'000 * scale, name.c_str()));
+    });
+  }
+  for (auto p : {std::size_t{16}, std::size_t{1000}})
+    rs.push_back(bench_bank_load(p, 100'000 * scale));
+  for (auto p : {std::size_t{4}, std::size_t{64}})
+    rs.push_back(bench_sim_bars(p, 4, 2'000 * scale));
+
+  write_json(stdout, rs, quick);
+  if (out_path) {
+    std::FILE* f = std::fopen(out_path, "w");
+    if (!f) { std::fprintf(stderr, "cannot write %s\n", out_path); return 1; }
+    write_json(f, rs, quick);
+    std::fclose(f);
+  }
+  return 0;
+}
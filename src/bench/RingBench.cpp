@@ -0,0 +1,123 @@
+// ring_bench – mikrobenchmark kolejek wejścia (MIDI IN / CLI → pętla silnika).
+//
+// Porównuje core::SpscRing z dawnym podejściem (mutex + std::queue):
+//  1) koszt push+pop w jednym wątku (ns/op),
+//  2) opóźnienie push→pop między wątkami pod obciążeniem (p50/p99/p99.9/max).
+//
+// Użycie: ring_bench [liczba_komunikatów]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "core/SpscRing.hpp"
+#include "ports/Midi.hpp"
+
+namespace {
+
+using bench_clock = std::chrono::steady_clock;
+
+uint64_t now_ns() {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+           bench_clock::now().time_since_epoch()).count());
+}
+
+// Punkt odniesienia: kolejka z muteksem, jak dawny TsQueue
+class MutexQueue {
+public:
+  bool try_push(const ports::MidiMsg& m) {
+    std::lock_guard<std::mutex> lk(m_);
+    q_.push(m);
+    return true;
+  }
+  std::optional<ports::MidiMsg> try_pop() {
+    std::lock_guard<std::mutex> lk(m_);
+    if (q_.empty()) return std::nullopt;
+    auto v = q_.front();
+    q_.pop();
+    return v;
+  }
+private:
+  std::mutex m_;
+  std::queue<ports::MidiMsg> q_;
+};
+
+using Ring = core::SpscRing<ports::MidiMsg, 1024>;
+
+template<class Q>
+double single_thread_ns(Q& q, std::size_t n) {
+  ports::MidiMsg m{0x90, 60, 100, 0};
+  uint64_t sink = 0;
+  const uint64_t t0 = now_ns();
+  for (std::size_t i = 0; i < n; ++i) {
+    m.t_us = i;
+    q.try_push(m);
+    if (auto v = q.try_pop()) sink += v->t_us;
+  }
+  const uint64_t t1 = now_ns();
+  if (sink == 42) std::puts("");           // nie pozwól wyciąć pętli
+  return static_cast<double>(t1 - t0) / static_cast<double>(n);
+}
+
+struct LatencyReport { double p50, p99, p999, max, mops; uint64_t dropped; };
+
+// Producent wkłada znacznik czasu (ns) w t_us, konsument mierzy czas do odbioru.
+template<class Q>
+LatencyReport cross_thread(Q& q, std::size_t n) {
+  std::vector<uint64_t> lat;
+  lat.reserve(n);
+  uint64_t dropped = 0;
+
+  const uint64_t t0 = now_ns();
+  std::thread producer([&]{
+    ports::MidiMsg m{0x90, 60, 100, 0};
+    for (std::size_t i = 0; i < n; ++i) {
+      m.t_us = now_ns();
+      while (!q.try_push(m)) { ++dropped; std::this_thread::yield(); }
+    }
+  });
+  std::size_t got = 0;
+  while (got < n) {
+    if (auto v = q.try_pop()) { lat.push_back(now_ns() - v->t_us); ++got; }
+    else std::this_thread::yield();
+  }
+  producer.join();
+  const uint64_t t1 = now_ns();
+
+  std::sort(lat.begin(), lat.end());
+  auto pct = [&](double p){ return static_cast<double>(lat[static_cast<std::size_t>(p * (lat.size() - 1))]); };
+  return LatencyReport{ pct(0.50), pct(0.99), pct(0.999), static_cast<double>(lat.back()),
+                        static_cast<double>(n) * 1e3 / static_cast<double>(t1 - t0), dropped };
+}
+
+void print(const char* name, double st_ns, const LatencyReport& r) {
+  std::printf("%-12s push+pop %7.1f ns/op | cross-thread %6.2f Mmsg/s  "
+              "lat p50 %8.0f ns  p99 %8.0f ns  p99.9 %9.0f ns  max %10.0f ns  full-retries %llu\n",
+              name, st_ns, r.mops, r.p50, r.p99, r.p999, r.max,
+              static_cast<unsigned long long>(r.dropped));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const std::size_t n = (argc > 1) ? std::strtoull(argv[1], nullptr, 10) : 1'000'000;
+
+  auto ring = std::make_unique<Ring>();
+  MutexQueue mq;
+
+  const double ring_st = single_thread_ns(*ring, n);
+  const double mq_st   = single_thread_ns(mq, n);
+  const auto ring_x = cross_thread(*ring, n);
+  const auto mq_x   = cross_thread(mq, n);
+
+  std::printf("ring_bench: %zu messages, %u hw threads\n", n, std::thread::hardware_concurrency());
+  print("SpscRing", ring_st, ring_x);
+  print("mutex+queue", mq_st, mq_x);
+  return 0;
+}
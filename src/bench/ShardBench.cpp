@@ -0,0 +1,138 @@
+// shard_bench – skalowanie ShardHost z liczbą wątków (rdzeni).
+//
+// Stała pula instancji PatternEngine (każda: własne wyjście "do nikąd",
+// akord, 16 patternów) rozkładana na 1, 2, 4, ... wątków w trybie free_run:
+// każdy shard liczy ten sam odcinek czasu wirtualnego tak szybko, jak umie.
+// Mierzymy czas ściany i łączną liczbę komunikatów => zdarzenia/s, przyspieszenie
+// względem 1 wątku i efektywność (przyspieszenie / wątki).
+//
+// Użycie: shard_bench [--instances N] [--seconds S] [--max-workers W] [--pin] [--out plik.json]
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "desktop/ShardHost.hpp"
+
+namespace {
+
+class NullOut final : public ports::IMidiOut {
+public:
+  void send(const ports::MidiMsg& m) override { sink ^= m.data1; }
+  uint64_t sink{0};
+};
+
+struct Result {
+  std::size_t workers;
+  uint64_t events;
+  double wall_s;
+  double events_per_sec;
+  double speedup;
+  double efficiency;
+  double max_utilization_skew;   // max/min obciążenia shardów (1.0 = równo)
+};
+
+void setup(core::PatternEngine& eng, std::size_t salt) {
+  for (std::size_t i = 0; i < eng.num_patterns(); ++i) {
+    auto& p = eng.pattern(i);
+    p.channel  = static_cast<uint8_t>(1 + i % 16);
+    p.division = static_cast<uint16_t>(1u << ((i + salt) % 4));
+    p.length   = 16;
+    for (std::size_t k = 0; k < p.length; ++k) {
+      p.steps[k].note_index = static_cast<uint8_t>(1 + (k + i) % 4);
+      p.steps[k].gate_pct   = static_cast<uint8_t>(50 + (k % 4) * 40);
+    }
+  }
+  for (uint8_t n : {48, 52, 55, 59}) eng.on_midi_in(ports::MidiMsg{0x90, n, 100, 0});
+}
+
+Result run(std::size_t workers, std::size_t instances, uint64_t virtual_us, bool pin) {
+  struct NoClock final : ports::IClock { uint64_t now_us() const override { return 0; } } unused;
+  desktop_midi::ShardHost::Config cfg;
+  cfg.workers     = workers;
+  cfg.first_cpu   = pin ? 0 : -1;
+  cfg.free_run    = true;
+  cfg.free_run_us = virtual_us;
+  desktop_midi::ShardHost host(unused, cfg);
+
+  std::vector<std::unique_ptr<NullOut>> outs;
+  for (std::size_t i = 0; i < instances; ++i) {
+    outs.push_back(std::make_unique<NullOut>());
+    const auto id = host.add(nullptr, *outs.back(), 16);
+    setup(host.engine(id), i);
+  }
+
+  const auto t0 = std::chrono::steady_clock::now();
+  host.start();
+  host.wait();
+  const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+  uint64_t events = 0;
+  double umin = 1e9, umax = 0;
+  for (std::size_t w = 0; w < host.workers(); ++w) {
+    const auto l = host.load(w);
+    events += l.midi_out;
+    umin = std::min(umin, static_cast<double>(l.midi_out));
+    umax = std::max(umax, static_cast<double>(l.midi_out));
+  }
+  return Result{workers, events, wall, wall > 0 ? static_cast<double>(events) / wall : 0.0, 0, 0,
+                umin > 0 ? umax / umin : 0.0};
+}
+
+void write_json(std::FILE* f, const std::vector<Result>& rs, std::size_t instances, unsigned hw) {
+  std::fprintf(f, "{\n  \"benchmark\": \"shard_bench\",\n  \"schema\": 1,\n  \"instances\": %zu,\n"
+                  "  \"hardware_threads\": %u,\n  \"results\": [\n", instances, hw);
+  for (std::size_t i = 0; i < rs.size(); ++i) {
+    const auto& r = rs[i];
+    std::fprintf(f, "    {\"workers\": %zu, \"events\": %llu, \"wall_s\": %.4f, \"events_per_sec\": %.0f, "
+                    "\"speedup\": %.2f, \"efficiency\": %.2f, \"shard_event_skew\": %.2f}%s\n",
+                 r.workers, static_cast<unsigned long long>(r.events), r.wall_s, r.events_per_sec,
+                 r.speedup, r.efficiency, r.max_utilization_skew, i + 1 < rs.size() ? "," : "");
+  }
+  std::fprintf(f, "  ]\n}\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+  std::size_t instances = 0, max_workers = hw;
+  double seconds = 3600.0;   // godzina materiału na instancję
+  bool pin = false;
+  const char* out_path = nullptr;
+  for (int i = 1; i < argc; ++i) {
+    const bool more = i + 1 < argc;
+    if      (!std::strcmp(argv[i], "--instances") && more)   instances = std::strtoul(argv[++i], nullptr, 10);
+    else if (!std::strcmp(argv[i], "--seconds") && more)     seconds = std::atof(argv[++i]);
+    else if (!std::strcmp(argv[i], "--max-workers") && more) max_workers = std::max<std::size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+    else if (!std::strcmp(argv[i], "--pin"))                 pin = true;
+    else if (!std::strcmp(argv[i], "--out") && more)         out_path = argv[++i];
+    else {
+      std::fprintf(stderr, "Usage: shard_bench [--instances N] [--seconds S] [--max-workers W] [--pin] [--out file.json]\n");
+      return 1;
+    }
+  }
+  if (instances == 0) instances = 4 * max_workers;      // kilka instancji na shard – równy podział
+  const auto virtual_us = static_cast<uint64_t>(seconds * 1e6);
+
+  std::vector<Result> rs;
+  for (std::size_t w = 1; w <= max_workers; w *= 2) rs.push_back(run(w, instances, virtual_us, pin));
+  if (rs.back().workers != max_workers) rs.push_back(run(max_workers, instances, virtual_us, pin));
+  for (auto& r : rs) {
+    r.speedup    = rs.front().events_per_sec > 0 ? r.events_per_sec / rs.front().events_per_sec : 0.0;
+    r.efficiency = r.speedup / static_cast<double>(r.workers);
+  }
+
+  write_json(stdout, rs, instances, hw);
+  if (out_path) {
+    std::FILE* f = std::fopen(out_path, "w");
+    if (!f) { std::fprintf(stderr, "cannot write %s\n", out_path); return 1; }
+    write_json(f, rs, instances, hw);
+    std::fclose(f);
+  }
+  return 0;
+}
@@ -4,6 +4,12 @@
 #include <optional>
 #include "ports/Midi.hpp"
 #include "ports/Clock.hpp"
+#include "core/ChordState.hpp"
+#include "core/NoteOrder.hpp"
+#include "core/Rng.hpp"
+#include "core/StepVoice.hpp"
+#include "core/Transport.hpp"
+#include "core/OffQueue.hpp"
 
 namespace core {
 
@@ -15,6 +21,7 @@ struct ArpConfig {
   double  bpm = 120.0;          // tempo (uderzenia na minutę)
   int     division = 2;         // ile kroków na ćwierćnutę: 1=1/4, 2=1/8, 4=1/16
   uint8_t channel = 1;          // kanał MIDI (1..16)
+  uint8_t velocity = 100;       // stała velocity nut (1..127); 0 => velocity, z jaką zagrano nutę akordu
 
   // Legato / ciągłość:
   int     gate_percent = 100;   // ile % długości kroku trzymać nutę (100 => tyle co krok)
@@ -24,80 +31,114 @@ struct ArpConfig {
   int     octave_min = 0;       // od której oktawy startować (0 = bazowa)
   int     octave_max = 2;       // do której oktawy iść (2 => +24 półtonów)
   int     octave_step_every = 2; // co ile kroków zwiększyć oktawę o +12 (2 = co dwa kroki)
+
+  std::size_t max_held = MAX_HELD_NOTES; // ile nut akordu naraz (1..128)
+  uint32_t    seed = 1;                  // ziarno dla order::Random
 };
 
 /**
- * ArpEngine — minimalny, deterministyczny arpeggiator:
- * - limit 8 nut,
+ * BasicArpEngine<Order> — minimalny, deterministyczny arpeggiator:
+ * - akord w masce 128 nut (limit konfigurowalny, domyślnie 8),
+ * - kolejność nut = polityka Order (core/NoteOrder.hpp), wybrana w czasie
+ *   kompilacji – wybór nuty wkleja się w krok, bez wywołań wirtualnych,
  * - krokowy harmonogram,
- * - planowanie NoteOff tak, by NIGDY nie było „dziur”.
+ * - planowanie NoteOff tak, by NIGDY nie było „dziur” (StepVoice.hpp –
+ *   ta sama ścieżka co w PatternEngine).
+ *
+ * ArpEngine = "up" (dotychczasowe zachowanie).
  */
-class ArpEngine {
+template<class Order = order::Up>
+class BasicArpEngine {
 public:
-  ArpEngine(ports::IMidiOut& out, const ports::IClock& clock)
-    : out_(out), clock_(clock) { recalc_timing_(); }
+  using order_type = Order;
+
+  BasicArpEngine(ports::IMidiOut& out, const ports::IClock& clock)
+    : out_(out), clock_(clock) { rng_.seed(cfg_.seed, 0); recalc_timing_(); }
 
-  void set_config(const ArpConfig& c) { cfg_ = c; recalc_timing_(); }
+  void set_config(const ArpConfig& c) {
+    if (c.seed != cfg_.seed) rng_.seed(c.seed, 0);
+    cfg_ = c;
+    held_.set_capacity(c.max_held);
+    recalc_timing_();
+  }
 
   // Wejście MIDI z klawiatury: NoteOn/NoteOff
+  // (kroki zaplanowane przed chwilą przyjścia komunikatu grają jeszcze ze starym akordem)
   void on_midi_in(const ports::MidiMsg& m) {
+    if (m.t_us) advance_(m.t_us);
+
     const uint8_t status = (m.status & 0xF0);
     const uint8_t note   = m.data1;
     const uint8_t vel    = m.data2;
 
     if (status == 0x90 && vel > 0) {
-      add_note_(note);
+      add_note_(note, vel);
     } else if (status == 0x80 || (status == 0x90 && vel == 0)) {
       remove_note_(note);
     }
   }
 
-  // Wywołuj co ~1 ms (pętla główna)
-  void tick() {
-    const uint64_t now = clock_.now_ms();
+  // Najbliższy termin pracy: najwcześniejszy OFF albo następny krok
+  // (przed pierwszym tick() => 0, czyli "od razu")
+  std::optional<uint64_t> next_deadline_us() const {
+    uint64_t dl = next_step_us_ ? *next_step_us_ : 0;
+    if (const auto t = offs_.next_time(); t && *t < dl) dl = *t;
+    return dl;
+  }
+
+  // Wywołuj w terminie z next_deadline_us() (albo po prostu co ~1 ms)
+  void tick() { advance_(clock_.now_us()); }
+
+private:
+  static constexpr std::size_t VOICES = Order::MAX_VOICES;
 
+  // Wykonaj całą pracę zaplanowaną do chwili 'now' włącznie
+  void advance_(uint64_t now) {
     // 1) Wyślij wszystkie NoteOff, na które przyszła pora
     flush_offs_(now);
 
-    // 2) Jeśli to pierwsze uruchomienie, ustaw start czasu kroku
-    if (!next_step_ms_) next_step_ms_ = now;
+    // 2) Jeśli to pierwsze uruchomienie, zakotwicz harmonogram w bieżącej pozycji
+    if (!next_step_us_) {
+      beat0_      = transport_.beat_at(now);
+      step_count_ = 0;
+      next_step_us_ = now;
+    }
 
     // 3) Jeżeli przyszedł moment kroku — zrób krok
-    while (next_step_ms_ && now >= *next_step_ms_) {
-      do_step_(*next_step_ms_);
-      *next_step_ms_ += step_ms_;  // nast. krok za step_ms_
+    while (next_step_us_ && now >= *next_step_us_) {
+      do_step_(*next_step_us_);
+      // czas kolejnego kroku liczony z jego pozycji (bez kumulacji zaokrągleń)
+      ++step_count_;
+      next_step_us_ = transport_.time_at(step_beat_(step_count_));
     }
   }
 
-private:
   // ──────────────────────────────────────────────────────────────────────────
   // Dane „muzyczne”
 
-  std::array<uint8_t, 8> held_{};   // trzymane nuty (posortowane rosnąco)
-  std::size_t held_size_{0};        // realna liczba trzymanych
-  std::size_t note_cursor_{0};      // indeks po „held_” (arp "up")
+  ChordState  held_{};              // trzymane nuty (maska, rosnąco)
+  std::size_t note_cursor_{0};      // pozycja w cyklu polityki Order (k)
   uint64_t    step_index_{0};       // licznik kroków (do swing/oktaw itd.)
+  Pcg32       rng_{};               // dla order::Random
 
   // ──────────────────────────────────────────────────────────────────────────
   // Harmonogram i czas
 
-  uint64_t step_ms_{250};                 // czas jednego kroku (ms)
-  std::optional<uint64_t> next_step_ms_{};// kiedy zagrać kolejny krok (ms)
-  uint64_t gate_ms_{250};                 // ile ms trzymać nutę (min. długość)
-  
-  struct PendingOff {
-    uint64_t t_ms;
-    uint8_t  ch;
-    uint8_t  note;
-  };
-  // Stały bufor „offów”, żeby nie alokować (16 zaplanowanych OFF w zupełności starczy)
-  std::array<PendingOff, 16> off_buf_{};
-  std::size_t off_count_{0};
-
-  // Ostatnia aktywna nuta (żeby zaplanować OFF z tie)
-  bool    last_on_valid_{false};
-  uint8_t last_on_ch_{0};
-  uint8_t last_on_note_{0};
+  Transport transport_{};                 // oś czasu muzycznego (tempo)
+  double   step_beats_{0.5};              // długość kroku w ćwierćnutach
+  double   gate_beats_{0.5};              // ile trzymać nutę (min. długość) w ćwierćnutach
+  double   beat0_{0.0};                   // pozycja kroku nr 0
+  uint64_t step_count_{0};                // numer następnego kroku od beat0_
+  std::optional<uint64_t> next_step_us_{};// kiedy zagrać kolejny krok (µs)
+
+  // Stała kolejka „offów” (kopiec wg czasu), żeby nie alokować.
+  // Przy gate <= 200% i overlap wisi naraz kilka OFF-ów na głos – 32 na głos to spory zapas.
+  OffQueue offs_{32 * (VOICES < 16 ? VOICES : 16)};
+
+  // Ostatnio włączone nuty (żeby zaplanować OFF z tie) – jedna na głos
+  struct Voice { uint8_t ch; uint8_t note; OffHandle off; };
+  std::array<Voice, VOICES> last_{};
+  std::size_t last_n_{0};                 // ile z nich wciąż gra
 
   // Zależności
   ports::IMidiOut&     out_;
@@ -105,49 +146,42 @@ private:
   ArpConfig            cfg_{};
 
   // ──────────────────────────────────────────────────────────────────────────
-  // Krok muzyczny: wybór nuty, obliczenie oktawy i planowanie ON/OFF
+  // Krok muzyczny: wybór nut (Order), obliczenie oktawy i planowanie ON/OFF
 
-  void do_step_(uint64_t t0_ms) {
-    if (held_size_ == 0) { step_index_++; return; }
+  void do_step_(uint64_t t0_us) {
+    const std::size_t held = held_.size();
+    if (held == 0) { step_index_++; return; }
 
-    // 1) Wybór bazowej nuty: jeśli jest akord → idziemy "up", jeśli jedna nuta → też bierzemy ją
-    const uint8_t base = held_[note_cursor_ % held_size_];
-    note_cursor_ = (note_cursor_ + 1) % (held_size_ > 0 ? held_size_ : 1);
+    // 1) Wybór nut bazowych wg polityki; kursor obiega jej cykl
+    std::array<uint8_t, VOICES> base;
+    const std::size_t n = Order::pick(held_, note_cursor_, rng_, base.data());
+    note_cursor_ = (note_cursor_ + 1) % Order::period(held);
 
     // 2) Wspinaczka oktawowa (żeby single-note nie był tremolo)
-    const int span = (cfg_.octave_max >= cfg_.octave_min) 
+    const int span = (cfg_.octave_max >= cfg_.octave_min)
                    ? (cfg_.octave_max - cfg_.octave_min + 1) : 1;
     const int every = (cfg_.octave_step_every > 0) ? cfg_.octave_step_every : 1;
     const int climb = static_cast<int>(step_index_ / every) % span;
     const int octave = cfg_.octave_min + climb;
 
-    int note_i = static_cast<int>(base) + 12 * octave;
-    if (note_i < 0)   note_i = 0;
-    if (note_i > 127) note_i = 127;
-    const uint8_t note = static_cast<uint8_t>(note_i);
-
-    // 3) Kanał/velocity + czasy ON/OFF tak, by NIE było dziur
-    const uint8_t ch   = static_cast<uint8_t>((cfg_.channel - 1) & 0x0F);
-    const uint64_t on_at  = t0_ms;
-    // minimalny gate: tyle co krok (gate_ms_) lub dłużej
-    const uint64_t min_off = t0_ms + gate_ms_;
-    // dodatkowa nakładka (tie) — nowa nuta pojawia się, a stara gaśnie dopiero po overlap_ms
-    const uint64_t off_at  = min_off + static_cast<uint64_t>( (cfg_.overlap_ms > 0) ? cfg_.overlap_ms : 0 );
-
-    // 4) Legato z poprzednią nutą: jeśli gra coś aktualnie, przesuń jej OFF co najmniej na "teraz + overlap"
-    if (last_on_valid_) {
-      // Spróbuj wydłużyć ostatni OFF w buforze (jeśli dotyczy tej samej nuty)
-      extend_off_for_last_on_(on_at + static_cast<uint64_t>( (cfg_.overlap_ms > 0) ? cfg_.overlap_ms : 0 ));
+    // 3) Kanał + czasy ON/OFF tak, by NIE było dziur
+    //    (minimalny gate liczony z pozycji kroku, do tego nakładka overlap_ms)
+    const uint8_t ch = static_cast<uint8_t>((cfg_.channel - 1) & 0x0F);
+    const uint64_t gate_end   = transport_.time_at(step_beat_(step_count_) + gate_beats_);
+    const uint64_t overlap_us = static_cast<uint64_t>((cfg_.overlap_ms > 0) ? cfg_.overlap_ms : 0) * 1000;
+    const NoteSpan span_us    = legato_span(t0_us, gate_end, overlap_us);
+
+    // 4) Legato z poprzednimi nutami: jeśli coś gra, przesuń ich OFF co najmniej na "teraz + overlap"
+    //    (uchwyt wskazuje dokładnie ten OFF; jeśli już poszedł — nic się nie dzieje)
+    for (std::size_t v = 0; v < last_n_; ++v) offs_.extend(last_[v].off, span_us.prev_off_at);
+
+    // 5) Wyślij ON i zaplanuj OFF dla bieżących nut; zapamiętaj, co teraz gra
+    for (std::size_t v = 0; v < n; ++v) {
+      const uint8_t note = transpose(base[v], octave);
+      send_on_(ch, note, cfg_.velocity ? cfg_.velocity : held_.velocity(base[v]), span_us.on_at);
+      last_[v] = Voice{ch, note, schedule_off_(span_us.off_at, ch, note, t0_us)};
     }
-
-    // 5) Wyślij ON i zaplanuj OFF dla bieżącej nuty
-    send_on_(ch, note, /*vel*/100, on_at);
-    schedule_off_(off_at, ch, note);
-
-    // 6) Zapamiętaj, co teraz gra
-    last_on_valid_ = true;
-    last_on_ch_    = ch;
-    last_on_note_  = note;
+    last_n_ = n;
 
     step_index_++;
   }
@@ -155,40 +189,14 @@ private:
   // ──────────────────────────────────────────────────────────────────────────
   // Obsługa OFF-ów bez alokacji
 
-  void schedule_off_(uint64_t t, uint8_t ch, uint8_t note) {
-    if (off_count_ < off_buf_.size()) {
-      off_buf_[off_count_++] = PendingOff{t, ch, note};
-    } else {
-      // bufor pełny — w prototypie po prostu wyślij od razu (bezpiecznik)
-      send_off_(ch, note, t);
-    }
-  }
-
-  void extend_off_for_last_on_(uint64_t new_time) {
-    // Szukamy ostatniego wpisu OFF odpowiadającego last_on_note_/ch
-    for (std::size_t i = off_count_; i > 0; --i) {
-      auto& p = off_buf_[i-1];
-      if (p.ch == last_on_ch_ && p.note == last_on_note_) {
-        if (p.t_ms < new_time) p.t_ms = new_time;
-        return;
-      }
-    }
-    // Jeśli nie znaleźliśmy (np. nie było jeszcze OFF zaplanowanego) — nic nie robimy; schedule_off_ zrobi swoje.
+  OffHandle schedule_off_(uint64_t t, uint8_t ch, uint8_t note, uint64_t now) {
+    return schedule_off(offs_, t, ch, note, 0, [&](const OffQueue::Entry& e) { send_off_(e.ch, e.note, now); });
   }
 
   void flush_offs_(uint64_t now) {
-    // wysyłamy wszystkie OFF z terminem <= now
-    std::size_t w = 0;
-    for (std::size_t r = 0; r < off_count_; ++r) {
-      const auto& p = off_buf_[r];
-      if (p.t_ms <= now) {
-        send_off_(p.ch, p.note, now);
-      } else {
-        off_buf_[w++] = p;
-      }
-    }
-    off_count_ = w;
-    if (off_count_ == 0) last_on_valid_ = false; // nic już nie gra
+    // wysyłamy wszystkie OFF z terminem <= now (znacznik = termin z kolejki)
+    offs_.pop_due(now, [&](const auto& p){ send_off_(p.ch, p.note, p.at_us); });
+    if (offs_.empty()) last_n_ = 0;        // nic już nie gra
   }
 
   // ──────────────────────────────────────────────────────────────────────────
@@ -204,54 +212,48 @@ private:
   }
 
   // ──────────────────────────────────────────────────────────────────────────
-  // Held-notes: stały bufor 8 elementów, posortowany rosnąco (dla „up”)
-
-  void add_note_(uint8_t n) {
-    // duplikatu nie dodajemy
-    for (std::size_t i = 0; i < held_size_; ++i) if (held_[i] == n) return;
-
-    if (held_size_ < held_.size()) {
-      // wstaw w porządku rosnącym
-      std::size_t pos = 0;
-      while (pos < held_size_ && held_[pos] < n) ++pos;
-      for (std::size_t j = held_size_; j > pos; --j) held_[j] = held_[j-1];
-      held_[pos] = n;
-      ++held_size_;
-      if (note_cursor_ >= held_size_) note_cursor_ = 0;
-    }
-    // jeśli pełne — ignorujemy (limit 8)
+  // Held-notes: maska 128 nut (ChordState) – wstawianie/usuwanie w O(1)
+
+  void add_note_(uint8_t n, uint8_t vel) {
+    held_.note_on(n, vel);                 // duplikat / pełny akord => bez zmian
+    if (note_cursor_ >= Order::period(held_.size())) note_cursor_ = 0;
   }
 
   void remove_note_(uint8_t n) {
-    for (std::size_t i = 0; i < held_size_; ++i) {
-      if (held_[i] == n) {
-        for (std::size_t j = i + 1; j < held_size_; ++j) held_[j-1] = held_[j];
-        --held_size_;
-        if (note_cursor_ >= held_size_) note_cursor_ = 0;
-        break;
-      }
-    }
-    // Jeśli puściliśmy wszystko — natychmiastowy OFF ostatniej nuty
-    if (held_size_ == 0 && last_on_valid_) {
-      const uint64_t now = clock_.now_ms();
-      schedule_off_(now, last_on_ch_, last_on_note_);
-      last_on_valid_ = false;
+    held_.note_off(n);
+    if (held_.empty() || note_cursor_ >= Order::period(held_.size())) note_cursor_ = 0;
+    // Jeśli puściliśmy wszystko — natychmiastowy OFF ostatnich nut
+    if (held_.empty() && last_n_ > 0) {
+      const uint64_t now = clock_.now_us();
+      for (std::size_t v = 0; v < last_n_; ++v) schedule_off_(now, last_[v].ch, last_[v].note, now);
+      last_n_ = 0;
     }
   }
 
   // ──────────────────────────────────────────────────────────────────────────
   // Przeliczenia czasu
 
+  double step_beat_(uint64_t k) const {
+    return beat0_ + static_cast<double>(k) * step_beats_;
+  }
+
   void recalc_timing_() {
-    const double q_ms = 60000.0 / (cfg_.bpm > 0 ? cfg_.bpm : 120.0);           // ćwierćnuta
-    step_ms_ = static_cast<uint64_t>( q_ms / (cfg_.division > 0 ? cfg_.division : 2) ); // długość kroku
-    if (step_ms_ == 0) step_ms_ = 1;
+    // Zaplanowany krok zostaje na swojej pozycji – od niego liczymy nową siatkę
+    if (next_step_us_) {
+      beat0_      = step_beat_(step_count_);
+      step_count_ = 0;
+    }
+    transport_.set_bpm(cfg_.bpm, clock_.now_us());                            // tempo
+    step_beats_ = 1.0 / (cfg_.division > 0 ? cfg_.division : 2);              // długość kroku
 
-    // Gate liczony od kroku; NoteOff i tak jest „co najmniej” gate_ms + overlap
+    // Gate liczony od kroku; NoteOff i tak jest „co najmniej” gate + overlap
     const int gp = (cfg_.gate_percent < 1 ? 1 : (cfg_.gate_percent > 200 ? 200 : cfg_.gate_percent));
-    gate_ms_ = static_cast<uint64_t>( step_ms_ * gp / 100 );
-    if (gate_ms_ < 1) gate_ms_ = 1;
+    gate_beats_ = step_beats_ * gp / 100.0;
+
+    if (next_step_us_) next_step_us_ = transport_.time_at(step_beat_(step_count_));
   }
 };
 
+using ArpEngine = BasicArpEngine<order::Up>;
+
 } // namespace core
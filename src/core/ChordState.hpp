@@ -0,0 +1,130 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <optional>
+
+namespace core {
+
+// Domyślna pojemność akordu (ile nut naraz bierzemy pod uwagę)
+constexpr std::size_t MAX_HELD_NOTES  = 8;
+// Górna granica: cała klawiatura MIDI (np. plama na pedale sustain)
+constexpr std::size_t MAX_CHORD_NOTES = 128;
+
+/*
+ * ==========================
+ * STAN AKORDU (HELD) – maska
+ * ==========================
+ *
+ * Trzymane nuty to 128-bitowa maska (dwa słowa 64-bit): bit n = nuta n.
+ * Porządek rosnący mamy za darmo – to kolejność bitów, więc:
+ *  - note_on / note_off: ustaw / skasuj bit – O(1), bez przesuwania tablicy,
+ *  - size(): popcount obu słów,
+ *  - by_index(k): "select" – k-ty ustawiony bit (popcount pierwszego słowa
+ *    wybiera słowo, dalej połowienie po popcountach 32/16/8 bitów).
+ *
+ * Pojemność (capacity) jest konfigurowalna 1..128: nuty ponad limit są
+ * ignorowane, tak jak wcześniej 9. nuta przy limicie 8. Zmniejszenie limitu
+ * nie wyrzuca już trzymanych nut – blokuje tylko nowe.
+ *
+ * Obok maski trzymamy per nuta velocity wejściowe i numer kolejny przyjścia
+ * (stałe tablice po 128 – zapis przy note_on, bez szukania). Stąd "najnowsza
+ * nuta" i porządek "as played" bez osobnej listy.
+ */
+class ChordState {
+public:
+  explicit ChordState(std::size_t capacity = MAX_HELD_NOTES) { set_capacity(capacity); }
+
+  void set_capacity(std::size_t c) {
+    capacity_ = c < 1 ? 1 : (c > MAX_CHORD_NOTES ? MAX_CHORD_NOTES : c);
+  }
+  std::size_t capacity() const { return capacity_; }
+
+  // NoteOn – ustaw bit (duplikat / pełny akord => nic)
+  void note_on(uint8_t note, uint8_t vel = 100) {
+    note &= 0x7F;
+    if (contains(note) || size() >= capacity_) return;
+    word_(note) |= bit_(note);
+    vel_[note]   = vel;
+    order_[note] = ++seq_;
+  }
+
+  // NoteOff – skasuj bit
+  void note_off(uint8_t note) {
+    note &= 0x7F;
+    word_(note) &= ~bit_(note);
+  }
+
+  bool contains(uint8_t note) const { note &= 0x7F; return (word_(note) & bit_(note)) != 0; }
+
+  // Zwróć MIDI note wg indeksu 1..size() w porządku rosnącym (spec: "indeksowanie nut")
+  std::optional<uint8_t> by_index(uint8_t idx_1based) const {
+    if (idx_1based == 0) return std::nullopt;
+    unsigned k = idx_1based - 1u;
+    const unsigned lo = static_cast<unsigned>(std::popcount(bits_[0]));
+    if (k < lo) return select_(bits_[0], k);
+    k -= lo;
+    if (k < static_cast<unsigned>(std::popcount(bits_[1]))) return static_cast<uint8_t>(64 + select_(bits_[1], k));
+    return std::nullopt; // indeks wskazuje "pusty slot"
+  }
+
+  std::optional<uint8_t> lowest() const {
+    if (bits_[0]) return static_cast<uint8_t>(std::countr_zero(bits_[0]));
+    if (bits_[1]) return static_cast<uint8_t>(64 + std::countr_zero(bits_[1]));
+    return std::nullopt;
+  }
+  std::optional<uint8_t> highest() const {
+    if (bits_[1]) return static_cast<uint8_t>(127 - std::countl_zero(bits_[1]));
+    if (bits_[0]) return static_cast<uint8_t>(63 - std::countl_zero(bits_[0]));
+    return std::nullopt;
+  }
+
+  // Ostatnio dociśnięta (wciąż trzymana) nuta – przegląd bitów, bez listy
+  std::optional<uint8_t> newest() const {
+    std::optional<uint8_t> best;
+    for_each([&](uint8_t n) { if (!best || order_[n] > order_[*best]) best = n; });
+    return best;
+  }
+
+  // Dane wejściowe trzymanej nuty (dla nie-trzymanej: ostatnie znane)
+  uint8_t  velocity(uint8_t note) const { return vel_[note & 0x7F]; }
+  uint32_t arrival(uint8_t note)  const { return order_[note & 0x7F]; }   // większy = później
+
+  // Trzymane nuty rosnąco
+  template <class F> void for_each(F&& f) const {
+    for (unsigned w = 0; w < 2; ++w)
+      for (uint64_t m = bits_[w]; m; m &= m - 1)
+        f(static_cast<uint8_t>(64 * w + static_cast<unsigned>(std::countr_zero(m))));
+  }
+
+  std::size_t size() const {
+    return static_cast<std::size_t>(std::popcount(bits_[0]) + std::popcount(bits_[1]));
+  }
+  bool empty() const { return (bits_[0] | bits_[1]) == 0; }
+  void clear() { bits_[0] = bits_[1] = 0; }
+
+private:
+  std::array<uint64_t, 2> bits_{};            // nuty 0..63, 64..127
+  std::array<uint8_t, 128>  vel_{};
+  std::array<uint32_t, 128> order_{};
+  uint32_t    seq_{0};
+  std::size_t capacity_{MAX_HELD_NOTES};
+
+  static uint64_t bit_(uint8_t note) { return uint64_t{1} << (note & 63); }
+  uint64_t&       word_(uint8_t note)       { return bits_[note >> 6]; }
+  const uint64_t& word_(uint8_t note) const { return bits_[note >> 6]; }
+
+  // Pozycja k-tego (od 0) ustawionego bitu słowa; k < popcount(w)
+  static uint8_t select_(uint64_t w, unsigned k) {
+    unsigned pos = 0;
+    for (unsigned half = 32; half >= 8; half /= 2) {
+      const uint64_t low = w & ((uint64_t{1} << half) - 1);
+      const unsigned c = static_cast<unsigned>(std::popcount(low));
+      if (k >= c) { k -= c; w >>= half; pos += half; }
+    }
+    for (; k; --k) w &= w - 1;                  // zostało < 8 bitów do przejścia
+    return static_cast<uint8_t>(pos + static_cast<unsigned>(std::countr_zero(w)));
+  }
+};
+
+} // namespace core
@@ -0,0 +1,178 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include "ports/Midi.hpp"
+#include "core/Transport.hpp"
+
+namespace core {
+
+/*
+ * ClockSync – śledzenie zewnętrznego MIDI Clock (24 PPQN) pętlą PLL.
+ *
+ * Impulsy F8 z USB przychodzą z rozrzutem rzędu 0.5–2 ms. Zamiast stawiać
+ * kroki na impulsach, pętla fazowa drugiego rzędu wygładza:
+ *   e     = t_impulsu - t_przewidziany           (błąd fazy)
+ *   t_est = t_przewidziany + ALPHA * e           (wygładzona chwila impulsu)
+ *   T    += BETA * e                             (okres impulsu = tempo)
+ *   t_przewidziany' = t_est + T
+ * Z (t_est, numer impulsu, T) dostajemy ciągłą oś beat <-> µs, więc kroki
+ * leżą między impulsami (interpolacja), a nie na nich.
+ *
+ * Na starcie (i po skoku tempa) wzmocnienia są większe – szybkie zatrzaśnięcie,
+ * potem maleją do wartości "tłumienie krytyczne" (BETA = ALPHA^2 / 4).
+ *
+ * Start (FA) / Continue (FB) / Stop (FC) / Song Position (F2) sterują pozycją;
+ * zegar, który biegnie przy zatrzymanym transporcie, nadal stroi tempo.
+ *
+ * Zgubiony impuls (USB, przepełniony bufor): następny przychodzi ~k okresów
+ * po przewidywaniu. Wtedy licznik impulsów idzie o k dalej i kotwica staje
+ * na tym impulsie – bez tego pozycja zostaje o k impulsów za masterem na
+ * zawsze. Seria takich "dziur" to jednak wolniejsze tempo (np. 2x): przy
+ * ponownym zatrzaśnięciu cofamy doliczone impulsy.
+ */
+class ClockSync {
+public:
+  static constexpr int    PPQN = 24;
+  static constexpr double ALPHA_LOCK   = 0.5,  BETA_LOCK   = 0.0625;  // zatrzaskiwanie
+  static constexpr double ALPHA_TRACK  = 0.1,  BETA_TRACK  = 0.0025;  // śledzenie
+  static constexpr int    LOCK_PULSES  = 48;   // tyle impulsów z dużym wzmocnieniem
+  static constexpr int    RELOCK_AFTER = 3;    // tyle kolejnych dużych błędów => od nowa
+  static constexpr int    MAX_LOST     = 24;   // najdłuższa dziura uznana za zgubione impulsy (1 beat)
+  static constexpr double LOST_TOL     = 0.25; // |e - k*T| <= LOST_TOL*T => k zgubionych impulsów
+
+  // Co zmieniło się po komunikacie (silnik reaguje na pozycję/tempo)
+  enum class Event : uint8_t {
+    None,       // komunikat nie dotyczy zegara / bez zmian w osi
+    Tempo,      // nowy impuls: oś beat<->µs poprawiona
+    Started,    // pierwszy impuls po Start/Continue – transport rusza od position_beats()
+    Stopped,    // Stop
+    Position,   // Song Position (przy zatrzymanym transporcie)
+  };
+
+  Event on_message(const ports::MidiMsg& m) {
+    switch (m.status) {
+      case 0xF8: return on_pulse_(m.t_us);
+      case 0xFA: pulses_ = 0; lost_run_ = 0; arm_start_ = true; running_ = false; return Event::None;
+      case 0xFB: lost_run_ = 0; arm_start_ = true; running_ = false; return Event::None;
+      case 0xFC: {
+        const bool was = running_;
+        running_ = arm_start_ = false;
+        return was ? Event::Stopped : Event::None;
+      }
+      case 0xF2:
+        if (running_) return Event::None;        // SPP obowiązuje tylko przy zatrzymaniu
+        // pozycja w szesnastkach (14 bitów), 1/16 = 6 impulsów
+        pulses_ = (static_cast<uint64_t>(m.data2 & 0x7F) << 7 | (m.data1 & 0x7F)) * 6;
+        lost_run_ = 0;
+        return Event::Position;
+      default:
+        return Event::None;
+    }
+  }
+
+  bool running() const { return running_; }
+  bool locked()  const { return have_period_; }
+
+  double us_per_pulse() const { return period_us_; }
+  double bpm() const { return have_period_ ? US_PER_MINUTE / (period_us_ * PPQN) : 0.0; }
+
+  // Pozycja (beat) ostatniego impulsu i jego wygładzony czas – kotwica dla Transport
+  double   position_beats() const { return static_cast<double>(pulses_) / PPQN; }
+  uint64_t anchor_us() const { return est_us_ <= 0 ? 0 : static_cast<uint64_t>(std::llround(est_us_)); }
+
+  // Ostatni błąd fazy (impuls - przewidywanie), µs – metryka jakości śledzenia
+  // (po zgubionych impulsach: względem przewidywania przesuniętego o k okresów)
+  double last_phase_error_us() const { return last_err_; }
+  // Ile impulsów uznaliśmy za zgubione (i doliczyliśmy do pozycji)
+  uint64_t lost_pulses() const { return lost_total_; }
+
+  // Oś beat <-> µs dla transportu (tempo jeszcze nieznane => zostaje dotychczasowe)
+  void apply_to(Transport& tr) const {
+    tr.sync(position_beats(), anchor_us(), have_period_ ? bpm() : tr.bpm());
+  }
+
+private:
+  bool     running_{false};
+  bool     arm_start_{false};   // Start/Continue przyszło, czekamy na pierwszy impuls
+  uint64_t pulses_{0};          // numer ostatniego impulsu (pozycja * 24)
+  bool     have_first_{false};  // był choć jeden impuls (mamy czas odniesienia)
+  bool     have_period_{false}; // znamy okres (>= 2 impulsy)
+  double   period_us_{0.0};
+  double   est_us_{0.0};        // wygładzona chwila ostatniego impulsu
+  double   last_raw_{0.0};      // surowa chwila ostatniego impulsu
+  double   last_err_{0.0};
+  int      since_lock_{0};
+  int      outliers_{0};
+  uint64_t lost_run_{0};        // impulsy doliczone w bieżącej serii dużych błędów
+  uint64_t lost_total_{0};
+
+  Event on_pulse_(uint64_t t_us) {
+    const double t = static_cast<double>(t_us);
+    Event ev = Event::Tempo;
+
+    if (!have_first_) {
+      have_first_ = true;
+      est_us_ = t;
+    } else if (!have_period_) {
+      relock_(t - last_raw_, t);
+    } else {
+      const double pred = est_us_ + period_us_;
+      const double e = t - pred;
+      last_err_ = e;
+      const double k = std::round(e / period_us_);
+      if (std::fabs(e) > period_us_ * 0.5) {
+        // duży błąd: pojedynczy => zgubiony/spóźniony impuls; seria => zmiana tempa
+        if (++outliers_ >= RELOCK_AFTER) {
+          if (running_) { pulses_ -= lost_run_; lost_total_ -= lost_run_; }   // to nie były zgubione
+          lost_run_ = 0;
+          relock_(t - last_raw_, t);
+        } else if (k >= 1 && k <= MAX_LOST && std::fabs(e - k * period_us_) <= LOST_TOL * period_us_) {
+          // k zgubionych impulsów: pozycja o k dalej, kotwica na tym impulsie
+          const double r = e - k * period_us_;
+          last_err_ = r;
+          est_us_ = pred + k * period_us_ + ALPHA_TRACK * r;
+          if (running_ && !arm_start_) {
+            const auto lost = static_cast<uint64_t>(k);
+            pulses_ += lost;
+            lost_run_ += lost;
+            lost_total_ += lost;
+          }
+        } else {
+          est_us_ = pred;
+        }
+      } else {
+        outliers_ = 0;
+        lost_run_ = 0;
+        const bool lock = since_lock_ < LOCK_PULSES;
+        const double a = lock ? ALPHA_LOCK : ALPHA_TRACK;
+        const double b = lock ? BETA_LOCK  : BETA_TRACK;
+        est_us_ = pred + a * e;
+        period_us_ += b * e;
+        ++since_lock_;
+      }
+    }
+    last_raw_ = t;
+
+    if (arm_start_) {
+      // pierwszy impuls po Start/Continue to pozycja pulses_ (bez przesuwania licznika)
+      arm_start_ = false;
+      running_ = true;
+      ev = Event::Started;
+    } else if (running_) {
+      ++pulses_;
+    }
+    return have_period_ || ev == Event::Started ? ev : Event::None;
+  }
+
+  void relock_(double interval, double t) {
+    if (!(interval > 0)) return;
+    period_us_ = interval;
+    est_us_ = t;
+    have_period_ = true;
+    since_lock_ = 0;
+    outliers_ = 0;
+    lost_run_ = 0;
+  }
+};
+
+} // namespace core
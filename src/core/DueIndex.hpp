@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace core {
+
+/*
+ * DueIndex – indeks terminów: który pattern gra najwcześniej.
+ *
+ * Kopiec min po czasie następnego kroku, indeksowany numerem patternu
+ * (pos_[id] = miejsce w kopcu), więc dodanie/usunięcie/zmiana terminu
+ * konkretnego patternu to O(log n), a odczyt najbliższego – O(1).
+ * Pamięć rezerwujemy raz (reset) – w pracy nic nie alokuje.
+ */
+class DueIndex {
+public:
+  static constexpr uint32_t NONE = 0xFFFFFFFFu;
+
+  void reset(std::size_t n) {
+    heap_.clear();   heap_.reserve(n);
+    time_.assign(n, 0);
+    pos_.assign(n, NONE);
+  }
+
+  std::size_t size() const { return heap_.size(); }
+  bool empty() const { return heap_.empty(); }
+  bool contains(uint32_t id) const { return pos_[id] != NONE; }
+
+  uint32_t top_id()   const { return heap_[0]; }
+  uint64_t top_time() const { return time_[heap_[0]]; }
+  uint64_t time_of(uint32_t id) const { return time_[id]; }
+
+  // Dodaj albo zmień termin patternu
+  void set(uint32_t id, uint64_t t) {
+    if (!contains(id)) {
+      time_[id] = t;
+      pos_[id] = static_cast<uint32_t>(heap_.size());
+      heap_.push_back(id);                 // mieści się w rezerwie z reset()
+      sift_up_(pos_[id]);
+      return;
+    }
+    const uint64_t old = time_[id];
+    time_[id] = t;
+    if (t < old) sift_up_(pos_[id]);
+    else         sift_down_(pos_[id]);
+  }
+
+  void remove(uint32_t id) {
+    if (!contains(id)) return;
+    const uint32_t i = pos_[id];
+    const uint32_t last = heap_.back();
+    heap_.pop_back();
+    pos_[id] = NONE;
+    if (last == id) return;
+    heap_[i] = last;
+    pos_[last] = i;
+    sift_up_(i);
+    sift_down_(pos_[last]);
+  }
+
+private:
+  std::vector<uint32_t> heap_;   // kopiec: pozycja -> id
+  std::vector<uint64_t> time_;   // id -> termin
+  std::vector<uint32_t> pos_;    // id -> pozycja (NONE = poza indeksem)
+
+  bool less_(uint32_t a, uint32_t b) const {
+    // remis => niższy numer patternu pierwszy (stała, przewidywalna kolejność)
+    const uint64_t ta = time_[heap_[a]], tb = time_[heap_[b]];
+    return ta < tb || (ta == tb && heap_[a] < heap_[b]);
+  }
+
+  void swap_(uint32_t a, uint32_t b) {
+    const uint32_t t = heap_[a]; heap_[a] = heap_[b]; heap_[b] = t;
+    pos_[heap_[a]] = a;
+    pos_[heap_[b]] = b;
+  }
+
+  void sift_up_(uint32_t i) {
+    while (i > 0) {
+      const uint32_t parent = (i - 1) / 2;
+      if (!less_(i, parent)) break;
+      swap_(i, parent);
+      i = parent;
+    }
+  }
+
+  void sift_down_(uint32_t i) {
+    const uint32_t n = static_cast<uint32_t>(heap_.size());
+    for (;;) {
+      const uint32_t l = 2 * i + 1, r = l + 1;
+      uint32_t m = i;
+      if (l < n && less_(l, m)) m = l;
+      if (r < n && less_(r, m)) m = r;
+      if (m == i) break;
+      swap_(i, m);
+      i = m;
+    }
+  }
+};
+
+} // namespace core
@@ -0,0 +1,31 @@
+#pragma once
+#include "core/PatternEngine.hpp"
+#include "core/PatternBuilder.hpp"
+
+namespace core {
+
+// Fabryczny zestaw startowy (aplikacja i render offline grają to samo).
+// Wypieczony w czasie kompilacji: tablice są tylko do odczytu, start to kopia kroków.
+
+// Pattern 0: ósemki
+inline constexpr auto FACTORY_PATTERN_0 = bake<3>(build_pattern([](PatternBuilder& b) {
+  b.ch(1).div(2)
+   .indices({1,3,2})
+   .each().gate(70).vel(100).oct(0).prob(100).on().done();
+}));
+
+// Pattern 1: szesnastki, oktawę wyżej
+inline constexpr auto FACTORY_PATTERN_1 = bake<3>(build_pattern([](PatternBuilder& b) {
+  b.ch(2).div(4)
+   .indices({1,2,3}).each().gate(50).vel(90).oct(+1).on().done();
+}));
+
+static_assert(valid_pattern(FACTORY_PATTERN_0.config()) && valid_pattern(FACTORY_PATTERN_1.config()));
+
+// Wymaga co najmniej 2 patternów w silniku.
+inline void load_factory_patterns(PatternEngine& eng) {
+  FACTORY_PATTERN_0.copy_to(eng.pattern(0));
+  FACTORY_PATTERN_1.copy_to(eng.pattern(1));
+}
+
+} // namespace core
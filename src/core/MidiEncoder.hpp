@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "ports/Midi.hpp"
+
+namespace core {
+
+/*
+ * MidiEncoder – komunikaty -> bajty strumienia MIDI 1.0 (odwrotność MidiParser).
+ *
+ * Na łączu DIN (31,25 kbit/s, ~320 µs na bajt) każdy bajt to czas, więc gęste
+ * akordy z kilku patternów rozjeżdżają się w czasie. Oszczędzamy tam, gdzie
+ * port przyjmuje surowy strumień:
+ *  - running status: ten sam status kanałowy co poprzednio => bez bajtu statusu,
+ *  - NoteOff z velocity 0 => NoteOn z velocity 0 (to samo znaczenie), żeby
+ *    ON-y i OFF-y na kanale dzieliły status i running status łapał oba.
+ * Realtime nie zmienia stanu (może wejść w środek), system common go kasuje.
+ *
+ * Stan = jeden bajt; liczniki bajtów: ile poszłoby bez kompresji i ile poszło.
+ */
+class MidiEncoder {
+public:
+  struct Options {
+    bool running_status = true;
+    bool note_off_as_on = true;     // tylko NoteOff z velocity 0 (inna velocity zostaje)
+  };
+
+  MidiEncoder() = default;
+  explicit MidiEncoder(Options o) : opt_(o) {}
+
+  // Zakoduj m do out (miejsce na 3 B); zwraca liczbę bajtów,
+  // 0 => komunikat spoza MidiMsg (SysEx) – nic nie zapisano
+  std::size_t encode(const ports::MidiMsg& m, uint8_t* out) {
+    const std::size_t len = ports::message_length(m.status);
+    if (len == 0) return 0;
+    full_ += len;
+
+    uint8_t status = m.status;
+    if (opt_.note_off_as_on && (status & 0xF0) == 0x80 && m.data2 == 0)
+      status = static_cast<uint8_t>(0x90 | (status & 0x0F));
+
+    std::size_t n = 0;
+    if (status >= 0xF8) {                               // realtime: stanu nie ruszamy
+      out[n++] = status;
+    } else if (status >= 0xF0) {                        // system common kasuje running status
+      out[n++] = status;
+      running_ = 0;
+    } else if (!opt_.running_status || status != running_) {
+      out[n++] = status;
+      running_ = opt_.running_status ? status : 0;
+    }
+    if (len >= 2) out[n++] = m.data1;
+    if (len >= 3) out[n++] = m.data2;
+    sent_ += n;
+    return n;
+  }
+
+  // Następny komunikat z pełnym statusem (np. po nieudanym zapisie – odbiorca
+  // mógł zgubić status)
+  void reset() { running_ = 0; }
+
+  uint64_t bytes_full() const { return full_; }
+  uint64_t bytes_sent() const { return sent_; }
+  uint64_t bytes_saved() const { return full_ - sent_; }
+
+private:
+  Options  opt_{};
+  uint8_t  running_{0};
+  uint64_t full_{0};
+  uint64_t sent_{0};
+};
+
+} // namespace core
@@ -0,0 +1,92 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "ports/Midi.hpp"
+
+namespace core {
+
+/*
+ * MidiParser – przyrostowy dekoder strumienia bajtów MIDI 1.0
+ * (port szeregowy, /dev/snd/midiC*, FIFO, UART na MCU).
+ *
+ * Bajty podajemy kawałkami, dokładnie tak, jak przyszły z read() – komunikat
+ * może być rozcięty między kawałki w dowolnym miejscu. Maszyna stanów:
+ *  - running status: bajty danych bez statusu kontynuują ostatni status kanałowy
+ *    (0x80..0xEF); system common (0xF0..0xF7) go kasuje,
+ *  - realtime (0xF8..0xFF) może wystąpić MIĘDZY DOWOLNYMI bajtami, także w środku
+ *    komunikatu i SysEx – wychodzi od razu i nie rusza stanu,
+ *  - SysEx (0xF0 ... 0xF7) nie mieści się w MidiMsg: treść idzie kawałkami
+ *    (wskaźniki prosto do bufora wejściowego, bez kopiowania) do on_sysex;
+ *    każdy bajt statusu (poza realtime) kończy SysEx, także bez 0xF7,
+ *  - bajty danych bez żadnego statusu (start w połowie komunikatu) są liczone
+ *    w stray_bytes() i pomijane.
+ *
+ * Bez alokacji, stan = kilka bajtów; komunikaty oddajemy wywołaniem on_msg
+ * w trakcie dekodowania (bez kolejki pośredniej).
+ */
+class MidiParser {
+public:
+  // Domyślnie SysEx tylko pomijamy
+  struct IgnoreSysex {
+    void operator()(const uint8_t*, std::size_t, bool) const {}
+  };
+
+  // on_msg(const ports::MidiMsg&)                          – każdy pełny komunikat
+  // on_sysex(const uint8_t* p, std::size_t n, bool last)   – kawałek treści SysEx
+  //   (bez 0xF0/0xF7; last => koniec komunikatu, n może być 0)
+  template<class OnMsg, class OnSysex = IgnoreSysex>
+  void feed(const uint8_t* p, std::size_t n, uint64_t t_us, OnMsg&& on_msg, OnSysex&& on_sysex = {}) {
+    std::size_t sx = 0;                                // początek bieżącego kawałka SysEx
+    for (std::size_t i = 0; i < n; ++i) {
+      const uint8_t b = p[i];
+
+      if (b >= 0xF8) {                                 // realtime – przeplot w dowolnym miejscu
+        if (sysex_) { if (i > sx) on_sysex(p + sx, i - sx, false); sx = i + 1; }
+        if (b != 0xF9 && b != 0xFD) on_msg(ports::MidiMsg{b, 0, 0, t_us});   // F9/FD: niezdefiniowane
+        continue;
+      }
+
+      if (b < 0x80) {                                  // bajt danych
+        if (sysex_) continue;                          // część kawałka SysEx
+        if (!status_) { ++stray_; continue; }
+        data_[got_++] = b;
+        if (got_ < need_) continue;
+        on_msg(ports::MidiMsg{status_, data_[0], need_ > 1 ? data_[1] : uint8_t{0}, t_us});
+        got_ = 0;
+        if (status_ >= 0xF0) status_ = 0;              // system common nie ma running status
+        continue;
+      }
+
+      // bajt statusu (0x80..0xF7)
+      if (sysex_) {                                    // koniec SysEx (0xF7 albo przerwany)
+        on_sysex(p + sx, i - sx, true);
+        sysex_ = false;
+      }
+      got_ = 0;
+      status_ = 0;
+      if (b == 0xF0) { sysex_ = true; sx = i + 1; continue; }
+      if (b == 0xF7 || b == 0xF4 || b == 0xF5) continue;  // EOX bez SysEx, niezdefiniowane
+
+      const std::size_t len = ports::message_length(b);
+      if (len == 1) { on_msg(ports::MidiMsg{b, 0, 0, t_us}); continue; }  // Tune Request
+      status_ = b;
+      need_   = static_cast<uint8_t>(len - 1);
+    }
+    if (sysex_ && n > sx) on_sysex(p + sx, n - sx, false);   // SysEx ciągnie się dalej
+  }
+
+  void reset() { status_ = 0; need_ = 0; got_ = 0; sysex_ = false; }
+
+  bool in_sysex() const { return sysex_; }
+  uint64_t stray_bytes() const { return stray_; }
+
+private:
+  uint8_t  status_{0};     // bieżący status (running status albo system common w toku); 0 = brak
+  uint8_t  need_{0};       // ile bajtów danych ma komunikat
+  uint8_t  got_{0};        // ile już przyszło
+  uint8_t  data_[2]{};
+  bool     sysex_{false};
+  uint64_t stray_{0};
+};
+
+} // namespace core
@@ -0,0 +1,146 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "core/ChordState.hpp"
+#include "core/Rng.hpp"
+
+namespace core {
+
+/*
+ * Kolejność nut arpeggiatora jako parametr szablonu (BasicArpEngine<Order>).
+ *
+ * Polityka to struktura ze statycznymi funkcjami – kompilator wkleja wybór
+ * nuty w krok silnika, bez wywołań wirtualnych i bez switcha co krok:
+ *
+ *   static constexpr const char* NAME;
+ *   static constexpr std::size_t MAX_VOICES;        // ile nut naraz w jednym kroku
+ *   static constexpr std::size_t period(std::size_t n);   // długość cyklu dla n nut (n > 0)
+ *   static std::size_t pick(const ChordState& c, std::size_t k, Pcg32& rng, uint8_t* out);
+ *       // k-ty krok cyklu (k < period(n)); wpisuje nuty do out, zwraca ich liczbę
+ *
+ * Silnik trzyma kursor k: po każdym kroku k = (k + 1) % period(n), a przy
+ * zmianie akordu przycina go do nowego okresu.
+ */
+namespace order {
+
+// Od najniższej do najwyższej
+struct Up {
+  static constexpr const char* NAME = "up";
+  static constexpr std::size_t MAX_VOICES = 1;
+  static constexpr std::size_t period(std::size_t n) { return n; }
+  static std::size_t pick(const ChordState& c, std::size_t k, Pcg32&, uint8_t* out) {
+    out[0] = *c.by_index(static_cast<uint8_t>(k + 1));
+    return 1;
+  }
+};
+
+// Od najwyższej do najniższej
+struct Down {
+  static constexpr const char* NAME = "down";
+  static constexpr std::size_t MAX_VOICES = 1;
+  static constexpr std::size_t period(std::size_t n) { return n; }
+  static std::size_t pick(const ChordState& c, std::size_t k, Pcg32&, uint8_t* out) {
+    out[0] = *c.by_index(static_cast<uint8_t>(c.size() - k));
+    return 1;
+  }
+};
+
+// W górę i w dół, bez powtarzania skrajnych nut (C E G E | C E G E ...)
+struct UpDown {
+  static constexpr const char* NAME = "updown";
+  static constexpr std::size_t MAX_VOICES = 1;
+  static constexpr std::size_t period(std::size_t n) { return n > 1 ? 2 * n - 2 : 1; }
+  static std::size_t pick(const ChordState& c, std::size_t k, Pcg32&, uint8_t* out) {
+    const std::size_t n = c.size();
+    const std::size_t i = k < n ? k : 2 * n - 2 - k;
+    out[0] = *c.by_index(static_cast<uint8_t>(i + 1));
+    return 1;
+  }
+};
+
+// W kolejności dociśnięcia klawiszy
+struct AsPlayed {
+  static constexpr const char* NAME = "played";
+  static constexpr std::size_t MAX_VOICES = 1;
+  static constexpr std::size_t period(std::size_t n) { return n; }
+  static std::size_t pick(const ChordState& c, std::size_t k, Pcg32&, uint8_t* out) {
+    std::array<uint8_t, MAX_CHORD_NOTES> held;
+    std::size_t n = 0;
+    c.for_each([&](uint8_t note) { held[n++] = note; });
+    const auto by_arrival = [&](uint8_t a, uint8_t b) { return c.arrival(a) < c.arrival(b); };
+    std::nth_element(held.begin(), held.begin() + static_cast<std::ptrdiff_t>(k),
+                     held.begin() + static_cast<std::ptrdiff_t>(n), by_arrival);
+    out[0] = held[k];
+    return 1;
+  }
+};
+
+// Losowa nuta akordu w każdym kroku (strumień z seeda silnika)
+struct Random {
+  static constexpr const char* NAME = "random";
+  static constexpr std::size_t MAX_VOICES = 1;
+  static constexpr std::size_t period(std::size_t n) { return n; }
+  static std::size_t pick(const ChordState& c, std::size_t, Pcg32& rng, uint8_t* out) {
+    const auto i = (static_cast<uint64_t>(rng.next()) * c.size()) >> 32;   // 0..n-1 bez dzielenia
+    out[0] = *c.by_index(static_cast<uint8_t>(i + 1));
+    return 1;
+  }
+};
+
+// Z zewnątrz do środka: najniższa, najwyższa, druga od dołu, druga od góry, ...
+struct Converge {
+  static constexpr const char* NAME = "converge";
+  static constexpr std::size_t MAX_VOICES = 1;
+  static constexpr std::size_t period(std::size_t n) { return n; }
+  static constexpr std::size_t index(std::size_t n, std::size_t k) { return (k % 2 == 0) ? k / 2 : n - 1 - k / 2; }
+  static std::size_t pick(const ChordState& c, std::size_t k, Pcg32&, uint8_t* out) {
+    out[0] = *c.by_index(static_cast<uint8_t>(index(c.size(), k) + 1));
+    return 1;
+  }
+};
+
+// Ze środka na zewnątrz – Converge od końca
+struct Diverge {
+  static constexpr const char* NAME = "diverge";
+  static constexpr std::size_t MAX_VOICES = 1;
+  static constexpr std::size_t period(std::size_t n) { return n; }
+  static std::size_t pick(const ChordState& c, std::size_t k, Pcg32&, uint8_t* out) {
+    const std::size_t n = c.size();
+    out[0] = *c.by_index(static_cast<uint8_t>(Converge::index(n, n - 1 - k) + 1));
+    return 1;
+  }
+};
+
+// Cały akord w każdym kroku
+struct Chord {
+  static constexpr const char* NAME = "chord";
+  static constexpr std::size_t MAX_VOICES = MAX_CHORD_NOTES;
+  static constexpr std::size_t period(std::size_t) { return 1; }
+  static std::size_t pick(const ChordState& c, std::size_t, Pcg32&, uint8_t* out) {
+    std::size_t n = 0;
+    c.for_each([&](uint8_t note) { out[n++] = note; });
+    return n;
+  }
+};
+
+// Wybór polityki po nazwie (CLI, render) – raz, na zewnątrz pętli:
+//   with_order("updown", [&](auto tag) { BasicArpEngine<decltype(tag)> eng(...); ... });
+// false => nieznana nazwa
+template<class F>
+bool with_order(std::string_view name, F&& f) {
+  bool found = false;
+  const auto try_one = [&](auto tag) {
+    if (!found && name == decltype(tag)::NAME) { found = true; f(tag); }
+  };
+  try_one(Up{}); try_one(Down{}); try_one(UpDown{}); try_one(AsPlayed{});
+  try_one(Random{}); try_one(Converge{}); try_one(Diverge{}); try_one(Chord{});
+  return found;
+}
+
+constexpr const char* ORDER_NAMES = "up|down|updown|played|random|converge|diverge|chord";
+
+} // namespace order
+} // namespace core
@@ -0,0 +1,146 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace core {
+
+/*
+ * Uchwyt do zaplanowanego NoteOff.
+ * slot = miejsce w puli, gen = "pokolenie" slotu – po wysłaniu OFF-a slot
+ * dostaje nowe pokolenie, więc stary uchwyt przestaje pasować (nie wydłużymy cudzej nuty).
+ */
+struct OffHandle {
+  static constexpr uint32_t NONE = 0xFFFFFFFFu;
+  uint32_t slot = NONE;
+  uint32_t gen  = 0;
+  bool valid() const { return slot != NONE; }
+};
+
+/*
+ * OffQueue – kolejka priorytetowa NoteOff-ów o stałej pojemności.
+ * Pamięć rezerwujemy raz, w konstruktorze – push/pop nigdy nie alokują.
+ *
+ * Indeksowany kopiec min (wg czasu):
+ *  - push / pop / wydłużenie: O(log n),
+ *  - najbliższy termin: O(1),
+ *  - dostęp do konkretnego wpisu po uchwycie: O(1) (pos_[slot] = miejsce w kopcu).
+ */
+class OffQueue {
+public:
+  // tag – dowolny znacznik właściciela (np. numer patternu, do statystyk)
+  struct Entry { uint64_t at_us; uint8_t ch; uint8_t note; uint32_t tag; };
+
+  explicit OffQueue(std::size_t capacity)
+    : entries_(capacity), heap_(capacity), pos_(capacity, OffHandle::NONE),
+      gen_(capacity, 0), free_(capacity), cap_(capacity) {
+    for (std::size_t i = 0; i < cap_; ++i) free_[i] = static_cast<uint32_t>(cap_ - 1 - i);
+  }
+
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  bool full()  const { return size_ == cap_; }
+  std::size_t capacity() const { return cap_; }
+
+  // Zaplanuj OFF (wołający sprawdza full() – patrz pop() jako polityka "zrób miejsce")
+  OffHandle push(uint64_t at_us, uint8_t ch, uint8_t note, uint32_t tag = 0) {
+    const uint32_t slot = free_[cap_ - 1 - size_];
+    entries_[slot] = Entry{at_us, ch, note, tag};
+    heap_[size_] = slot;
+    pos_[slot]   = static_cast<uint32_t>(size_);
+    ++size_;
+    sift_up_(size_ - 1);
+    return OffHandle{slot, gen_[slot]};
+  }
+
+  // Czy uchwyt wciąż wskazuje oczekujący OFF
+  bool contains(OffHandle h) const {
+    return h.valid() && h.slot < cap_ && gen_[h.slot] == h.gen && pos_[h.slot] != OffHandle::NONE;
+  }
+
+  // Przesuń OFF na później (nigdy wcześniej). false => uchwyt nieaktualny.
+  bool extend(OffHandle h, uint64_t at_us) {
+    if (!contains(h)) return false;
+    auto& e = entries_[h.slot];
+    if (e.at_us < at_us) {
+      e.at_us = at_us;
+      sift_down_(pos_[h.slot]);
+    }
+    return true;
+  }
+
+  std::optional<uint64_t> next_time() const {
+    if (size_ == 0) return std::nullopt;
+    return entries_[heap_[0]].at_us;
+  }
+
+  const Entry& top() const { return entries_[heap_[0]]; }
+
+  // Zdejmij najwcześniejszy OFF (kolejka nie może być pusta)
+  Entry pop() {
+    const uint32_t slot = heap_[0];
+    const Entry e = entries_[slot];
+    --size_;
+    if (size_ > 0) {
+      heap_[0] = heap_[size_];
+      pos_[heap_[0]] = 0;
+      sift_down_(0);
+    }
+    release_(slot);
+    return e;
+  }
+
+  // Zdejmij wszystkie OFF-y z terminem <= now (w kolejności czasu)
+  template<class F>
+  void pop_due(uint64_t now, F&& fn) {
+    while (size_ > 0 && entries_[heap_[0]].at_us <= now) fn(pop());
+  }
+
+private:
+  std::vector<Entry>    entries_;  // dane wg slotu
+  std::vector<uint32_t> heap_;     // kopiec: pozycja -> slot
+  std::vector<uint32_t> pos_;      // slot -> pozycja (NONE = wolny)
+  std::vector<uint32_t> gen_;      // pokolenie slotu
+  std::vector<uint32_t> free_;     // stos wolnych slotów (góra na końcu)
+  std::size_t cap_;
+  std::size_t size_{0};
+
+  bool less_(std::size_t a, std::size_t b) const {
+    return entries_[heap_[a]].at_us < entries_[heap_[b]].at_us;
+  }
+
+  void swap_(std::size_t a, std::size_t b) {
+    const uint32_t t = heap_[a]; heap_[a] = heap_[b]; heap_[b] = t;
+    pos_[heap_[a]] = static_cast<uint32_t>(a);
+    pos_[heap_[b]] = static_cast<uint32_t>(b);
+  }
+
+  void sift_up_(std::size_t i) {
+    while (i > 0) {
+      const std::size_t parent = (i - 1) / 2;
+      if (!less_(i, parent)) break;
+      swap_(i, parent);
+      i = parent;
+    }
+  }
+
+  void sift_down_(std::size_t i) {
+    for (;;) {
+      const std::size_t l = 2 * i + 1, r = l + 1;
+      std::size_t m = i;
+      if (l < size_ && less_(l, m)) m = l;
+      if (r < size_ && less_(r, m)) m = r;
+      if (m == i) break;
+      swap_(i, m);
+      i = m;
+    }
+  }
+
+  void release_(uint32_t slot) {
+    pos_[slot] = OffHandle::NONE;
+    ++gen_[slot];
+    free_[cap_ - 1 - size_] = slot;
+  }
+};
+
+} // namespace core
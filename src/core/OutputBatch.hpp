@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "ports/Midi.hpp"
+
+namespace core {
+
+/*
+ * OutputBatch – bufor komunikatów wyjściowych uporządkowany wg czasu (t_us).
+ *
+ * Silnik w trybie lookahead generuje zdarzenia prawie po kolei (OFF-y
+ * i kroki różnych patternów przeplatają się), więc wstawianie od końca
+ * to zwykle 0–2 przesunięcia. Pojemność ustalana raz – push() nie alokuje;
+ * przy równych czasach zachowujemy kolejność wstawienia.
+ */
+class OutputBatch {
+public:
+  explicit OutputBatch(std::size_t capacity) : buf_(capacity) {}
+
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  bool full()  const { return size_ == buf_.size(); }
+  const ports::MidiMsg* data() const { return buf_.data(); }
+
+  // false => bufor pełny (wołający najpierw opróżnia paczkę)
+  bool push(const ports::MidiMsg& m) {
+    if (full()) return false;
+    std::size_t i = size_++;
+    while (i > 0 && buf_[i - 1].t_us > m.t_us) { buf_[i] = buf_[i - 1]; --i; }
+    buf_[i] = m;
+    return true;
+  }
+
+  void clear() { size_ = 0; }
+
+private:
+  std::vector<ports::MidiMsg> buf_;
+  std::size_t size_{0};
+};
+
+} // namespace core
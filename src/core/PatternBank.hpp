@@ -0,0 +1,184 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include "core/ChordState.hpp"
+#include "core/PatternEngine.hpp"
+
+namespace core {
+
+/*
+ * ======================================
+ * BANK PATTERNÓW – binarny format pliku
+ * ======================================
+ *
+ * Plik = nagłówek + 'count' rekordów o stałym rozmiarze, little-endian:
+ *
+ *   BankHeader (32 B) | BankRecord[0] | BankRecord[1] | ...
+ *
+ * Układ jest jawny (same pola o stałej szerokości, bez dopełnień kompilatora),
+ * więc plik mapujemy do pamięci i czytamy rekordy w miejscu – bez parsowania.
+ * Otwarcie banku to sprawdzenie nagłówka i rozmiaru (O(1) niezależnie od liczby
+ * patternów), wczytanie slotu to kopia jednego rekordu (~400 B).
+ *
+ * Wersjonowanie: 'version' rośnie przy każdej niezgodnej zmianie układu;
+ * 'record_size' i 'max_steps' pozwalają odrzucić plik z innego buildu
+ * (np. inne MAX_STEPS) zamiast czytać śmieci.
+ */
+constexpr char     BANK_MAGIC[8]  = {'A','R','P','B','A','N','K','\0'};
+constexpr uint32_t BANK_VERSION   = 1;
+
+struct BankHeader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t count;          // liczba rekordów (slotów)
+  uint32_t record_size;    // sizeof(BankRecord)
+  uint32_t max_steps;      // MAX_STEPS w chwili zapisu
+  uint32_t reserved[2];
+};
+
+struct BankStep {
+  uint8_t note_index;
+  uint8_t velocity;
+  uint8_t gate_pct;
+  int8_t  octave;
+  uint8_t enabled;         // 0/1
+  uint8_t probability;
+};
+
+struct BankRecord {
+  uint8_t  channel;
+  uint8_t  reserved0;
+  uint16_t division;
+  uint32_t seed;
+  uint16_t length;
+  uint16_t reserved1;
+  BankStep steps[MAX_STEPS];
+};
+
+static_assert(sizeof(BankHeader) == 32, "BankHeader: fixed layout");
+static_assert(sizeof(BankStep) == 6, "BankStep: fixed layout");
+static_assert(sizeof(BankRecord) == 12 + 6 * MAX_STEPS, "BankRecord: fixed layout");
+
+inline BankRecord to_bank_record(const PatternConfig& p) {
+  BankRecord r{};
+  r.channel  = p.channel;
+  r.division = p.division;
+  r.seed     = p.seed;
+  r.length   = static_cast<uint16_t>(p.length < MAX_STEPS ? p.length : MAX_STEPS);
+  for (std::size_t i = 0; i < MAX_STEPS; ++i) {
+    const Step& s = p.steps[i];
+    r.steps[i] = BankStep{s.note_index, s.velocity, s.gate_pct, s.octave,
+                          static_cast<uint8_t>(s.enabled ? 1 : 0), s.probability};
+  }
+  return r;
+}
+
+// Pierwsze pole rekordu spoza dozwolonego zakresu (step == -1 => pole patternu)
+struct BankRecordError {
+  const char* field{nullptr};
+  int         step{-1};
+  long        value{0};
+  long        lo{0}, hi{0};
+};
+
+// Zakresy jak w CLI (vel 1..127, gate 1..200, ...) – plik może być z innego
+// narzędzia albo uszkodzony, a silnik zakłada poprawne wartości.
+// Sprawdzamy wszystkie MAX_STEPS kroków: te za 'length' wchodzą do gry po wydłużeniu.
+inline bool check_bank_record(const BankRecord& r, BankRecordError* err = nullptr) {
+  auto in = [err](const char* field, int step, long v, long lo, long hi) {
+    if (v >= lo && v <= hi) return true;
+    if (err) *err = BankRecordError{field, step, v, lo, hi};
+    return false;
+  };
+  if (!in("channel", -1, r.channel, 1, 16) ||
+      !in("division", -1, r.division, 1, UINT16_MAX) ||
+      !in("length", -1, r.length, 0, static_cast<long>(MAX_STEPS)))
+    return false;
+  for (std::size_t i = 0; i < MAX_STEPS; ++i) {
+    const BankStep& s = r.steps[i];
+    const int k = static_cast<int>(i);
+    if (!in("idx", k, s.note_index, 0, static_cast<long>(MAX_CHORD_NOTES)) ||
+        !in("vel", k, s.velocity, 1, 127) ||
+        !in("gate", k, s.gate_pct, 1, 200) ||
+        !in("oct", k, s.octave, -8, 8) ||
+        !in("enabled", k, s.enabled, 0, 1) ||
+        !in("prob", k, s.probability, 0, 100))
+      return false;
+  }
+  return true;
+}
+
+// Opis błędu do bufora, np. "step 3 vel = 0 (expected 1..127)"
+inline void format_bank_error(const BankRecordError& e, char* buf, std::size_t n) {
+  if (e.step >= 0)
+    std::snprintf(buf, n, "step %d %s = %ld (expected %ld..%ld)", e.step, e.field, e.value, e.lo, e.hi);
+  else
+    std::snprintf(buf, n, "%s = %ld (expected %ld..%ld)", e.field, e.value, e.lo, e.hi);
+}
+
+// Rekord -> pattern; rekord spoza zakresów odrzucony w całości ('p' nietknięty)
+inline bool from_bank_record(const BankRecord& r, PatternConfig& p, BankRecordError* err = nullptr) {
+  if (!check_bank_record(r, err)) return false;
+  p.channel  = r.channel;
+  p.division = r.division;
+  p.seed     = r.seed;
+  p.length   = r.length;
+  for (std::size_t i = 0; i < MAX_STEPS; ++i) {
+    const BankStep& s = r.steps[i];
+    p.steps[i] = Step{s.note_index, s.velocity, s.gate_pct, s.octave, s.enabled != 0, s.probability};
+  }
+  return true;
+}
+
+/*
+ * BankView – widok na bank w pamięci (np. zmapowany plik); nic nie kopiuje.
+ * Pusty widok (valid() == false) po błędzie – powód w error().
+ */
+class BankView {
+public:
+  BankView() = default;
+  BankView(const void* data, std::size_t size) {
+    if (size < sizeof(BankHeader)) { err_ = "file too small for a bank header"; return; }
+    std::memcpy(&hdr_, data, sizeof hdr_);
+    if (std::memcmp(hdr_.magic, BANK_MAGIC, sizeof BANK_MAGIC) != 0) { err_ = "not a pattern bank"; return; }
+    if (hdr_.version != BANK_VERSION)          { err_ = "unsupported bank version"; return; }
+    if (hdr_.record_size != sizeof(BankRecord) || hdr_.max_steps != MAX_STEPS) {
+      err_ = "bank record layout differs from this build"; return;
+    }
+    if (size < sizeof(BankHeader) + static_cast<std::size_t>(hdr_.count) * sizeof(BankRecord)) {
+      err_ = "bank truncated"; return;
+    }
+    recs_ = reinterpret_cast<const BankRecord*>(static_cast<const unsigned char*>(data) + sizeof(BankHeader));
+  }
+
+  bool valid() const { return recs_ != nullptr; }
+  const char* error() const { return err_; }
+  std::size_t count() const { return valid() ? hdr_.count : 0; }
+
+  const BankRecord* record(std::size_t slot) const { return slot < count() ? &recs_[slot] : nullptr; }
+
+  // false => brak slotu (err nietknięty) albo rekord spoza zakresów (powód w err)
+  bool load(std::size_t slot, PatternConfig& out, BankRecordError* err = nullptr) const {
+    const BankRecord* r = record(slot);
+    return r && from_bank_record(*r, out, err);
+  }
+
+private:
+  BankHeader        hdr_{};
+  const BankRecord* recs_{nullptr};
+  const char*       err_{"empty"};
+};
+
+inline BankHeader make_bank_header(uint32_t count) {
+  BankHeader h{};
+  std::memcpy(h.magic, BANK_MAGIC, sizeof BANK_MAGIC);
+  h.version     = BANK_VERSION;
+  h.count       = count;
+  h.record_size = sizeof(BankRecord);
+  h.max_steps   = MAX_STEPS;
+  return h;
+}
+
+} // namespace core
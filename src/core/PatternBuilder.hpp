@@ -3,17 +3,26 @@
 #include <cstdint>
 #include <initializer_list>
 #include <algorithm>                // std::clamp
+#include <type_traits>              // std::is_constant_evaluated
 #include "core/PatternEngine.hpp"   // Step, PatternConfig, MAX_STEPS
 
 namespace core {
 
+// Wywołanie w trakcie obliczenia constexpr = błąd kompilacji z tą nazwą w komunikacie.
+// (W runtime nigdy nie jest wołana – tam wartości są przycinane.)
+inline void pattern_value_out_of_range() {}
+
 // Ułatwia składanie patternów czytelnie (bez ręcznego ustawiania pól).
+//
+// Działa w runtime i w constexpr: z lambdą w build_pattern() (niżej) pattern
+// powstaje w czasie kompilacji. W runtime wartości spoza zakresu są przycinane,
+// w constexpr – przerywają kompilację (pattern_value_out_of_range).
 class PatternBuilder {
 public:
-  explicit PatternBuilder(PatternConfig& cfg) : cfg_(cfg) {}
+  constexpr explicit PatternBuilder(PatternConfig& cfg) : cfg_(cfg) {}
 
   // Wyczyść kroki (kanał/division zostają)
-  PatternBuilder& clear() {
+  constexpr PatternBuilder& clear() {
     cfg_.length = 0;
     for (auto& s : cfg_.steps) s = Step{};
     editing_ = 0;
@@ -21,12 +30,18 @@ public:
     return *this;
   }
 
-  // Dodaj kroki według indeksów nut (1..8, 0 = REST)
-  PatternBuilder& indices(std::initializer_list<int> idxs) {
+  // Parametry całego patternu
+  constexpr PatternBuilder& ch(int c)       { cfg_.channel  = static_cast<uint8_t>(checked_(c, 1, 16)); return *this; }
+  constexpr PatternBuilder& div(int d)      { cfg_.division = static_cast<uint16_t>(checked_(d, 1, 0xFFFF)); return *this; }
+  // Ziarno losowania kroków z probability < 100 (cały pattern)
+  constexpr PatternBuilder& seed(uint32_t s) { cfg_.seed = s; return *this; }
+
+  // Dodaj kroki według indeksów nut (1..128, 0 = REST)
+  constexpr PatternBuilder& indices(std::initializer_list<int> idxs) {
     for (int idx : idxs) {
-      if (cfg_.length >= cfg_.steps.size()) break;
+      if (cfg_.length >= cfg_.steps.size()) { if (std::is_constant_evaluated()) pattern_value_out_of_range(); break; }
       Step s{};
-      s.note_index = static_cast<uint8_t>(std::clamp(idx, 0, 8));
+      s.note_index = static_cast<uint8_t>(checked_(idx, 0, IDX_MAX));
       cfg_.steps[cfg_.length++] = s;
     }
     editing_ = (cfg_.length ? cfg_.length - 1 : 0);
@@ -34,33 +49,33 @@ public:
   }
 
   // Rozpocznij edycję bieżącego kroku (gdy brak – tworzy pierwszy).
-  PatternBuilder& step() {
+  constexpr PatternBuilder& step() {
     ensure_slot_();
     editing_ = cfg_.length - 1;
     return *this;
   }
 
   // Przejdź do następnego kroku (tworzy pusty jeśli jest miejsce).
-  PatternBuilder& next() {
+  constexpr PatternBuilder& next() {
     ensure_slot_();
     return *this;
   }
 
   // Masowa edycja wszystkich istniejących kroków
-  PatternBuilder& each() { edit_all_ = true; return *this; }
-  PatternBuilder& done() { edit_all_ = false; return *this; }
+  constexpr PatternBuilder& each() { edit_all_ = true; return *this; }
+  constexpr PatternBuilder& done() { edit_all_ = false; return *this; }
 
   // Settery pojedynczego/powielonego zakresu
-  PatternBuilder& idx (int v){return set_([&](Step& s){s.note_index=static_cast<uint8_t>(std::clamp(v,0,8));});}
-  PatternBuilder& vel (int v){return set_([&](Step& s){s.velocity  =static_cast<uint8_t>(std::clamp(v,1,127));});}
-  PatternBuilder& gate(int v){return set_([&](Step& s){s.gate_pct  =static_cast<uint8_t>(std::clamp(v,1,200));});}
-  PatternBuilder& oct (int v){return set_([&](Step& s){s.octave    =static_cast<int8_t>(std::clamp(v,-8, 8));});}
-  PatternBuilder& prob(int v){return set_([&](Step& s){s.probability=static_cast<uint8_t>(std::clamp(v,0,100));});}
-  PatternBuilder& on()       {return set_([&](Step& s){s.enabled=true;});}
-  PatternBuilder& off()      {return set_([&](Step& s){s.enabled=false;});}
+  constexpr PatternBuilder& idx (int v){return set_([&](Step& s){s.note_index=static_cast<uint8_t>(checked_(v,0,IDX_MAX));});}
+  constexpr PatternBuilder& vel (int v){return set_([&](Step& s){s.velocity  =static_cast<uint8_t>(checked_(v,1,127));});}
+  constexpr PatternBuilder& gate(int v){return set_([&](Step& s){s.gate_pct  =static_cast<uint8_t>(checked_(v,1,200));});}
+  constexpr PatternBuilder& oct (int v){return set_([&](Step& s){s.octave    =static_cast<int8_t>(checked_(v,-8, 8));});}
+  constexpr PatternBuilder& prob(int v){return set_([&](Step& s){s.probability=static_cast<uint8_t>(checked_(v,0,100));});}
+  constexpr PatternBuilder& on()       {return set_([&](Step& s){s.enabled=true;});}
+  constexpr PatternBuilder& off()      {return set_([&](Step& s){s.enabled=false;});}
 
   // Szybkie powtórzenie ostatniego kroku n razy
-  PatternBuilder& repeat(std::size_t n) {
+  constexpr PatternBuilder& repeat(std::size_t n) {
     if (cfg_.length == 0) return *this;
     const Step last = cfg_.steps[cfg_.length - 1];
     while (n-- && cfg_.length < cfg_.steps.size()) cfg_.steps[cfg_.length++] = last;
@@ -73,7 +88,14 @@ private:
   std::size_t editing_ = 0;
   bool edit_all_ = false;
 
-  void ensure_slot_() {
+  static constexpr int IDX_MAX = static_cast<int>(MAX_CHORD_NOTES);
+
+  static constexpr int checked_(int v, int lo, int hi) {
+    if (std::is_constant_evaluated() && (v < lo || v > hi)) pattern_value_out_of_range();
+    return std::clamp(v, lo, hi);
+  }
+
+  constexpr void ensure_slot_() {
     if (cfg_.length == 0) {
       cfg_.steps[0] = Step{}; cfg_.length = 1;
     } else if (editing_ == cfg_.length - 1 && cfg_.length < cfg_.steps.size()) {
@@ -82,7 +104,7 @@ private:
   }
 
   template<class F>
-  PatternBuilder& set_(F&& fn) {
+  constexpr PatternBuilder& set_(F&& fn) {
     if (cfg_.length == 0) ensure_slot_();
     if (edit_all_) {
       for (std::size_t i = 0; i < cfg_.length; ++i) fn(cfg_.steps[i]);
@@ -93,4 +115,65 @@ private:
   }
 };
 
+// Pattern z buildera w jednym wyrażeniu – nadaje się na inicjalizator constexpr:
+//   constexpr auto P = build_pattern([](PatternBuilder& b) { b.ch(1).div(2).indices({1,3,2}); });
+template<class F>
+constexpr PatternConfig build_pattern(F&& fn) {
+  PatternConfig p{};
+  PatternBuilder b(p);
+  fn(b);
+  return p;
+}
+
+// Czy pattern mieści się w zakresach silnika (do static_assert na wypieczonych tablicach)
+constexpr bool valid_pattern(const PatternConfig& p) {
+  if (p.channel < 1 || p.channel > 16 || p.division < 1 || p.length > MAX_STEPS) return false;
+  for (std::size_t i = 0; i < p.length; ++i) {
+    const Step& s = p.steps[i];
+    if (s.note_index > MAX_CHORD_NOTES || s.velocity < 1 || s.velocity > 127 ||
+        s.gate_pct < 1 || s.gate_pct > 200 || s.octave < -8 || s.octave > 8 || s.probability > 100)
+      return false;
+  }
+  return true;
+}
+
+/*
+ * StepTable<N> – zwarta, wypieczona postać patternu: tylko N użytych kroków
+ * (PatternConfig ma zawsze MAX_STEPS). Jako 'inline constexpr' ląduje
+ * w pamięci tylko do odczytu (na MCU: flash); do silnika trafia kopią
+ * N kroków (copy_to), bez budowania przy starcie.
+ */
+template<std::size_t N>
+struct StepTable {
+  static_assert(N >= 1 && N <= MAX_STEPS, "StepTable: 1..MAX_STEPS steps");
+
+  uint8_t  channel  = 1;
+  uint16_t division = 2;
+  uint32_t seed     = 1;
+  std::array<Step, N> steps{};
+
+  static constexpr std::size_t size() { return N; }
+
+  constexpr void copy_to(PatternConfig& p) const {
+    p.channel  = channel;
+    p.division = division;
+    p.seed     = seed;
+    p.length   = N;
+    for (std::size_t i = 0; i < N; ++i) p.steps[i] = steps[i];
+  }
+  constexpr PatternConfig config() const { PatternConfig p{}; copy_to(p); return p; }
+};
+
+// Wypiecz pattern do tablicy o dokładnie tylu krokach, ile ma (błąd kompilacji, jeśli nie)
+template<std::size_t N>
+constexpr StepTable<N> bake(const PatternConfig& p) {
+  if (std::is_constant_evaluated() && (p.length != N || !valid_pattern(p))) pattern_value_out_of_range();
+  StepTable<N> t{};
+  t.channel  = p.channel;
+  t.division = p.division;
+  t.seed     = p.seed;
+  for (std::size_t i = 0; i < N && i < p.length; ++i) t.steps[i] = p.steps[i];
+  return t;
+}
+
 } // namespace core
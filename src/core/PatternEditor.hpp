@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include "core/PatternEngine.hpp"
+#include "ports/Wakeup.hpp"
+
+namespace core {
+
+/*
+ * PatternEditor – strona edytora publikacji konfiguracji (patrz PatternMailbox).
+ *
+ * Jeden wątek (nie-RT) edytuje szkice draft(i) do woli, a publish(i) oddaje
+ * silnikowi kopię szkicu jako nową migawkę – od razu, od kroku albo od taktu.
+ * Silnik nie widzi szkicu w trakcie edycji, więc nigdy nie zagra połowy zmiany.
+ *
+ * Tu (i tylko tu) są new/delete migawek: publish() alokuje nową, zwalnia
+ * migawkę, której silnik nie zdążył odebrać, i zbiera to, co silnik oddał.
+ *
+ * Edytujących wątków może być kilka (CLI + przeładowanie banku z pliku) –
+ * wtedy każdy trzyma lock() od zmiany szkicu do publish() włącznie; pierścienie
+ * skrzynki mają jednego producenta naraz. Silnika blokada nie dotyczy.
+ *
+ * Tworzymy po skonfigurowaniu silnika, a przed startem jego wątku (szkice
+ * startują od bieżących konfiguracji); niszczymy przed silnikiem.
+ */
+class PatternEditor {
+public:
+  explicit PatternEditor(PatternEngine& eng, ports::IWakeup* wakeup = nullptr)
+    : box_(eng.mailbox()), wakeup_(wakeup) {
+    const PatternEngine& ceng = eng;
+    drafts_.reserve(ceng.num_patterns());
+    for (std::size_t i = 0; i < ceng.num_patterns(); ++i) drafts_.push_back(ceng.pattern(i));
+  }
+  ~PatternEditor() { reclaim(); }
+  PatternEditor(const PatternEditor&) = delete;
+  PatternEditor& operator=(const PatternEditor&) = delete;
+
+  std::size_t size() const { return drafts_.size(); }
+
+  [[nodiscard]] std::unique_lock<std::mutex> lock() { return std::unique_lock<std::mutex>(mu_); }
+
+  PatternConfig&       draft(std::size_t i)       { return drafts_[i]; }
+  const PatternConfig& draft(std::size_t i) const { return drafts_[i]; }
+
+  void publish(std::size_t i, Quantize when = Quantize::Now) {
+    reclaim();
+    auto* snap = new PatternSnapshot{drafts_[i], when};
+    // nieodebrana poprzednia migawka nigdy nie trafiła do silnika – zwalniamy tu
+    delete box_.pending[i].exchange(snap, std::memory_order_acq_rel);
+    if (!box_.published.try_push(static_cast<uint32_t>(i)))
+      box_.rescan.store(true, std::memory_order_release);
+    if (wakeup_) wakeup_->wake();
+  }
+
+  // Zwolnij migawki oddane przez silnik; zwraca ich liczbę
+  std::size_t reclaim() {
+    return box_.retired.drain([](PatternSnapshot* p) { delete p; });
+  }
+
+private:
+  PatternMailbox&            box_;
+  ports::IWakeup*            wakeup_;
+  std::vector<PatternConfig> drafts_;
+  std::mutex                 mu_;
+};
+
+} // namespace core
@@ -1,10 +1,24 @@
 #pragma once
+#include <algorithm>
 #include <array>
+#include <cmath>
 #include <cstdint>
+#include <limits>
+#include <memory>
 #include <optional>
-#include <random>        // na PC; na MCU można podmienić na prosty xorshift
+#include <vector>
 #include "ports/Midi.hpp"
 #include "ports/Clock.hpp"
+#include "core/Transport.hpp"
+#include "core/ChordState.hpp"
+#include "core/ClockSync.hpp"
+#include "core/OffQueue.hpp"
+#include "core/DueIndex.hpp"
+#include "core/OutputBatch.hpp"
+#include "core/Rng.hpp"
+#include "core/SpscRing.hpp"
+#include "core/StepVoice.hpp"
+#include "core/Stats.hpp"
 
 namespace core {
 
@@ -16,14 +30,22 @@ namespace core {
 
 // Maksymalna długość patternu (kroków) – stały bufor (bez alokacji)
 constexpr std::size_t MAX_STEPS     = 64;
-// Maks. liczba zaplanowanych NoteOff w kolejce (globalnie)
-constexpr std::size_t MAX_PENDING_OFFS = 64;
-// Maks. liczba trzymanych nut w akordzie
-constexpr std::size_t MAX_HELD_NOTES   = 8;
+// Min. liczba zaplanowanych NoteOff w kolejce (globalnie) + zapas na każdy pattern.
+// Pattern ma naraz najwyżej kilka wiszących OFF-ów (gate <= 200% + overlap),
+// więc przepełnienie to sytuacja awaryjna.
+constexpr std::size_t MAX_PENDING_OFFS  = 256;
+constexpr std::size_t OFFS_PER_PATTERN  = 8;
+// Lookahead: zmiany (akord, edycja, tempo) nie ruszają najbliższych 2 ms –
+// te komunikaty mogą już być w drodze do urządzenia.
+constexpr uint64_t    LOOKAHEAD_GUARD_US = 2000;
+// Lookahead + zegar zewnętrzny: okno renderujemy od nowa dopiero, gdy oś z PLL
+// odjedzie od osi, z której je policzono, o więcej niż tyle (impuls F8 co ~20 ms
+// poprawia oś o mikrosekundy – to nie powód, by odwoływać całe okno)
+constexpr uint64_t    LOOKAHEAD_RETIME_US = 500;
 
 // Jeden krok patternu – wszystko, czego potrzebujemy na wyjściu
 struct Step {
-  uint8_t note_index = 0;      // 1..8 => indeks w posortowanym akordzie; 0 => REST (cisza)
+  uint8_t note_index = 0;      // 1..128 => indeks w posortowanym akordzie; 0 => REST (cisza)
   uint8_t velocity   = 100;    // 1..127 (siła uderzenia)
   uint8_t gate_pct   = 50;     // 1..200 (% długości kroku; >100% = dłużej niż krok)
   int8_t  octave     = 0;      // transpozycja w oktawach (np. -1..+3)
@@ -36,6 +58,7 @@ struct PatternConfig {
   uint8_t channel  = 1;        // kanał MIDI 1..16
   uint16_t division= 2;        // ile kroków na ćwierćnutę (1=1/4, 2=1/8, 4=1/16)
   std::size_t length = 0;      // ile kroków jest aktywnych w "steps"
+  uint32_t seed = 1;           // ziarno losowania 'probability' (ten sam seed => ta sama sekwencja)
   std::array<Step, MAX_STEPS> steps{};  // stały bufor kroków
 };
 
@@ -43,77 +66,113 @@ struct PatternConfig {
 struct EngineConfig {
   double  bpm = 120.0;         // globalne tempo
   uint8_t overlap_ms = 10;     // ile ms nakładki między nutami (tie/legato)
-  bool    external_clock = false; // (na przyszłość) czy korzystamy z MIDI Clock
+  bool    external_clock = false; // tempo i start/stop z MIDI Clock na wejściu (bpm ignorowane)
+  uint16_t lookahead_ms = 0;   // >0 => renderuj z wyprzedzeniem do paczek (send_batch)
+  uint8_t chord_capacity = MAX_HELD_NOTES; // ile nut akordu naraz (1..128; 128 = cała klawiatura)
 };
 
 /*
- * ======================
- * 2) STAN AKORDU (HELD)
- * ======================
+ * ==================================
+ * 1b) PUBLIKACJA KONFIGURACJI PATTERNÓW
+ * ==================================
  *
- * Złota zasada: trzymamy posortowany rosnąco bufor 8 nut.
- * Indeksowanie 1..8 to po prostu "pozycja+1" w tej tablicy.
+ * Edytor (CLI, UI – wątek nie-RT) nie pisze w konfiguracji, którą czyta tick().
+ * Edytuje własny szkic, a publikuje go jako nową migawkę: alokacja po stronie
+ * edytora, atomowa wymiana wskaźnika w skrzynce, numer patternu pierścieniem.
+ * Silnik zabiera migawkę bez blokad i alokacji; stare migawki wracają
+ * pierścieniem 'retired' do edytora, który je zwalnia – wątek silnika nigdy
+ * nie woła delete. Patrz PatternEditor.hpp.
  */
-class ChordState {
-public:
-  // NoteOn – dodaj nutę do posortowanego bufora (jeśli nie ma duplikatu)
-  void note_on(uint8_t note) {
-    // duplikat? -> nic nie rób
-    for (std::size_t i = 0; i < size_; ++i)
-      if (notes_[i] == note) return;
-
-    if (size_ < notes_.size()) {
-      // wstaw tak, aby była zachowana kolejność rosnąca
-      std::size_t pos = 0;
-      while (pos < size_ && notes_[pos] < note) ++pos;
-      for (std::size_t j = size_; j > pos; --j) notes_[j] = notes_[j-1];
-      notes_[pos] = note;
-      ++size_;
-    }
-  }
 
-  // NoteOff – usuń nutę
-  void note_off(uint8_t note) {
-    for (std::size_t i = 0; i < size_; ++i) {
-      if (notes_[i] == note) {
-        for (std::size_t j = i + 1; j < size_; ++j) notes_[j-1] = notes_[j];
-        --size_;
-        break;
-      }
-    }
-  }
+// Od kiedy opublikowana konfiguracja obowiązuje
+enum class Quantize : uint8_t {
+  Now,    // od razu (lookahead: po guard)
+  Step,   // od najbliższego kroku tego patternu
+  Bar,    // od pierwszego kroku na granicy taktu lub za nią
+};
+constexpr double BEATS_PER_BAR = 4.0;   // 4/4 – takt liczony od pozycji 0 transportu
 
-  // Zwróć MIDI note wg indeksu 1..8 (spec: "indeksowanie nut")
-  std::optional<uint8_t> by_index(uint8_t idx_1based) const {
-    if (idx_1based == 0) return std::nullopt;
-    const std::size_t i = static_cast<std::size_t>(idx_1based - 1);
-    if (i < size_) return notes_[i];
-    return std::nullopt; // indeks wskazuje "pusty slot"
-  }
+struct PatternSnapshot {
+  PatternConfig cfg{};
+  Quantize      when{Quantize::Now};
+};
 
-  std::size_t size() const { return size_; }
-  void clear() { size_ = 0; }
+struct PatternMailbox {
+  static constexpr std::size_t RING = 1024;
 
-private:
-  std::array<uint8_t, MAX_HELD_NOTES> notes_{};
-  std::size_t size_{0};
+  explicit PatternMailbox(std::size_t n) : pending(new std::atomic<PatternSnapshot*>[n]()), size(n) {}
+
+  std::unique_ptr<std::atomic<PatternSnapshot*>[]> pending;   // ostatnia nieodebrana migawka
+  std::size_t size;
+  SpscRing<uint32_t, RING> published;          // edytor -> silnik: które patterny
+  std::atomic<bool> rescan{false};             // pierścień był pełny => przejrzyj wszystkie
+  SpscRing<PatternSnapshot*, RING> retired;    // silnik -> edytor: do zwolnienia
+};
+
+// Podsłuch odebranych publikacji (nagrywanie sesji) – wołany w wątku silnika,
+// w tick(), w kolejności odbioru, zanim migawka trafi do stage_
+struct PatternTap {
+  virtual ~PatternTap() = default;
+  virtual void collected(uint32_t pattern, const PatternSnapshot& snap) = 0;
 };
 
 /*
- * ==========================
- * 3) STAN / PLAYBACK PATTERNU
- * ==========================
+ * ======================
+ * 2) STAN AKORDU (HELD)
+ * ======================
  *
- * Każdy pattern ma własny kursor kroku i własny zegar (harmonogram).
+ * ChordState (128-bitowa maska nut, indeks 1..N rosnąco) – patrz ChordState.hpp.
+ * Ten sam stan akordu trzyma ArpEngine.
+ */
+
+/*
+ * ===========================
+ * 3) STAN / PLAYBACK PATTERNÓW
+ * ===========================
+ *
+ * Każdy pattern ma własny kursor kroku i własny harmonogram na wspólnej osi
+ * Transport: krok nr k wypada na pozycji beat0 + k/division (ćwierćnuty),
+ * a jego czas liczymy z tej pozycji – bez sumowania zaokrąglonych kroków.
  * Dodatkowo przechowujemy ostatnią zagraną nutę, by zrobić overlap (tie).
+ *
+ * Stan trzymamy kolumnami (struktura tablic): przy setkach patternów
+ * krok dotyka tylko potrzebnych pól, a te leżą w pamięci obok siebie.
+ * Rozmiar ustalamy raz (resize) – w trakcie grania nic nie alokuje.
  */
-struct PatternState {
-  // runtime
-  std::size_t step_pos = 0;           // który krok gramy
-  uint64_t    next_step_ms = 0;       // kiedy zagrać następny krok
-  bool        last_on_valid = false;  // czy jakaś nuta tego patternu aktualnie gra
-  uint8_t     last_on_note = 0;       // ostatnio zagrana nuta
-  uint8_t     last_on_ch   = 0;       // na jakim kanale ją graliśmy
+struct PatternLanes {
+  std::vector<uint64_t>  next_step_us;   // kiedy zagrać następny krok
+  std::vector<uint64_t>  step_count;     // numer następnego kroku od beat0
+  std::vector<double>    beat0;          // pozycja (beat) kroku nr 0
+  std::vector<uint16_t>  division;       // division, dla którego liczono beat0
+  std::vector<uint32_t>  step_pos;       // kursor: który krok gramy
+  std::vector<uint8_t>   started;        // czy harmonogram został zakotwiczony
+  std::vector<uint8_t>   last_on_valid;  // czy jakaś nuta tego patternu aktualnie gra
+  std::vector<uint8_t>   last_on_note;   // ostatnio zagrana nuta
+  std::vector<uint8_t>   last_on_ch;     // na jakim kanale ją graliśmy
+  std::vector<OffHandle> last_off;       // jej zaplanowany OFF (do wydłużenia w O(1))
+  std::vector<Pcg32>     rng;            // własny strumień losowań (probability)
+  std::vector<uint32_t>  rng_seed;       // seed, z którego go zasiano
+  std::vector<PatternSnapshot*> cfg;     // obowiązująca konfiguracja (własność silnika)
+  std::vector<PatternSnapshot*> staged;  // opublikowana, czeka na krok/takt
+  std::vector<double>    adopt_beat;     // od kroku na tej pozycji obowiązuje 'staged'
+
+  void resize(std::size_t n) {
+    next_step_us.assign(n, 0);
+    step_count.assign(n, 0);
+    beat0.assign(n, 0.0);
+    division.assign(n, 0);
+    step_pos.assign(n, 0);
+    started.assign(n, 0);
+    last_on_valid.assign(n, 0);
+    last_on_note.assign(n, 0);
+    last_on_ch.assign(n, 0);
+    last_off.assign(n, OffHandle{});
+    rng.assign(n, Pcg32{});
+    rng_seed.assign(n, 0);
+    cfg.assign(n, nullptr);
+    staged.assign(n, nullptr);
+    adopt_beat.assign(n, 0.0);
+  }
 };
 
 /*
@@ -123,140 +182,549 @@ struct PatternState {
  *
  * Zasada działania:
  *  - zbieramy NoteOn/Off z MIDI In i aktualizujemy ChordState,
- *  - w tick() sprawdzamy każdy z 4 patternów: czy pora na krok?
- *    - jeśli tak: bierzemy Step -> mapujemy index->nuta z ChordState,
+ *  - w tick() bierzemy z indeksu terminów (DueIndex) tylko te patterny,
+ *    na które przyszła pora – koszt zależy od liczby kroków do zagrania,
+ *    a nie od liczby patternów:
+ *    - bierzemy Step -> mapujemy index->nuta z ChordState,
  *      stosujemy octave/velocity/gate/probability,
  *      wysyłamy NoteOn i planujemy NoteOff (co najmniej gate, a gdy kolejny ON
  *      przyjdzie wcześniej, wydłużymy OFF o "overlap_ms" = brak dziur).
  *  - kolejka OFF-ów to stały bufor, wysyłamy wszystko co "dojrzało".
+ *
+ * Edycja patternu przez pattern(i) oznacza go jako "dotknięty": przy
+ * najbliższym tick() pattern z length > 0 startuje, pusty – wypada z indeksu.
+ *
+ * Tryb lookahead (EngineConfig::lookahead_ms > 0):
+ *  - tick() renderuje wszystko do now + horyzont do posortowanej paczki
+ *    i oddaje ją wyjściu (send_batch) – backend wysyła każdy komunikat
+ *    w jego chwili, więc czkawka pętli (do wielkości horyzontu) nie psuje rytmu,
+ *  - stan silnika (lanes/due/offs/rng) zostaje w chwili "teraz + guard";
+ *    obok trzymamy drugi stan – "przed nami" – doprowadzony do końca okna.
+ *    Kolejny tick dorenderowuje tylko to, co weszło w horyzont (od emit_from_),
+ *    więc koszt nadal zależy od liczby kroków, a nie od liczby patternów
+ *    i pojemności kolejki OFF-ów; stany zamieniamy miejscami (swap, O(1)),
+ *  - zmiana akordu / edycja / tempo: odwołujemy w wyjściu wszystko po "teraz
+ *    + guard" (cancel_after), stan "przed nami" kopiujemy od nowa ze stanu
+ *    właściwego i okno renderuje się od nowa – zmianę słychać po ~2 ms, a nie
+ *    po całym horyzoncie. Kopia (O(patterny + OFF-y)) tylko przy zmianie.
+ *    Backend bez cancel_after => zmiana od końca okna,
+ *  - MIDI IN unieważnia okno tylko wtedy, gdy coś zmienia: nowa / puszczona
+ *    nuta akordu, Start/Stop, oś z PLL dalej niż LOOKAHEAD_RETIME_US.
+ *    F8 bez takiej zmiany, Active Sensing, CC itp. – okno zostaje.
+ *
+ * Konfiguracja patternów: pattern(i) edytuje bieżącą konfigurację w miejscu –
+ * tylko z wątku silnika (render, benchmarki, wzorce startowe). Z innego wątku
+ * edytujemy przez PatternEditor: publikacje silnik odbiera na początku tick()
+ * i stosuje od razu albo od kroku/taktu (Quantize). Kopia stanu w lookahead
+ * trzyma wskaźniki cfg/staged, więc okno "na próbę" przełącza się na nową
+ * migawkę tak samo jak potem stan właściwy.
+ *
+ * Zewnętrzny zegar (EngineConfig::external_clock):
+ *  - F8/FA/FB/FC/F2 z MIDI IN idą do ClockSync (PLL), który po każdym impulsie
+ *    poprawia oś Transport – kroki liczone z osi leżą między impulsami,
+ *  - patterny grają tylko między Start/Continue a Stop; siatka kroków liczona
+ *    od początku utworu, więc Continue po Song Position trafia w takt.
  */
 class PatternEngine {
 public:
-  static constexpr std::size_t NUM_PATTERNS = 4;
+  static constexpr std::size_t DEFAULT_PATTERNS = 4;
+
+  PatternEngine(ports::IMidiOut& out, const ports::IClock& clock,
+                std::size_t num_patterns = DEFAULT_PATTERNS)
+    : offs_(std::max(MAX_PENDING_OFFS, num_patterns * OFFS_PER_PATTERN)),
+      out_(out), clock_(clock),
+      ahead_{PatternLanes{}, DueIndex{}, OffQueue(offs_.capacity())},
+      batch_(2 * offs_.capacity()),
+      mailbox_(num_patterns) {
+    lanes_.resize(num_patterns);
+    for (auto& c : lanes_.cfg) c = new PatternSnapshot{};
+    retire_backlog_.reserve(2 * num_patterns);
+    due_.reset(num_patterns);
+    ahead_.lanes.resize(num_patterns);
+    ahead_.due.reset(num_patterns);
+    touched_.reserve(num_patterns);
+    touched_flag_.assign(num_patterns, 0);
+    stats_.patterns.resize(num_patterns);
+  }
 
-  PatternEngine(ports::IMidiOut& out, const ports::IClock& clock)
-    : out_(out), clock_(clock), rng_(0xC0FFEE) {}
+  ~PatternEngine() {
+    // edytor (jedyny konsument 'retired') musi już nie istnieć
+    for (auto* p : lanes_.cfg) delete p;
+    for (auto* p : lanes_.staged) delete p;
+    for (std::size_t i = 0; i < mailbox_.size; ++i) delete mailbox_.pending[i].exchange(nullptr);
+    mailbox_.retired.drain([](PatternSnapshot* p) { delete p; });
+    for (auto* p : retire_backlog_) delete p;
+  }
+  PatternEngine(const PatternEngine&) = delete;
+  PatternEngine& operator=(const PatternEngine&) = delete;
+
+  std::size_t num_patterns() const { return lanes_.cfg.size(); }
 
   // Konfiguracje (globalna + dla każdego patternu)
-  void set_engine_config(const EngineConfig& ec) { eng_ = ec; }
-  PatternConfig& pattern(std::size_t i) { return patterns_[i]; }         // konfiguracja
-  const PatternConfig& pattern(std::size_t i) const { return patterns_[i]; }
-  PatternState& state(std::size_t i) { return states_[i]; }               // stan runtime
+  void set_engine_config(const EngineConfig& ec) {
+    before_change_();
+    const uint64_t at = lookahead_() ? state_us_ : clock_.now_us();
+    const bool was_lookahead = lookahead_();
+    const bool was_external = eng_.external_clock;
+    eng_ = ec;
+    chord_.set_capacity(ec.chord_capacity);
+    if (!was_lookahead && lookahead_()) { ahead_next_ = 0; ahead_valid_ = false; }   // okno od razu
+    if (eng_.external_clock) {
+      // przejście na zegar zewnętrzny: stoimy do najbliższego Start/Continue
+      if (!was_external && !ext_.running()) park_all_();
+      return;
+    }
+    transport_.set_bpm(ec.bpm, at);
+    retime_();
+  }
+  const EngineConfig& engine_config() const { return eng_; }
+  // Tempo od chwili at_us (zamiast "teraz"). Kilka silników z tą samą parą
+  // (bpm, at_us) ma dalej identyczną oś beatów – tak synchronizuje je ShardHost.
+  void set_bpm_at(double bpm, uint64_t at_us) {
+    before_change_();
+    if (lookahead_() && at_us < state_us_) at_us = state_us_;   // to, co przed stanem, już wyszło
+    eng_.bpm = bpm;
+    if (eng_.external_clock) return;
+    transport_.set_bpm(bpm, at_us);
+    retime_();
+  }
+
+  // Edycja w miejscu – tylko z wątku silnika (inaczej: PatternEditor)
+  PatternConfig& pattern(std::size_t i) { before_change_(); touch_(i); return lanes_.cfg[i]->cfg; }
+  const PatternConfig& pattern(std::size_t i) const { return lanes_.cfg[i]->cfg; }
+
+  // Skrzynka publikacji dla PatternEditor
+  PatternMailbox& mailbox() { return mailbox_; }
+  // Podsłuch odbioru publikacji (nullptr => brak); ustaw przed startem pętli
+  void set_pattern_tap(PatternTap* tap) { pattern_tap_ = tap; }
 
-  // MIDI IN -> aktualizuj akord
+  // MIDI IN -> aktualizuj akord.
+  // Jeśli komunikat ma znacznik przyjścia, najpierw dogrywamy wszystko, co było
+  // zaplanowane PRZED nim – zmiana akordu działa od realnej chwili przyjścia,
+  // a nie od chwili, w której pętla zdążyła go odebrać.
+  // (Lookahead: zmiana działa od "teraz + guard" – wcześniejsze komunikaty już poszły.)
   void on_midi_in(const ports::MidiMsg& m) {
+    if (!lookahead_() && m.t_us) advance_(m.t_us, clock_.now_us());
+
+    if (eng_.external_clock && m.status >= 0xF0) { on_clock_(m); return; }
+
     const uint8_t status = (m.status & 0xF0);
-    const uint8_t note   = m.data1;
-    const uint8_t vel    = m.data2;
-    (void)vel; // w tej wersji velocity wejściowe nie jest używane (krok je nadpisuje)
+    const uint8_t note   = m.data1 & 0x7F;
+    const uint8_t vel    = m.data2;   // zapamiętane w akordzie; krok i tak ma własne
 
+    // lookahead: okno od nowa tylko przy faktycznej zmianie akordu
     if (status == 0x90 && vel > 0) {
-      chord_.note_on(note);
+      if (chord_.contains(note) || chord_.size() >= chord_.capacity()) return;
+      before_change_();
+      chord_.note_on(note, vel);
     } else if (status == 0x80 || (status == 0x90 && vel == 0)) {
+      if (!chord_.contains(note)) return;
+      before_change_();
       chord_.note_off(note);
     }
   }
 
-  // Główna pętla czasu – wołaj często (np. co 1 ms)
+  // Najbliższy termin pracy silnika: najwcześniejszy OFF albo następny krok.
+  // Pętla może spać do tej chwili (nullopt => nic nie jest zaplanowane).
+  // (Lookahead: chwila, w której trzeba dorenderować okno.)
+  std::optional<uint64_t> next_deadline_us() const {
+    if (!touched_.empty()) return 0;            // edycja czeka na obsłużenie – od razu
+    if (lookahead_()) {
+      if (!ahead_next_) return std::nullopt;
+      return *ahead_next_ > horizon_us_() ? *ahead_next_ - horizon_us_() : 0;
+    }
+    return state_deadline_();
+  }
+
+  // Główna pętla czasu – wołaj w terminie z next_deadline_us() (albo po prostu często)
   void tick() {
-    const uint64_t now = clock_.now_ms();
+    collect_published_();
+    const uint64_t now = clock_.now_us();
+    if (lookahead_()) render_ahead_(now);
+    else              advance_(now, now);
+  }
 
-    // 1) wyślij wszystkie NoteOff, które są już „po czasie”
-    flush_due_offs_(now);
+  // Statystyki czasu (spóźnienia wysyłki, nadrabiane kroki, przepełnienia OFF-ów)
+  const EngineStats& stats() const { return stats_; }
+  void reset_stats() { stats_.reset(); }
+
+  // Stan śledzenia zewnętrznego zegara (tempo, faza, pozycja)
+  const ClockSync& clock_sync() const { return ext_; }
 
-    // 2) dla każdego patternu, jeśli pora – zrób krok
-    for (std::size_t i = 0; i < NUM_PATTERNS; ++i) {
-      auto& cfg = patterns_[i];
-      auto& st  = states_[i];
+private:
+  // Wykonaj całą pracę zaplanowaną do chwili 'now' włącznie.
+  // sent_us = faktyczny czas zegara (do statystyk; przy MIDI IN now <= sent_us).
+  void advance_(uint64_t now, uint64_t sent_us) {
+    sent_us_ = sent_us;
 
-      if (cfg.length == 0) continue; // pattern pusty
-      if (st.next_step_ms == 0) st.next_step_ms = now; // inicjalizacja
+    // 1) wyślij wszystkie NoteOff, które są już „po czasie”
+    flush_due_offs_(now);
 
-      while (now >= st.next_step_ms) {
-        do_pattern_step_(cfg, st, now);
-        // policz długość kroku z BPM i division patternu
-        const uint64_t step_ms = step_ms_for_(cfg.division);
-        st.next_step_ms += step_ms;
+    // 2) uruchom/zatrzymaj patterny zmienione od ostatniego razu
+    apply_touched_(now);
+
+    // 3) kroki – tylko patterny, na które przyszła pora (w kolejności czasu)
+    while (!due_.empty() && due_.top_time() <= now) {
+      const uint32_t i = due_.top_id();
+      if (lanes_.staged[i] && step_beat_(i, lanes_.step_count[i]) >= lanes_.adopt_beat[i] - 1e-9) adopt_(i);
+      const auto& cfg = lanes_.cfg[i]->cfg;
+
+      if (cfg.length == 0) { park_(i); continue; }       // pattern opróżniony
+      if (lanes_.division[i] != cfg.division) rebase_(i, cfg.division);
+
+      do_pattern_step_(cfg, i, lanes_.next_step_us[i]);
+      // czas kolejnego kroku liczony z jego pozycji (bez kumulacji błędu)
+      ++lanes_.step_count[i];
+      lanes_.next_step_us[i] = step_time_(i, lanes_.step_count[i]);
+      due_.set(i, lanes_.next_step_us[i]);
+      // kolejny krok też już minął => pętla nadrabia zaległości
+      // (względem zegara – render z wyprzedzeniem to nie spóźnienie)
+      // (lookahead: tylko to, co idzie na wyjście – ten sam krok liczą oba stany)
+      if (lanes_.next_step_us[i] <= std::min(now, sent_us_) && emits_(lanes_.next_step_us[i])) {
+        ++stats_.late_steps;
+        ++stats_.patterns[i].late_steps;
       }
     }
+
+    // bez lookahead: wszystko z tego przebiegu jedną paczką (backend łączy zapis)
+    if (emit_ == Emit::Direct) flush_batch_();
   }
 
-private:
   // =============== Pamięć / stan ===============
   EngineConfig eng_{};
-  std::array<PatternConfig, NUM_PATTERNS> patterns_{};
-  std::array<PatternState,  NUM_PATTERNS> states_{};
+  PatternLanes lanes_{};                 // stan runtime (gorący, kolumnami) + konfiguracja
+  DueIndex     due_{};                   // grające patterny wg terminu kroku
+  std::vector<uint32_t> touched_;        // patterny do sprawdzenia po edycji
+  std::vector<uint8_t>  touched_flag_;
   ChordState chord_{};
+  Transport  transport_{};
+  ClockSync  ext_{};   // zewnętrzny zegar (PLL)
 
-  struct PendingOff { uint64_t at_ms; uint8_t ch; uint8_t note; };
-  std::array<PendingOff, MAX_PENDING_OFFS> off_q_{};
-  std::size_t off_count_{0};
+  OffQueue   offs_;                     // zaplanowane NoteOff (kopiec wg czasu)
 
   ports::IMidiOut&     out_;
   const ports::IClock& clock_;
-  std::mt19937         rng_;  // PC: OK. MCU: wymień na xorshift/LCG
+
+  EngineStats stats_{};
+  uint64_t    sent_us_{0};    // zegar w bieżącym advance_ (moment faktycznej wysyłki)
+
+  // Lookahead: stan "przed nami" (koniec okna) + paczka wyjściowa
+  struct Snapshot {
+    PatternLanes lanes;
+    DueIndex     due;
+    OffQueue     offs;
+  };
+  // Direct: paczka jednego przebiegu advance_, wysłana na jego końcu (bez lookahead)
+  // Batch:  okno lookahead – wysyła advance_state_/render_ahead_
+  enum class Emit : uint8_t { Direct, Batch };
+  Snapshot    ahead_;
+  OutputBatch batch_;
+  Emit        emit_{Emit::Direct};
+  uint64_t    state_us_{0};   // do tej chwili (włącznie) doszedł stan silnika
+  uint64_t    emit_from_{0};  // komunikaty < emit_from_ już są w paczkach
+  std::optional<uint64_t> ahead_next_{};  // pierwszy termin za wyrenderowanym oknem
+  uint64_t    ahead_us_{0};               // do tej chwili doszedł stan "przed nami"
+  bool        ahead_valid_{false};        // false => skopiuj go ze stanu właściwego
+  bool        rendering_ahead_{false};    // advance_ liczy okno na stanie "przed nami"
+
+  // Publikacje z PatternEditor
+  PatternMailbox mailbox_;
+  std::vector<PatternSnapshot*> retire_backlog_;  // pierścień 'retired' był pełny
+  PatternTap*    pattern_tap_{nullptr};
+
+  // =============== Lookahead ===============
+
+  bool     lookahead_()  const { return eng_.lookahead_ms > 0; }
+  uint64_t horizon_us_() const { return static_cast<uint64_t>(eng_.lookahead_ms) * 1000; }
+
+  std::optional<uint64_t> state_deadline_() const {
+    std::optional<uint64_t> dl = offs_.next_time();
+    if (!due_.empty() && (!dl || due_.top_time() < *dl)) dl = due_.top_time();
+    return dl;
+  }
+
+  // Stan "przed nami" := stan właściwy (kopia do zarezerwowanych buforów – bez alokacji)
+  void copy_ahead_() { ahead_.lanes = lanes_; ahead_.due = due_; ahead_.offs = offs_; }
+  // Zamiana ról: advance_ pracuje na lanes_/due_/offs_, więc okno liczymy na zamienionych
+  void swap_ahead_() {
+    std::swap(lanes_, ahead_.lanes);
+    std::swap(due_, ahead_.due);
+    std::swap(offs_, ahead_.offs);
+  }
+
+  // Przesuń stan silnika do chwili t; do paczki idzie tylko to, czego w niej jeszcze nie było
+  void advance_state_(uint64_t t, uint64_t now) {
+    if (t < state_us_) t = state_us_;
+    emit_ = Emit::Batch;
+    advance_(t, now);
+    emit_ = Emit::Direct;
+    state_us_ = t;
+    if (t + 1 > emit_from_) emit_from_ = t + 1;
+    flush_batch_();
+  }
+
+  void sync_(uint64_t now) {
+    advance_state_(now + std::min(LOOKAHEAD_GUARD_US, horizon_us_()), now);
+  }
+
+  // Okno do now + horyzont: stan "przed nami" dorenderowany od miejsca, w którym
+  // skończył poprzednio (po zmianie – od nowa ze stanu właściwego); stan właściwy
+  // idzie tylko do "teraz + guard" i nic nie wysyła (tamte komunikaty już poszły)
+  void render_ahead_(uint64_t now) {
+    sync_(now);
+    if (!ahead_valid_ || ahead_us_ < state_us_) {        // po zmianie / pętla zaspała ponad okno
+      copy_ahead_();
+      ahead_us_ = state_us_;
+      ahead_valid_ = true;
+    }
+    const uint64_t end = now + horizon_us_();
+    swap_ahead_();
+    emit_ = Emit::Batch;
+    rendering_ahead_ = true;
+    if (end > ahead_us_) { advance_(end, now); ahead_us_ = end; }
+    rendering_ahead_ = false;
+    emit_ = Emit::Direct;
+    if (end + 1 > emit_from_) emit_from_ = end + 1;
+    ahead_next_ = state_deadline_();
+    swap_ahead_();
+    flush_batch_();
+  }
+
+  // Przed zmianą wejścia/konfiguracji: stan do "teraz + guard", reszta okna do odwołania
+  void before_change_() {
+    if (!lookahead_()) return;
+    sync_(clock_.now_us());
+    if (emit_from_ > state_us_ + 1) {
+      if (out_.cancel_after(state_us_)) emit_from_ = state_us_ + 1;
+      else advance_state_(emit_from_ - 1, clock_.now_us());   // zmiana od końca okna
+    }
+    ahead_next_ = 0;
+    ahead_valid_ = false;
+  }
+
+  // Zegar zewnętrzny + lookahead: czy oś z PLL odjechała od osi okna (na jego końcach)?
+  bool axis_moved_() const {
+    Transport pll = transport_;
+    ext_.apply_to(pll);
+    for (const uint64_t t : {state_us_, emit_from_}) {
+      const uint64_t u = pll.time_at(transport_.beat_at(t));
+      if ((u > t ? u - t : t - u) > LOOKAHEAD_RETIME_US) return true;
+    }
+    return false;
+  }
+
+  bool emits_(uint64_t t) const { return emit_ == Emit::Direct || t >= emit_from_; }
+
+  void flush_batch_() {
+    if (batch_.empty()) return;
+    out_.send_batch(batch_.data(), batch_.size());
+    batch_.clear();
+  }
+
+  void emit_msg_(const ports::MidiMsg& m) {
+    if (emit_ == Emit::Batch && m.t_us < emit_from_) return;   // już wysłane we wcześniejszej paczce
+    if (!batch_.push(m)) { flush_batch_(); batch_.push(m); }
+  }
 
   // =============== Narzędzia ===============
 
-  uint64_t step_ms_for_(uint16_t division) const {
-    // ćwierćnuta [ms] = 60000 / BPM
-    const double q_ms = 60000.0 / (eng_.bpm > 0 ? eng_.bpm : 120.0);
-    // długość kroku = ćwierćnuta / division
-    uint64_t ms = static_cast<uint64_t>(q_ms / (division > 0 ? division : 2));
-    return ms == 0 ? 1 : ms;
+  static double div_or_default_(uint16_t division) {
+    return static_cast<double>(division > 0 ? division : 2);
   }
 
-  bool chance_(uint8_t probability_0_100) {
-    if (probability_0_100 >= 100) return true;
-    if (probability_0_100 == 0)   return false;
-    std::uniform_int_distribution<int> d(1,100);
-    return d(rng_) <= probability_0_100;
+  // Pozycja (beat) kroku nr k – długość kroku = ćwierćnuta / division
+  double step_beat_(uint32_t i, uint64_t k) const {
+    return lanes_.beat0[i] + static_cast<double>(k) / div_or_default_(lanes_.division[i]);
   }
 
-  // Zaplanuj NoteOff w stałym buforze (bez alokacji)
-  void schedule_off_(uint64_t at_ms, uint8_t ch, uint8_t note) {
-    if (off_count_ < off_q_.size()) {
-      off_q_[off_count_++] = PendingOff{at_ms, ch, note};
+  uint64_t step_time_(uint32_t i, uint64_t k) const {
+    return transport_.time_at(step_beat_(i, k));
+  }
+
+  // Zmiana division: zaplanowany krok zostaje na miejscu, od niego liczymy nową siatkę
+  void rebase_(uint32_t i, uint16_t new_division) {
+    lanes_.beat0[i]      = step_beat_(i, lanes_.step_count[i]);
+    lanes_.step_count[i] = 0;
+    lanes_.division[i]   = new_division;
+  }
+
+  // Po zmianie osi Transport: przelicz czasy zaplanowanych kroków (pozycje się nie zmieniają)
+  void retime_() {
+    for (uint32_t i = 0; i < lanes_.started.size(); ++i) {
+      if (!lanes_.started[i]) continue;
+      lanes_.next_step_us[i] = step_time_(i, lanes_.step_count[i]);
+      if (due_.contains(i)) due_.set(i, lanes_.next_step_us[i]);
+    }
+  }
+
+  // Komunikaty systemowe czasu rzeczywistego przy zegarze zewnętrznym
+  void on_clock_(const ports::MidiMsg& m) {
+    using Ev = ClockSync::Event;
+    switch (ext_.on_message(m)) {
+      case Ev::Tempo:
+        if (lookahead_() && !axis_moved_()) break;       // okno zostaje na dotychczasowej osi
+        before_change_();
+        ext_.apply_to(transport_);
+        retime_();
+        break;
+      case Ev::Started: {
+        before_change_();
+        ext_.apply_to(transport_);
+        const double pos = ext_.position_beats();
+        for (uint32_t i = 0; i < lanes_.cfg.size(); ++i) {
+          touched_flag_[i] = 0;
+          const auto& cfg = lanes_.cfg[i]->cfg;
+          if (cfg.length == 0) { park_(i); continue; }
+          // siatka od początku utworu; pierwszy krok = pierwszy nie wcześniej niż pozycja
+          const double div = div_or_default_(cfg.division);
+          const auto k = static_cast<uint64_t>(std::ceil(pos * div - 1e-9));
+          lanes_.started[i]      = 1;
+          reseed_(i);
+          lanes_.beat0[i]        = 0.0;
+          lanes_.division[i]     = cfg.division;
+          lanes_.step_count[i]   = k;
+          lanes_.step_pos[i]     = static_cast<uint32_t>(k % cfg.length);
+          lanes_.next_step_us[i] = step_time_(i, k);
+          due_.set(i, lanes_.next_step_us[i]);
+        }
+        touched_.clear();
+      } break;
+      case Ev::Stopped:
+        before_change_();
+        park_all_();
+        break;
+      case Ev::Position:
+      case Ev::None:
+        break;
+    }
+  }
+
+  // =============== Publikacje (PatternEditor) ===============
+
+  // Odbierz opublikowane migawki (wątek silnika, bez blokad i alokacji)
+  void collect_published_() {
+    if (!retire_backlog_.empty()) flush_retired_();
+    bool changed = false;
+    const auto take = [&](uint32_t i) {
+      if (i >= lanes_.cfg.size()) return;
+      PatternSnapshot* p = mailbox_.pending[i].exchange(nullptr, std::memory_order_acq_rel);
+      if (!p) return;
+      if (pattern_tap_) pattern_tap_->collected(i, *p);
+      if (!changed) { before_change_(); changed = true; }   // lookahead: okno od nowa
+      stage_(i, p);
+    };
+    mailbox_.published.drain(take);
+    if (mailbox_.rescan.exchange(false, std::memory_order_acq_rel))
+      for (uint32_t i = 0; i < lanes_.cfg.size(); ++i) take(i);
+  }
+
+  void stage_(uint32_t i, PatternSnapshot* p) {
+    if (lanes_.staged[i]) retire_(lanes_.staged[i]);     // nowsza publikacja wygrywa
+    lanes_.staged[i] = p;
+    if (p->when == Quantize::Now || !lanes_.started[i]) {
+      adopt_(i);
+      touch_(i);                                         // start / park jak po edycji
+      return;
+    }
+    if (p->when == Quantize::Step) {
+      lanes_.adopt_beat[i] = -std::numeric_limits<double>::infinity();
     } else {
-      // awaryjnie – wyślij od razu (nie gub nut)
-      send_off_(ch, note, at_ms);
+      const double beat = transport_.beat_at(lookahead_() ? state_us_ : clock_.now_us());
+      lanes_.adopt_beat[i] = std::ceil(beat / BEATS_PER_BAR - 1e-9) * BEATS_PER_BAR;
     }
   }
 
-  // Wydłuż NoteOff ostatniej nuty tego patternu, jeśli istnieje w kolejce
-  void extend_last_off_(uint8_t ch, uint8_t note, uint64_t new_time) {
-    for (std::size_t i = off_count_; i > 0; --i) {
-      auto& p = off_q_[i-1];
-      if (p.ch == ch && p.note == note) {
-        if (p.at_ms < new_time) p.at_ms = new_time;
-        return;
+  // staged => obowiązująca. W oknie "na próbę" bez zwalniania – kopia stanu wróci.
+  void adopt_(uint32_t i) {
+    if (!rendering_ahead_) retire_(lanes_.cfg[i]);
+    lanes_.cfg[i] = lanes_.staged[i];
+    lanes_.staged[i] = nullptr;
+  }
+
+  void retire_(PatternSnapshot* p) {
+    if (!mailbox_.retired.try_push(p)) retire_backlog_.push_back(p);   // w rezerwie (2 na pattern)
+  }
+  void flush_retired_() {
+    std::size_t k = 0;
+    while (k < retire_backlog_.size() && mailbox_.retired.try_push(retire_backlog_[k])) ++k;
+    retire_backlog_.erase(retire_backlog_.begin(), retire_backlog_.begin() + static_cast<std::ptrdiff_t>(k));
+  }
+
+  void touch_(std::size_t i) {
+    if (touched_flag_[i]) return;
+    touched_flag_[i] = 1;
+    touched_.push_back(static_cast<uint32_t>(i));  // mieści się w rezerwie
+  }
+
+  void apply_touched_(uint64_t now) {
+    for (const uint32_t i : touched_) {
+      touched_flag_[i] = 0;
+      const auto& cfg = lanes_.cfg[i]->cfg;
+      if (cfg.length == 0) {
+        if (lanes_.started[i]) park_(i);
+      } else if (!lanes_.started[i] && (!eng_.external_clock || ext_.running())) {
+        // start: kotwica harmonogramu = bieżąca pozycja transportu
+        lanes_.started[i]      = 1;
+        reseed_(i);
+        lanes_.beat0[i]        = transport_.beat_at(now);
+        lanes_.step_count[i]   = 0;
+        lanes_.division[i]     = cfg.division;
+        lanes_.next_step_us[i] = now;
+        due_.set(i, now);
       }
     }
+    touched_.clear();
+  }
+
+  // Pattern bez kroków wypada z indeksu; po ponownym wypełnieniu startuje od nowa
+  void park_(uint32_t i) {
+    due_.remove(i);
+    lanes_.started[i] = 0;
+  }
+  void park_all_() {
+    for (uint32_t i = 0; i < lanes_.started.size(); ++i) park_(i);
+  }
+
+  // Losowania patternu i zależą tylko od jego seeda i numeru (strumień) –
+  // edycja innego patternu nie przesuwa jego sekwencji. Start = od początku sekwencji.
+  void reseed_(uint32_t i) {
+    const uint32_t seed = lanes_.cfg[i]->cfg.seed;
+    lanes_.rng[i].seed(seed, i);
+    lanes_.rng_seed[i] = seed;
+  }
+
+  // Zaplanuj NoteOff w stałym buforze (bez alokacji)
+  // (pełna kolejka to sytuacja awaryjna – liczymy ją w statystykach)
+  OffHandle schedule_off_(uint64_t at_us, uint8_t ch, uint8_t note, uint64_t now, uint32_t pat) {
+    return schedule_off(offs_, at_us, ch, note, pat, [&](const OffQueue::Entry& e) {
+      send_off_(e.ch, e.note, now);
+      ++stats_.off_overflows;
+    });
   }
 
-  // Wyślij i przepchnij kolejkę OFF-ów
+  // Wyślij wszystkie OFF-y, które „dojrzały” (kolejno wg czasu, znacznik = termin)
   void flush_due_offs_(uint64_t now) {
-    std::size_t w = 0;
-    for (std::size_t r = 0; r < off_count_; ++r) {
-      const auto& p = off_q_[r];
-      if (p.at_ms <= now) {
-        send_off_(p.ch, p.note, now);
-      } else {
-        off_q_[w++] = p;
-      }
-    }
-    off_count_ = w;
+    offs_.pop_due(now, [&](const auto& p){
+      send_off_(p.ch, p.note, p.at_us);
+      if (!emits_(p.at_us)) return;
+      const auto late = static_cast<int64_t>(sent_us_ - p.at_us);
+      stats_.off_late.record(late);
+      stats_.patterns[p.tag].off_late.record(late);
+    });
   }
 
-  // Realny „krok” patternu
-  void do_pattern_step_(const PatternConfig& cfg, PatternState& st, uint64_t now) {
-    const Step& s = cfg.steps[st.step_pos % cfg.length];
-    st.step_pos = (st.step_pos + 1) % cfg.length;
+  // Realny „krok” patternu i (t_step = zaplanowany czas kroku na siatce)
+  void do_pattern_step_(const PatternConfig& cfg, uint32_t i, uint64_t t_step) {
+    uint32_t& pos = lanes_.step_pos[i];
+    if (pos >= cfg.length) pos = 0;              // pattern skrócony w trakcie
+    const Step& s = cfg.steps[pos];
+    pos = (pos + 1 < cfg.length) ? pos + 1 : 0;
 
     if (!s.enabled) return;
-    if (!chance_(s.probability)) return;
+    if (cfg.seed != lanes_.rng_seed[i]) reseed_(i);   // zmieniony seed w trakcie grania
+    if (!lanes_.rng[i].chance(s.probability)) return;
 
-    // Mapowanie indeksu -> nuta MIDI (1..8)
+    // Mapowanie indeksu -> nuta MIDI (1..rozmiar akordu)
     const auto base_opt = chord_.by_index(s.note_index);
     if (!base_opt.has_value()) {
       // indeks pusty (np. mniejszy akord) – nic nie gramy
@@ -264,45 +732,40 @@ private:
     }
 
     // Transpozycja o oktawy
-    int note_i = static_cast<int>(*base_opt) + 12 * static_cast<int>(s.octave);
-    if (note_i < 0)   note_i = 0;
-    if (note_i > 127) note_i = 127;
-    const uint8_t note = static_cast<uint8_t>(note_i);
+    const uint8_t note = transpose(*base_opt, s.octave);
 
-    // Kanał i czasy
+    // Kanał i czasy – koniec gate liczony z pozycji muzycznej (gate% kroku);
+    // legato/overlap jak w ArpEngine (StepVoice.hpp)
     const uint8_t ch = static_cast<uint8_t>((cfg.channel - 1) & 0x0F);
-    const uint64_t step_ms = step_ms_for_(cfg.division);
-    const uint64_t gate_ms = std::max<uint64_t>(1, step_ms * (s.gate_pct < 1 ? 1 : s.gate_pct) / 100);
-
-    // Legato/overlap – żeby nie było dziur:
-    // - minimalnie trzymaj nutę 'gate_ms'
-    // - gdy zaraz zagramy następną nutę, OFF wydłużamy do (teraz + overlap)
-    const uint64_t on_at  = now;
-    const uint64_t min_off= on_at + gate_ms;
-    const uint64_t off_at = min_off + static_cast<uint64_t>(eng_.overlap_ms);
+    const double  gate_beats = (s.gate_pct < 1 ? 1 : s.gate_pct) / 100.0 / div_or_default_(lanes_.division[i]);
+    const uint64_t gate_end  = transport_.time_at(step_beat_(i, lanes_.step_count[i]) + gate_beats);
+    const NoteSpan span = legato_span(t_step, gate_end, static_cast<uint64_t>(eng_.overlap_ms) * 1000);
+    const uint64_t on_at = span.on_at;
 
     // Jeśli poprzednia nuta tego patternu gra – wydłuż jej OFF do "teraz + overlap"
-    if (st.last_on_valid) {
-      extend_last_off_(st.last_on_ch, st.last_on_note, on_at + static_cast<uint64_t>(eng_.overlap_ms));
-    }
+    // (uchwyt wskazuje dokładnie ten OFF; jeśli już poszedł — nic się nie dzieje)
+    if (lanes_.last_on_valid[i]) offs_.extend(lanes_.last_off[i], span.prev_off_at);
 
     // Wyślij ON i zaplanuj OFF
     send_on_(ch, note, s.velocity, on_at);
-    schedule_off_(off_at, ch, note);
+    if (emits_(on_at)) {
+      const auto late = static_cast<int64_t>(sent_us_ - on_at);
+      stats_.on_late.record(late);
+      stats_.patterns[i].on_late.record(late);
+    }
+    lanes_.last_off[i] = schedule_off_(span.off_at, ch, note, t_step, i);
 
-    st.last_on_valid = true;
-    st.last_on_ch    = ch;
-    st.last_on_note  = note;
+    lanes_.last_on_valid[i] = 1;
+    lanes_.last_on_ch[i]    = ch;
+    lanes_.last_on_note[i]  = note;
   }
 
   // MIDI wyjście
   void send_on_(uint8_t ch, uint8_t note, uint8_t vel, uint64_t t) {
-    ports::MidiMsg m{ static_cast<uint8_t>(0x90 | ch), note, vel, t };
-    out_.send(m);
+    emit_msg_(ports::MidiMsg{ static_cast<uint8_t>(0x90 | ch), note, vel, t });
   }
   void send_off_(uint8_t ch, uint8_t note, uint64_t t) {
-    ports::MidiMsg m{ static_cast<uint8_t>(0x80 | ch), note, 0, t };
-    out_.send(m);
+    emit_msg_(ports::MidiMsg{ static_cast<uint8_t>(0x80 | ch), note, 0, t });
   }
 };
 
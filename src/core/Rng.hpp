@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+
+namespace core {
+
+/*
+ * Pcg32 – mały generator liczb losowych (PCG-XSH-RR, 64-bit stan, 32-bit wynik).
+ *
+ * 16 bajtów stanu zamiast ~5 KB mt19937, kilka instrukcji na losowanie,
+ * bez alokacji i bez <random> – to samo na PC i na MCU. Wynik zależy tylko
+ * od (seed, stream): ten sam seed => bit w bit ta sama sekwencja.
+ * Różne strumienie (np. numer patternu) dają niezależne sekwencje przy tym
+ * samym seedzie.
+ */
+class Pcg32 {
+public:
+  Pcg32() { seed(0, 0); }
+  Pcg32(uint64_t s, uint64_t stream) { seed(s, stream); }
+
+  void seed(uint64_t s, uint64_t stream) {
+    state_ = 0;
+    inc_   = (stream << 1) | 1u;               // przyrost musi być nieparzysty
+    (void)next();
+    state_ += s;
+    (void)next();
+  }
+
+  uint32_t next() {
+    const uint64_t old = state_;
+    state_ = old * 6364136223846793005ULL + inc_;
+    const auto xorshifted = static_cast<uint32_t>(((old >> 18) ^ old) >> 27);
+    const auto rot        = static_cast<uint32_t>(old >> 59);
+    return (xorshifted >> rot) | (xorshifted << ((32u - rot) & 31u));
+  }
+
+  // true z szansą percent/100 (0 => nigdy, >= 100 => zawsze, bez losowania).
+  // Mnożenie i przesunięcie zamiast dzielenia: (r * 100) >> 32 jest równomierne w 0..99.
+  bool chance(uint8_t percent) {
+    if (percent >= 100) return true;
+    if (percent == 0)   return false;
+    return ((static_cast<uint64_t>(next()) * 100u) >> 32) < percent;
+  }
+
+private:
+  uint64_t state_{0};
+  uint64_t inc_{1};
+};
+
+} // namespace core
@@ -0,0 +1,85 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace core {
+
+// Rozmiar linii cache (x86/ARM A-class). Stała zamiast
+// std::hardware_destructive_interference_size – ta zależy od flag kompilatora.
+constexpr std::size_t CACHE_LINE = 64;
+
+/*
+ * SpscRing – kolejka jeden-producent / jeden-konsument, bez blokad i alokacji.
+ *
+ *  - stała pojemność N (potęga dwójki, indeksy liczone maską),
+ *  - push/pop są wait-free: jedna para load/store atomowych, bez CAS,
+ *  - indeksy producenta i konsumenta leżą w osobnych liniach cache
+ *    (plus lokalne kopie indeksu drugiej strony – mniej ruchu między rdzeniami).
+ *
+ * Polityka przepełnienia: odrzucamy NOWY element (try_push zwraca false)
+ * i liczymy odrzuty w dropped(). Starszych danych nie nadpisujemy –
+ * producent nie może bezpiecznie ruszać slotów, które czyta konsument.
+ */
+template<class T, std::size_t N>
+class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing: N musi być potęgą dwójki");
+public:
+  static constexpr std::size_t capacity() { return N; }
+
+  // ── strona producenta ───────────────────────────────────────────────────
+  bool try_push(const T& v) {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_cache_ == N) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (tail - head_cache_ == N) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+      }
+    }
+    buf_[tail & (N - 1)] = v;
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // ── strona konsumenta ───────────────────────────────────────────────────
+  std::optional<T> try_pop() {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_cache_) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (head == tail_cache_) return std::nullopt;
+    }
+    T v = buf_[head & (N - 1)];
+    head_.store(head + 1, std::memory_order_release);
+    return v;
+  }
+
+  // Zdejmij wszystko, co jest w tej chwili (bez czekania); zwraca liczbę elementów
+  template<class F>
+  std::size_t drain(F&& fn) {
+    std::size_t n = 0;
+    while (auto v = try_pop()) { fn(*v); ++n; }
+    return n;
+  }
+
+  // ── obie strony (wartości przybliżone przy współbieżności) ──────────────
+  bool empty() const {
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+  }
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  // producent
+  alignas(CACHE_LINE) std::atomic<std::size_t> tail_{0};
+  std::size_t head_cache_{0};
+  std::atomic<uint64_t> dropped_{0};
+  // konsument
+  alignas(CACHE_LINE) std::atomic<std::size_t> head_{0};
+  std::size_t tail_cache_{0};
+  // dane
+  alignas(CACHE_LINE) std::array<T, N> buf_{};
+};
+
+} // namespace core
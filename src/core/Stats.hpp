@@ -0,0 +1,167 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "ports/Clock.hpp"
+#include "ports/Midi.hpp"
+
+namespace core {
+
+/*
+ * LatencyHistogram – spóźnienie wysyłki (faktyczny czas - zaplanowany), w µs.
+ *
+ * Kubełki o stałych granicach, potęgi dwójki: [0,1) [1,2) [2,4) ... [2^(N-2), ∞).
+ * record() to kilka instrukcji bez alokacji – można wołać na każdej nucie.
+ * Wysyłki przed czasem (ujemne spóźnienie) liczymy osobno w early().
+ *
+ * Jeden pisarz (wątek wysyłający), czytać wolno z innego wątku: liczniki są
+ * atomowe, ale zapis to zwykłe load+store (relaxed) – na x86/ARM zwykły mov.
+ */
+class LatencyHistogram {
+public:
+  static constexpr std::size_t BUCKETS = 22;    // ostatni kubełek: >= ~1 s
+
+  LatencyHistogram() = default;
+  LatencyHistogram(const LatencyHistogram& o) { copy_(o); }
+  LatencyHistogram& operator=(const LatencyHistogram& o) { copy_(o); return *this; }
+
+  void record(int64_t late_us) {
+    bump_(count_);
+    if (late_us < 0) { bump_(early_); late_us = 0; }
+    const auto v = static_cast<uint64_t>(late_us);
+    bump_(sum_, v);
+    if (v > max()) max_.store(v, std::memory_order_relaxed);
+    bump_(buckets_[bucket_of(v)]);
+  }
+
+  static std::size_t bucket_of(uint64_t v) {
+    std::size_t b = 0;
+    while (v) { v >>= 1; ++b; }                 // 0 -> 0, 1 -> 1, 2..3 -> 2, ...
+    return b < BUCKETS ? b : BUCKETS - 1;
+  }
+  // Górna (wyłączna) granica kubełka b w µs; ostatni kubełek jest otwarty (0)
+  static uint64_t bucket_limit(std::size_t b) { return b + 1 < BUCKETS ? (uint64_t{1} << b) : 0; }
+
+  uint64_t count() const { return get_(count_); }
+  uint64_t early() const { return get_(early_); }
+  uint64_t max()   const { return get_(max_); }
+  double   mean()  const {
+    const uint64_t n = count();
+    return n ? static_cast<double>(get_(sum_)) / static_cast<double>(n) : 0.0;
+  }
+  uint64_t bucket(std::size_t b) const { return get_(buckets_[b]); }
+
+  // Percentyl z dokładnością do kubełka (zwraca jego górną granicę, ostatni => max)
+  uint64_t percentile(double p) const {
+    const uint64_t n = count(), mx = max();
+    if (n == 0) return 0;
+    const auto want = static_cast<uint64_t>(p * static_cast<double>(n - 1)) + 1;
+    uint64_t acc = 0;
+    for (std::size_t b = 0; b < BUCKETS; ++b) {
+      acc += bucket(b);
+      if (acc >= want) return b + 1 < BUCKETS ? std::min(bucket_limit(b), mx) : mx;
+    }
+    return mx;
+  }
+
+  void reset() { copy_(LatencyHistogram{}); }
+
+private:
+  using counter = std::atomic<uint64_t>;
+  std::array<counter, BUCKETS> buckets_{};
+  counter count_{0}, early_{0}, sum_{0}, max_{0};
+
+  static uint64_t get_(const counter& c) { return c.load(std::memory_order_relaxed); }
+  static void bump_(counter& c, uint64_t d = 1) { c.store(get_(c) + d, std::memory_order_relaxed); }
+
+  void copy_(const LatencyHistogram& o) {
+    for (std::size_t b = 0; b < BUCKETS; ++b) buckets_[b].store(o.bucket(b), std::memory_order_relaxed);
+    count_.store(o.count(), std::memory_order_relaxed);
+    early_.store(o.early(), std::memory_order_relaxed);
+    sum_.store(get_(o.sum_), std::memory_order_relaxed);
+    max_.store(o.max(), std::memory_order_relaxed);
+  }
+};
+
+// Statystyki czasu jednego patternu
+struct PatternStats {
+  LatencyHistogram on_late;    // NoteOn: wysłany vs czas kroku
+  LatencyHistogram off_late;   // NoteOff: wysłany vs zaplanowany koniec nuty
+  uint64_t late_steps{0};      // kroki nadrabiane w jednym obrocie (pętla nie zdążyła)
+};
+
+// Statystyki całego silnika (sumy + rozbicie na patterny)
+struct EngineStats {
+  LatencyHistogram on_late;
+  LatencyHistogram off_late;
+  uint64_t late_steps{0};
+  uint64_t off_overflows{0};   // OFF wysłany przed czasem, bo kolejka była pełna
+  std::vector<PatternStats> patterns;
+
+  void reset() {
+    on_late.reset(); off_late.reset();
+    late_steps = off_overflows = 0;
+    for (auto& p : patterns) p = PatternStats{};
+  }
+};
+
+// Statystyki na wyjściu: faktyczny moment send() vs znacznik w komunikacie
+struct OutputStats {
+  LatencyHistogram on_late;
+  LatencyHistogram off_late;
+  std::atomic<uint64_t> other{0};   // pozostałe komunikaty (bez pomiaru)
+
+  OutputStats() = default;
+  OutputStats(const OutputStats& o) { *this = o; }
+  OutputStats& operator=(const OutputStats& o) {
+    on_late = o.on_late;
+    off_late = o.off_late;
+    other.store(o.other.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    return *this;
+  }
+  void reset() { on_late.reset(); off_late.reset(); other.store(0, std::memory_order_relaxed); }
+};
+
+/*
+ * StatsOut – nakładka na dowolne IMidiOut, mierzy spóźnienie na samym wyjściu.
+ * Silnik stempluje komunikat czasem zaplanowanym (t_us), tu porównujemy go
+ * z zegarem w chwili oddania do backendu.
+ */
+class StatsOut final : public ports::IMidiOut {
+public:
+  StatsOut(ports::IMidiOut& inner, const ports::IClock& clock) : inner_(inner), clock_(clock) {}
+
+  void send(const ports::MidiMsg& m) override {
+    record_(m, clock_.now_us());
+    inner_.send(m);
+  }
+  // StatsOut siedzi za wątkiem wysyłającym (ScheduledOut), więc paczka, która
+  // tu dociera, idzie do backendu TERAZ (komunikaty z jednego ticka albo
+  // zaległe naraz) – mierzymy każdy komunikat i oddajemy ją w całości.
+  void send_batch(const ports::MidiMsg* msgs, std::size_t n) override {
+    const uint64_t now = clock_.now_us();
+    for (std::size_t i = 0; i < n; ++i) record_(msgs[i], now);
+    inner_.send_batch(msgs, n);
+  }
+  bool cancel_after(uint64_t after_us) override { return inner_.cancel_after(after_us); }
+
+  const OutputStats& stats() const { return stats_; }
+  void reset_stats() { stats_.reset(); }
+
+private:
+  ports::IMidiOut&     inner_;
+  const ports::IClock& clock_;
+  OutputStats          stats_{};
+
+  void record_(const ports::MidiMsg& m, uint64_t now) {
+    const auto late = static_cast<int64_t>(now) - static_cast<int64_t>(m.t_us);
+    const uint8_t type = m.status & 0xF0;
+    if (type == 0x90 && m.data2 > 0)                   stats_.on_late.record(late);
+    else if (type == 0x80 || type == 0x90)             stats_.off_late.record(late);
+    else stats_.other.store(stats_.other.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  }
+};
+
+} // namespace core
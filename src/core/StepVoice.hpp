@@ -0,0 +1,42 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include "core/OffQueue.hpp"
+
+namespace core {
+
+/*
+ * Wspólna gorąca ścieżka kroku obu silników (PatternEngine, BasicArpEngine):
+ * transpozycja, czasy nuty z legato i planowanie NoteOff w stałej kolejce.
+ * Wszystko inline – po wklejeniu w krok silnika nie zostaje żadne wywołanie.
+ */
+
+// Nuta bazowa + oktawy, przycięta do zakresu MIDI
+constexpr uint8_t transpose(uint8_t base, int octaves) {
+  const int n = static_cast<int>(base) + 12 * octaves;
+  return static_cast<uint8_t>(n < 0 ? 0 : (n > 127 ? 127 : n));
+}
+
+// Czasy nuty kroku. Legato/overlap – żeby nie było dziur:
+//  - nuta trwa co najmniej do końca gate (i co najmniej 1 µs),
+//  - do tego overlap: nowa nuta wchodzi, zanim stara zgaśnie,
+//  - poprzednia nuta (jeśli jeszcze gra) trzyma się do on_at + overlap.
+struct NoteSpan {
+  uint64_t on_at;
+  uint64_t off_at;
+  uint64_t prev_off_at;
+};
+constexpr NoteSpan legato_span(uint64_t t_step, uint64_t gate_end, uint64_t overlap_us) {
+  const uint64_t min_off = std::max<uint64_t>(t_step + 1, gate_end);
+  return NoteSpan{t_step, min_off + overlap_us, t_step + overlap_us};
+}
+
+// Zaplanuj NoteOff (bez alokacji). Kolejka pełna => najpierw wypchnij
+// NAJWCZEŚNIEJSZY OFF (najmniej skraca nutę) przez evict(entry).
+template<class Evict>
+inline OffHandle schedule_off(OffQueue& q, uint64_t at_us, uint8_t ch, uint8_t note, uint32_t tag, Evict&& evict) {
+  if (q.full()) evict(q.pop());
+  return q.push(at_us, ch, note, tag);
+}
+
+} // namespace core
@@ -0,0 +1,229 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "core/PatternBank.hpp"
+#include "core/PatternEngine.hpp"
+
+namespace core {
+
+/*
+ * ======================================
+ * ŚLAD SESJI – binarny format pliku
+ * ======================================
+ *
+ * Nagranie wszystkiego, co do silnika wchodzi z zewnątrz, i tego, co z niego
+ * wychodzi – do odtworzenia błędu z koncertu bit w bit (arp_replay):
+ *
+ *   TraceHeader (56 B) | BankRecord[patterns] | zera do 16 B | TraceEvent[...] (do końca pliku)
+ *
+ * Nagłówek = migawka EngineConfig (i chwila, w której ją ustawiono), rekordy
+ * patternów w układzie banku (core/PatternBank.hpp), potem strumień zdarzeń
+ * o stałym rozmiarze, w kolejności, w jakiej działy się w wątku silnika.
+ *
+ * Silnik jest deterministyczny poza tym, co czyta z zegara – dlatego obok
+ * MIDI IN zapisujemy też chwilę każdego tick() i zmiany tempa. Odtworzenie =
+ * te same wywołania na zegarze wirtualnym ustawionym na zapisane chwile;
+ * wyjście porównujemy ze strumieniem Out/Cancel z nagrania.
+ *
+ * Edycje patternów (CLI, banki) silnik odbiera ze skrzynki na początku tick() –
+ * odebraną migawkę zapisujemy zaraz po zdarzeniu Tick: Pattern (numer, Quantize)
+ * i rekord banku pocięty na TRACE_RECORD_EVENTS zdarzeń PatternData po 12 B
+ * (pola t_us + arg). Odtworzenie publikuje ją do skrzynki przed tym samym tick().
+ *
+ * Układ jawny, little-endian (jak bank); 'version' rośnie przy każdej
+ * niezgodnej zmianie, rozmiary rekordów odrzucają plik z innego buildu.
+ */
+constexpr char     TRACE_MAGIC[8] = {'A','R','P','T','R','C','E','\0'};
+constexpr uint32_t TRACE_VERSION  = 2;   // 2: edycje patternów (Pattern/PatternData)
+
+enum class TraceKind : uint8_t {
+  In     = 1,   // MIDI IN do on_midi_in(); t_us = zegar silnika, arg = opóźnienie od przyjścia
+  Tick   = 2,   // tick(); t_us = zegar silnika
+  Tempo  = 3,   // set_engine_config() z nowym tempem; arg = bpm * 1000
+  Out    = 4,   // komunikat z silnika (send / send_batch); t_us = jego znacznik
+  Cancel = 5,   // cancel_after(t_us); arg = wynik (0/1)
+  Pattern     = 6,   // odebrana publikacja; t_us = zegar silnika, arg = pattern, status = Quantize,
+                     // data1 = liczba zdarzeń PatternData za nim
+  PatternData = 7,   // kawałek rekordu banku w t_us + arg (12 B); status = numer kawałka
+};
+
+// Wejście bez znacznika przyjścia (MidiMsg::t_us == 0)
+constexpr uint32_t TRACE_NO_STAMP = 0xFFFFFFFFu;
+
+struct TraceEvent {
+  uint64_t t_us;
+  uint32_t arg;
+  uint8_t  kind;           // TraceKind
+  uint8_t  status;
+  uint8_t  data1;
+  uint8_t  data2;
+};
+
+struct TraceHeader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t event_size;     // sizeof(TraceEvent)
+  uint32_t patterns;       // liczba rekordów patternów za nagłówkiem
+  uint32_t record_size;    // sizeof(BankRecord)
+  uint32_t max_steps;      // MAX_STEPS w chwili zapisu
+  uint32_t dropped;        // zdarzenia zgubione przez zapis (uzupełniane przy zamknięciu)
+  uint64_t config_us;      // chwila set_engine_config() z migawki
+  double   bpm;            // EngineConfig
+  uint16_t lookahead_ms;
+  uint8_t  overlap_ms;
+  uint8_t  external_clock;
+  uint8_t  chord_capacity;
+  uint8_t  reserved[3];
+};
+
+static_assert(sizeof(TraceEvent) == 16, "TraceEvent: fixed layout");
+static_assert(sizeof(TraceHeader) == 56, "TraceHeader: fixed layout");
+
+// Rekord banku w zdarzeniach PatternData: 12 B (t_us + arg) na zdarzenie
+constexpr std::size_t TRACE_CHUNK         = sizeof(uint64_t) + sizeof(uint32_t);
+constexpr std::size_t TRACE_RECORD_EVENTS = (sizeof(BankRecord) + TRACE_CHUNK - 1) / TRACE_CHUNK;
+static_assert(offsetof(TraceEvent, arg) + sizeof(uint32_t) == TRACE_CHUNK, "TraceEvent: t_us + arg contiguous");
+static_assert(TRACE_RECORD_EVENTS <= 255, "PatternData count fits data1");
+
+// Gdzie zaczynają się zdarzenia (wyrównane – czytamy je w miejscu)
+constexpr std::size_t trace_events_offset(uint32_t patterns) {
+  const std::size_t body = sizeof(TraceHeader) + static_cast<std::size_t>(patterns) * sizeof(BankRecord);
+  return (body + sizeof(TraceEvent) - 1) / sizeof(TraceEvent) * sizeof(TraceEvent);
+}
+
+inline TraceHeader make_trace_header(const EngineConfig& ec, uint64_t config_us, uint32_t patterns) {
+  TraceHeader h{};
+  std::memcpy(h.magic, TRACE_MAGIC, sizeof TRACE_MAGIC);
+  h.version        = TRACE_VERSION;
+  h.event_size     = sizeof(TraceEvent);
+  h.patterns       = patterns;
+  h.record_size    = sizeof(BankRecord);
+  h.max_steps      = MAX_STEPS;
+  h.config_us      = config_us;
+  h.bpm            = ec.bpm;
+  h.lookahead_ms   = ec.lookahead_ms;
+  h.overlap_ms     = ec.overlap_ms;
+  h.external_clock = ec.external_clock ? 1 : 0;
+  h.chord_capacity = ec.chord_capacity;
+  return h;
+}
+
+inline EngineConfig trace_engine_config(const TraceHeader& h) {
+  EngineConfig ec;
+  ec.bpm            = h.bpm;
+  ec.lookahead_ms   = h.lookahead_ms;
+  ec.overlap_ms     = h.overlap_ms;
+  ec.external_clock = h.external_clock != 0;
+  ec.chord_capacity = h.chord_capacity;
+  return ec;
+}
+
+// Zdarzenia wejściowe (zapis po stronie wątku silnika)
+inline TraceEvent trace_input(const ports::MidiMsg& m, uint64_t now) {
+  const uint32_t lag = !m.t_us ? TRACE_NO_STAMP
+                     : (now - m.t_us >= TRACE_NO_STAMP ? TRACE_NO_STAMP - 1 : static_cast<uint32_t>(now - m.t_us));
+  return TraceEvent{now, lag, static_cast<uint8_t>(TraceKind::In), m.status, m.data1, m.data2};
+}
+inline ports::MidiMsg trace_message(const TraceEvent& e) {
+  const uint64_t t = (e.arg == TRACE_NO_STAMP || e.arg > e.t_us) ? 0 : e.t_us - e.arg;
+  return ports::MidiMsg{e.status, e.data1, e.data2, t};
+}
+inline TraceEvent trace_tick(uint64_t now) {
+  return TraceEvent{now, 0, static_cast<uint8_t>(TraceKind::Tick), 0, 0, 0};
+}
+inline TraceEvent trace_tempo(double bpm, uint64_t now) {
+  const double milli = bpm * 1000.0 + 0.5;
+  return TraceEvent{now, milli <= 0 ? 0u : static_cast<uint32_t>(milli), static_cast<uint8_t>(TraceKind::Tempo), 0, 0, 0};
+}
+
+// Odebrana publikacja: Pattern + TRACE_RECORD_EVENTS x PatternData, kolejno do 'push'
+template<class Push>
+void trace_pattern(uint32_t pattern, Quantize when, const BankRecord& r, uint64_t now, Push&& push) {
+  push(TraceEvent{now, pattern, static_cast<uint8_t>(TraceKind::Pattern), static_cast<uint8_t>(when),
+                  static_cast<uint8_t>(TRACE_RECORD_EVENTS), 0});
+  unsigned char bytes[TRACE_RECORD_EVENTS * TRACE_CHUNK] = {};
+  std::memcpy(bytes, &r, sizeof r);
+  for (std::size_t k = 0; k < TRACE_RECORD_EVENTS; ++k) {
+    TraceEvent e{0, 0, static_cast<uint8_t>(TraceKind::PatternData), static_cast<uint8_t>(k), 0, 0};
+    std::memcpy(&e, bytes + k * TRACE_CHUNK, TRACE_CHUNK);
+    push(e);
+  }
+}
+
+// Rekord publikacji zaczynającej się w 'e' (zdarzenie Pattern); false => niepełny
+// (zdarzenia zgubione przy zapisie) albo nie ta wersja układu
+inline bool trace_pattern_record(const TraceEvent* e, const TraceEvent* end, BankRecord& out) {
+  if (e->kind != static_cast<uint8_t>(TraceKind::Pattern) || e->data1 != TRACE_RECORD_EVENTS ||
+      end - e <= static_cast<std::ptrdiff_t>(TRACE_RECORD_EVENTS))
+    return false;
+  unsigned char bytes[TRACE_RECORD_EVENTS * TRACE_CHUNK];
+  for (std::size_t k = 0; k < TRACE_RECORD_EVENTS; ++k) {
+    const TraceEvent& d = e[1 + k];
+    if (d.kind != static_cast<uint8_t>(TraceKind::PatternData) || d.status != k) return false;
+    std::memcpy(bytes + k * TRACE_CHUNK, &d, TRACE_CHUNK);
+  }
+  std::memcpy(&out, bytes, sizeof out);
+  return true;
+}
+
+// Zdarzenia wyjściowe – te same dla nagrania i odtworzenia (porównujemy je 1:1)
+inline TraceEvent trace_output(const ports::MidiMsg& m) {
+  return TraceEvent{m.t_us, 0, static_cast<uint8_t>(TraceKind::Out), m.status, m.data1, m.data2};
+}
+inline TraceEvent trace_cancel(uint64_t after_us, bool result) {
+  return TraceEvent{after_us, result ? 1u : 0u, static_cast<uint8_t>(TraceKind::Cancel), 0, 0, 0};
+}
+
+inline bool is_trace_output(const TraceEvent& e) {
+  return e.kind == static_cast<uint8_t>(TraceKind::Out) || e.kind == static_cast<uint8_t>(TraceKind::Cancel);
+}
+inline bool operator==(const TraceEvent& a, const TraceEvent& b) {
+  return a.t_us == b.t_us && a.arg == b.arg && a.kind == b.kind &&
+         a.status == b.status && a.data1 == b.data1 && a.data2 == b.data2;
+}
+
+/*
+ * TraceView – widok na ślad w pamięci (wczytany albo zmapowany plik); nic nie kopiuje.
+ * Ogon krótszy niż jedno zdarzenie (ucięty zapis) jest pomijany.
+ */
+class TraceView {
+public:
+  TraceView() = default;
+  TraceView(const void* data, std::size_t size) {
+    if (size < sizeof(TraceHeader)) { err_ = "file too small for a trace header"; return; }
+    std::memcpy(&hdr_, data, sizeof hdr_);
+    if (std::memcmp(hdr_.magic, TRACE_MAGIC, sizeof TRACE_MAGIC) != 0) { err_ = "not a session trace"; return; }
+    if (hdr_.version < 1 || hdr_.version > TRACE_VERSION) { err_ = "unsupported trace version"; return; }
+    if (hdr_.event_size != sizeof(TraceEvent) || hdr_.record_size != sizeof(BankRecord) ||
+        hdr_.max_steps != MAX_STEPS) {
+      err_ = "trace layout differs from this build"; return;
+    }
+    const std::size_t body = trace_events_offset(hdr_.patterns);
+    if (size < body) { err_ = "trace truncated"; return; }
+    const auto* p = static_cast<const unsigned char*>(data);
+    recs_   = reinterpret_cast<const BankRecord*>(p + sizeof(TraceHeader));
+    events_ = reinterpret_cast<const TraceEvent*>(p + body);
+    count_  = (size - body) / sizeof(TraceEvent);
+  }
+
+  bool valid() const { return recs_ != nullptr; }
+  const char* error() const { return err_; }
+  const TraceHeader& header() const { return hdr_; }
+
+  std::size_t patterns() const { return valid() ? hdr_.patterns : 0; }
+  const BankRecord& pattern(std::size_t i) const { return recs_[i]; }
+
+  std::size_t size() const { return count_; }
+  const TraceEvent* begin() const { return events_; }
+  const TraceEvent* end() const { return events_ + count_; }
+
+private:
+  TraceHeader       hdr_{};
+  const BankRecord* recs_{nullptr};
+  const TraceEvent* events_{nullptr};
+  std::size_t       count_{0};
+  const char*       err_{"empty"};
+};
+
+} // namespace core
@@ -0,0 +1,69 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+
+namespace core {
+
+// Ile mikrosekund ma minuta – podstawa przeliczeń tempa
+constexpr double US_PER_MINUTE = 60'000'000.0;
+
+/*
+ * Transport – ciągła oś czasu muzycznego (1 beat = ćwierćnuta).
+ *
+ * Czas zdarzenia liczymy ZAWSZE z jego pozycji muzycznej:
+ *   t(beat) = anchor_us + (beat - anchor_beat) * us_per_beat
+ * zamiast dosumowywać zaokrąglone długości kroków. Błąd nie kumuluje się,
+ * więc po wielu godzinach grania wciąż jesteśmy na siatce DAW-a,
+ * a patterny o różnych division trafiają w te same punkty.
+ *
+ * Zmiana tempa przesuwa kotwicę na „teraz” – oś pozostaje ciągła.
+ * Wyjątek: sync() przy zewnętrznym zegarze – tam kotwicę dyktuje PLL.
+ */
+class Transport {
+public:
+  explicit Transport(double bpm = 120.0) { set_tempo_(bpm); }
+
+  // Zmień tempo w chwili now_us (pozycja muzyczna w tej chwili się nie zmienia)
+  void set_bpm(double bpm, uint64_t now_us) {
+    if (!(bpm > 0)) bpm = 120.0;
+    if (bpm == bpm_) return;
+    anchor_beat_ = beat_at(now_us);
+    anchor_us_   = now_us;
+    set_tempo_(bpm);
+  }
+
+  // Zewnętrzny zegar: pozycja 'beat' wypada w chwili t_us, dalej tempo 'bpm'
+  void sync(double beat, uint64_t t_us, double bpm) {
+    anchor_beat_ = beat;
+    anchor_us_   = t_us;
+    set_tempo_(bpm);
+  }
+
+  double bpm() const { return bpm_; }
+  double us_per_beat() const { return us_per_beat_; }
+
+  // Pozycja muzyczna (w ćwierćnutach) w chwili t_us
+  double beat_at(uint64_t t_us) const {
+    const double dt = static_cast<double>(t_us) - static_cast<double>(anchor_us_);
+    return anchor_beat_ + dt / us_per_beat_;
+  }
+
+  // Chwila (µs), w której wypada pozycja 'beat' (zaokrąglona do najbliższej µs)
+  uint64_t time_at(double beat) const {
+    const double t = static_cast<double>(anchor_us_) + (beat - anchor_beat_) * us_per_beat_;
+    return t <= 0.0 ? 0 : static_cast<uint64_t>(std::llround(t));
+  }
+
+private:
+  double   bpm_{0.0};
+  double   us_per_beat_{500'000.0};
+  uint64_t anchor_us_{0};
+  double   anchor_beat_{0.0};
+
+  void set_tempo_(double bpm) {
+    bpm_ = (bpm > 0 ? bpm : 120.0);
+    us_per_beat_ = US_PER_MINUTE / bpm_;
+  }
+};
+
+} // namespace core
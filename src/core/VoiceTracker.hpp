@@ -0,0 +1,186 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include "core/ChordState.hpp"
+#include "ports/Midi.hpp"
+
+namespace core {
+
+/*
+ * VoiceTracker – co NAPRAWDĘ brzmi na wyjściu (dekorator IMidiOut przed backendem).
+ *
+ * Silniki wiedzą tylko, co zaplanowały: legato/overlap włącza nutę, która
+ * jeszcze brzmi (jej stary OFF przychodzi po nowym ON i ucina go), pełna
+ * kolejka OFF-ów zwalnia nuty przed czasem, a przy wyjściu z programu OFF-y
+ * czekające jeszcze w silniku nie wyjdą (wątek wysyłający dosyła tylko swoje).
+ * Tutaj trzymamy 16 kanałów × 128-bitowa maska (ChordState)
+ * i na każdy komunikat:
+ *  - ON nuty, która już brzmi (retrigger): najpierw OFF, potem ON – syntezator
+ *    dostaje czystą artykulację; spóźniony OFF poprzedniej nuty jest "dłużny"
+ *    i zostaje połknięty, zamiast uciąć nową,
+ *  - OFF nuty, która nie brzmi (już zwolniona / podwójny) – nie wychodzi,
+ *  - limit głosów na kanał (voices): pełny kanał => kradzież wg Steal
+ *    (najstarsza / najniższa / najwyższa nuta dostaje OFF) albo odrzucenie
+ *    nowej nuty (Steal::None); OFF silnika dla skradzionej/odrzuconej nuty
+ *    też jest dłużny,
+ *  - All Notes Off / All Sound Off (CC 123 / 120): OFF dla każdej brzmiącej
+ *    nuty kanału, potem sam CC (nie każdy odbiornik go słucha),
+ *  - release_all(): to samo dla wszystkich kanałów – przy wyjściu.
+ * Wstrzyknięte OFF-y mają znacznik komunikatu, który je wywołał, więc paczka
+ * zostaje posortowana po t_us.
+ *
+ * Siedzi ZA wątkiem wysyłającym (lookahead): widzi tylko to, co faktycznie
+ * wychodzi, bez komunikatów odwołanych przez cancel_after(). Jeden wątek
+ * wysyła; liczniki czytamy, gdy ten wątek stoi. Bez alokacji: stan ~11 KB,
+ * paczka wyjściowa w stałym buforze.
+ */
+class VoiceTracker final : public ports::IMidiOut {
+public:
+  enum class Steal : uint8_t { Oldest, Lowest, Highest, None };
+
+  struct Options {
+    uint8_t voices = 128;             // limit głosów na kanał, 1..128
+    Steal   steal  = Steal::Oldest;
+  };
+
+  struct Counters {
+    uint64_t retriggers = 0;          // ON nuty, która już brzmiała
+    uint64_t steals     = 0;          // nuty zwolnione dla nowej (limit)
+    uint64_t rejected   = 0;          // nowe nuty odrzucone (Steal::None)
+    uint64_t redundant  = 0;          // połknięte OFF-y (dłużne albo nuty, która nie brzmi)
+    uint64_t released   = 0;          // OFF-y z panic / release_all
+  };
+
+  explicit VoiceTracker(ports::IMidiOut& inner) : VoiceTracker(inner, Options{}) {}
+  VoiceTracker(ports::IMidiOut& inner, Options o) : inner_(inner) { set_options(o); }
+
+  void set_options(Options o) {
+    opt_ = o;
+    opt_.voices = o.voices < 1 ? 1 : (o.voices > MAX_CHORD_NOTES ? MAX_CHORD_NOTES : o.voices);
+    for (auto& ch : on_) ch.set_capacity(MAX_CHORD_NOTES);   // limit pilnujemy sami (kradzież)
+  }
+  const Options& options() const { return opt_; }
+
+  void send(const ports::MidiMsg& m) override { send_batch(&m, 1); }
+
+  void send_batch(const ports::MidiMsg* msgs, std::size_t n) override {
+    for (std::size_t i = 0; i < n; ++i) track_(msgs[i]);
+    flush_();
+  }
+
+  bool cancel_after(uint64_t after_us) override { return inner_.cancel_after(after_us); }
+
+  // OFF dla wszystkiego, co brzmi (wyjście, panic); zwraca liczbę zwolnionych nut.
+  // Dłużne OFF-y kasujemy: silnik, który już nie gra, ich nie dośle.
+  std::size_t release_all(uint64_t t_us) {
+    std::size_t freed = 0;
+    for (uint8_t ch = 0; ch < CHANNELS; ++ch) freed += release_channel_(ch, t_us);
+    owed_ = {};
+    flush_();
+    return freed;
+  }
+
+  bool sounding(uint8_t ch, uint8_t note) const { return on_[ch & 0x0F].contains(note); }
+  std::size_t voices(uint8_t ch) const { return on_[ch & 0x0F].size(); }
+  std::size_t sounding_total() const {
+    std::size_t n = 0;
+    for (const auto& ch : on_) n += ch.size();
+    return n;
+  }
+  const Counters& counters() const { return cnt_; }
+
+private:
+  static constexpr uint8_t     CHANNELS = 16;
+  static constexpr std::size_t OUT_BUF  = 256;
+  static constexpr uint8_t CC_ALL_SOUND_OFF = 120;
+  static constexpr uint8_t CC_ALL_NOTES_OFF = 123;
+
+  ports::IMidiOut& inner_;
+  Options  opt_{};
+  Counters cnt_{};
+  std::array<ChordState, CHANNELS> on_;                          // brzmiące nuty
+  std::array<std::array<uint8_t, 128>, CHANNELS> owed_{};        // OFF-y silnika do połknięcia
+  std::array<ports::MidiMsg, OUT_BUF> out_{};
+  std::size_t out_n_{0};
+
+  void emit_(const ports::MidiMsg& m) {
+    if (out_n_ == OUT_BUF) flush_();
+    out_[out_n_++] = m;
+  }
+  void flush_() {
+    if (out_n_) inner_.send_batch(out_.data(), out_n_);
+    out_n_ = 0;
+  }
+
+  void off_(uint8_t ch, uint8_t note, uint64_t t_us) {
+    on_[ch].note_off(note);
+    emit_(ports::MidiMsg{static_cast<uint8_t>(0x80 | ch), note, 0, t_us});
+  }
+  void owe_(uint8_t ch, uint8_t note) {
+    auto& o = owed_[ch][note];
+    if (o < 0xFF) ++o;
+  }
+
+  std::size_t release_channel_(uint8_t ch, uint64_t t_us) {
+    std::size_t n = 0;
+    on_[ch].for_each([&](uint8_t note) { emit_(ports::MidiMsg{static_cast<uint8_t>(0x80 | ch), note, 0, t_us}); ++n; });
+    on_[ch].clear();
+    cnt_.released += n;
+    return n;
+  }
+
+  // Ofiara kradzieży na pełnym kanale (kanał niepusty)
+  uint8_t victim_(const ChordState& c) const {
+    switch (opt_.steal) {
+      case Steal::Lowest:  return *c.lowest();
+      case Steal::Highest: return *c.highest();
+      default: break;
+    }
+    uint8_t best = 0;
+    uint32_t best_at = UINT32_MAX;
+    c.for_each([&](uint8_t n) { if (c.arrival(n) < best_at) { best_at = c.arrival(n); best = n; } });
+    return best;
+  }
+
+  void track_(const ports::MidiMsg& m) {
+    const uint8_t type = m.status & 0xF0, ch = m.status & 0x0F, note = m.data1 & 0x7F;
+
+    if (type == 0x90 && m.data2 > 0) {
+      auto& c = on_[ch];
+      if (c.contains(note)) {                                    // retrigger
+        off_(ch, note, m.t_us);
+        owe_(ch, note);
+        ++cnt_.retriggers;
+      } else if (c.size() >= opt_.voices) {
+        if (opt_.steal == Steal::None) {
+          owe_(ch, note);
+          ++cnt_.rejected;
+          return;
+        }
+        const uint8_t v = victim_(c);
+        off_(ch, v, m.t_us);
+        owe_(ch, v);
+        ++cnt_.steals;
+      }
+      c.note_on(note, m.data2);
+      emit_(m);
+      return;
+    }
+
+    if (type == 0x80 || type == 0x90) {                          // NoteOff (albo ON z velocity 0)
+      auto& o = owed_[ch][note];
+      if (o)                       { --o; ++cnt_.redundant; return; }
+      if (!on_[ch].contains(note)) { ++cnt_.redundant; return; }
+      on_[ch].note_off(note);
+      emit_(m);
+      return;
+    }
+
+    if (type == 0xB0 && (m.data1 == CC_ALL_NOTES_OFF || m.data1 == CC_ALL_SOUND_OFF))
+      release_channel_(ch, m.t_us);
+    emit_(m);
+  }
+};
+
+} // namespace core
@@ -0,0 +1,261 @@
+#include "desktop/BankLibrary.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+  #include <poll.h>
+  #include <sys/eventfd.h>
+  #include <sys/inotify.h>
+#endif
+
+namespace desktop_midi {
+
+namespace {
+
+std::string canonical(const std::string& path) {
+  std::error_code ec;
+  const auto p = std::filesystem::weakly_canonical(path, ec);
+  return ec ? path : p.string();
+}
+
+std::string sys_error(const char* what, const std::string& path) {
+  return std::string(what) + " " + path + ": " + std::strerror(errno);
+}
+
+bool write_all(int fd, const void* data, std::size_t n) {
+  const auto* p = static_cast<const unsigned char*>(data);
+  while (n > 0) {
+    const ssize_t k = ::write(fd, p, n);
+    if (k < 0) { if (errno == EINTR) continue; return false; }
+    p += k;
+    n -= static_cast<std::size_t>(k);
+  }
+  return true;
+}
+
+} // namespace
+
+// ============================== MappedBank ==============================
+
+MappedBank::~MappedBank() { unmap_(); }
+
+void MappedBank::unmap_() {
+  if (data_) ::munmap(data_, size_);
+  data_ = nullptr;
+  size_ = 0;
+  view_ = core::BankView{};
+}
+
+bool MappedBank::open(const std::string& path, std::string& err) {
+  unmap_();
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) { err = sys_error("cannot open", path); return false; }
+  struct stat st{};
+  if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+    err = "empty or unreadable bank " + path;
+    ::close(fd);
+    return false;
+  }
+  size_ = static_cast<std::size_t>(st.st_size);
+  data_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);                                   // mapa trzyma plik sama
+  if (data_ == MAP_FAILED) { data_ = nullptr; size_ = 0; err = sys_error("cannot map", path); return false; }
+  view_ = core::BankView(data_, size_);
+  if (!view_.valid()) { err = path + ": " + view_.error(); unmap_(); return false; }
+  return true;
+}
+
+bool write_bank_slot(const std::string& path, std::size_t slot, const core::BankRecord& rec, std::string& err) {
+  // Stara treść (jeśli plik jest i pasuje do formatu) + nowy rekord
+  std::vector<core::BankRecord> recs;
+  {
+    MappedBank old;
+    std::string ignored;
+    if (old.open(path, ignored)) {
+      const auto& v = old.view();
+      recs.assign(v.record(0), v.record(0) + v.count());
+    }
+  }
+  if (recs.size() <= slot) recs.resize(slot + 1, core::to_bank_record(core::PatternConfig{}));
+  recs[slot] = rec;
+
+  const std::string tmp = path + ".tmp";
+  const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) { err = sys_error("cannot create", tmp); return false; }
+  const auto hdr = core::make_bank_header(static_cast<uint32_t>(recs.size()));
+  const bool ok = write_all(fd, &hdr, sizeof hdr) &&
+                  write_all(fd, recs.data(), recs.size() * sizeof(core::BankRecord)) &&
+                  ::fsync(fd) == 0;
+  ::close(fd);
+  if (!ok || ::rename(tmp.c_str(), path.c_str()) != 0) {
+    err = sys_error("cannot write", path);
+    ::unlink(tmp.c_str());
+    return false;
+  }
+  return true;
+}
+
+// ============================== BankLibrary ==============================
+
+BankLibrary::BankLibrary(core::PatternEditor& editor) : editor_(editor) {
+#ifdef __linux__
+  inotify_fd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  stop_fd_    = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (inotify_fd_ >= 0 && stop_fd_ >= 0) {
+    running_.store(true);
+    watcher_ = std::thread([this] { watch_loop_(); });
+  } else {
+    std::cerr << "[bank] inotify unavailable – banks will not reload on change\n";
+  }
+#endif
+}
+
+BankLibrary::~BankLibrary() {
+#ifdef __linux__
+  if (running_.exchange(false)) {
+    const uint64_t one = 1;
+    (void)!::write(stop_fd_, &one, sizeof one);
+  }
+  if (watcher_.joinable()) watcher_.join();
+  if (inotify_fd_ >= 0) ::close(inotify_fd_);
+  if (stop_fd_ >= 0) ::close(stop_fd_);
+#endif
+}
+
+MappedBank* BankLibrary::bank_(const std::string& path, bool reopen, std::string& err) {
+  auto& slot = banks_[path];
+  if (slot && !reopen) return slot.get();
+  auto b = std::make_unique<MappedBank>();
+  if (!b->open(path, err)) {
+    if (!slot) banks_.erase(path);
+    return nullptr;
+  }
+  slot = std::move(b);
+  return slot.get();
+}
+
+bool BankLibrary::apply_(MappedBank& b, std::size_t slot, std::size_t pattern, std::string& msg) {
+  if (slot >= b.view().count()) {
+    msg = "slot " + std::to_string(slot) + " out of range (bank has " + std::to_string(b.view().count()) + ")";
+    return false;
+  }
+  // Rekord spoza zakresów nie dochodzi do silnika – pattern gra dalej po staremu
+  core::BankRecordError bad;
+  const auto guard = editor_.lock();
+  if (!b.view().load(slot, editor_.draft(pattern), &bad)) {
+    char why[96];
+    core::format_bank_error(bad, why, sizeof why);
+    msg = "slot " + std::to_string(slot) + " rejected: " + why;
+    return false;
+  }
+  editor_.publish(pattern, core::Quantize::Bar);
+  return true;
+}
+
+bool BankLibrary::load(const std::string& bank, std::size_t slot, std::size_t pattern, std::string& msg) {
+  if (pattern >= editor_.size()) { msg = "no pattern " + std::to_string(pattern); return false; }
+  const auto t0 = std::chrono::steady_clock::now();
+  const std::string path = canonical(bank);
+
+  std::lock_guard<std::mutex> lk(mu_);
+  MappedBank* b = bank_(path, false, msg);
+  if (!b || !apply_(*b, slot, pattern, msg)) return false;
+  bindings_[pattern] = Binding{path, slot};
+  watch_dir_(path);
+
+  const auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count();
+  msg = "pat " + std::to_string(pattern) + " <- " + bank + " [" + std::to_string(slot) + "] at next bar ("
+      + std::to_string(b->view().count()) + " patterns in bank, " + std::to_string(us) + " us)";
+  return true;
+}
+
+bool BankLibrary::save(const std::string& bank, std::size_t slot, std::size_t pattern, std::string& msg) {
+  if (pattern >= editor_.size()) { msg = "no pattern " + std::to_string(pattern); return false; }
+  core::BankRecord rec;
+  {
+    const auto guard = editor_.lock();
+    rec = core::to_bank_record(editor_.draft(pattern));
+  }
+  const std::string path = canonical(bank);
+  std::lock_guard<std::mutex> lk(mu_);
+  if (!write_bank_slot(path, slot, rec, msg)) return false;
+  msg = "pat " + std::to_string(pattern) + " -> " + bank + " [" + std::to_string(slot) + "]";
+  return true;
+}
+
+void BankLibrary::watch_dir_(const std::string& path) {
+#ifdef __linux__
+  if (inotify_fd_ < 0) return;
+  const std::string dir = std::filesystem::path(path).parent_path().string();
+  for (const auto& [wd, d] : watches_) if (d == dir) return;
+  // katalog, nie plik: zapis przez rename podmienia i-węzeł pliku
+  const int wd = ::inotify_add_watch(inotify_fd_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+  if (wd >= 0) watches_[wd] = dir;
+#else
+  (void)path;
+#endif
+}
+
+void BankLibrary::reload_(const std::string& path) {
+  std::lock_guard<std::mutex> lk(mu_);
+  bool bound = false;
+  for (const auto& [pat, bnd] : bindings_) bound |= (bnd.bank == path);
+  if (!bound) return;
+
+  std::string err;
+  MappedBank* b = bank_(path, true, err);
+  if (!b) { std::cerr << "[bank] reload failed: " << err << "\n"; return; }
+  std::size_t n = 0;
+  for (const auto& [pat, bnd] : bindings_) {
+    if (bnd.bank != path) continue;
+    std::string msg;
+    if (apply_(*b, bnd.slot, pat, msg)) ++n;
+    else std::cerr << "[bank] pat " << pat << ": " << msg << "\n";
+  }
+  std::cout << "[bank] " << path << " changed – " << n << " pattern(s) reload at next bar\n";
+}
+
+void BankLibrary::watch_loop_() {
+#ifdef __linux__
+  alignas(inotify_event) char buf[4096];
+  while (running_.load()) {
+    pollfd fds[2] = {{inotify_fd_, POLLIN, 0}, {stop_fd_, POLLIN, 0}};
+    if (::poll(fds, 2, -1) < 0) { if (errno == EINTR) continue; break; }
+    if (fds[1].revents) break;
+
+    std::vector<std::string> changed;
+    for (;;) {
+      const ssize_t n = ::read(inotify_fd_, buf, sizeof buf);
+      if (n <= 0) break;
+      for (ssize_t off = 0; off < n;) {
+        const auto* ev = reinterpret_cast<const inotify_event*>(buf + off);
+        off += static_cast<ssize_t>(sizeof(inotify_event) + ev->len);
+        if (!ev->len) continue;
+        std::string dir;
+        {
+          std::lock_guard<std::mutex> lk(mu_);
+          const auto it = watches_.find(ev->wd);
+          if (it == watches_.end()) continue;
+          dir = it->second;
+        }
+        const std::string path = dir + "/" + ev->name;
+        bool seen = false;
+        for (const auto& c : changed) seen |= (c == path);
+        if (!seen) changed.push_back(path);
+      }
+    }
+    for (const auto& p : changed) reload_(p);
+  }
+#endif
+}
+
+} // namespace desktop_midi
@@ -0,0 +1,87 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "core/PatternBank.hpp"
+#include "core/PatternEditor.hpp"
+#include "ports/PatternStore.hpp"
+
+namespace desktop_midi {
+
+/*
+ * MappedBank – plik banku (core/PatternBank.hpp) zmapowany tylko do odczytu.
+ * Otwarcie = mmap + sprawdzenie nagłówka; rekordy czytamy prosto z mapy.
+ */
+class MappedBank {
+public:
+  MappedBank() = default;
+  ~MappedBank();
+  MappedBank(const MappedBank&) = delete;
+  MappedBank& operator=(const MappedBank&) = delete;
+
+  bool open(const std::string& path, std::string& err);
+  const core::BankView& view() const { return view_; }
+
+private:
+  void*          data_{nullptr};
+  std::size_t    size_{0};
+  core::BankView view_{};
+  void unmap_();
+};
+
+// Zapisz rekord do slotu (plik powstaje / rośnie w razie potrzeby).
+// Nowa treść idzie do pliku tymczasowego i wchodzi przez rename – czytelnik
+// (mmap, inotify) nigdy nie widzi połowy zapisu.
+bool write_bank_slot(const std::string& path, std::size_t slot, const core::BankRecord& rec, std::string& err);
+
+/*
+ * BankLibrary – banki patternów dla CLI (ports::IPatternStore).
+ *
+ *  - load: mapuje bank (raz; potem z pamięci podręcznej), kopiuje slot do szkicu
+ *    edytora i publikuje go z Quantize::Bar – silnik podmienia pattern na
+ *    granicy taktu, siatka kroków zostaje nienaruszona,
+ *  - zapamiętuje powiązanie pattern <- (bank, slot); gdy plik banku się zmieni
+ *    (inotify: zapis albo podmiana przez rename), wątek obserwatora mapuje go
+ *    ponownie i przeładowuje wszystkie powiązane patterny – też od taktu,
+ *  - save: szkic patternu -> slot banku.
+ *
+ * Edytor dzielimy z wątkiem CLI – obie strony trzymają PatternEditor::lock().
+ * Bez inotify (inny system) działa load/save, bez automatycznego przeładowania.
+ */
+class BankLibrary final : public ports::IPatternStore {
+public:
+  explicit BankLibrary(core::PatternEditor& editor);
+  ~BankLibrary() override;
+  BankLibrary(const BankLibrary&) = delete;
+  BankLibrary& operator=(const BankLibrary&) = delete;
+
+  bool load(const std::string& bank, std::size_t slot, std::size_t pattern, std::string& msg) override;
+  bool save(const std::string& bank, std::size_t slot, std::size_t pattern, std::string& msg) override;
+
+private:
+  struct Binding { std::string bank; std::size_t slot; };
+
+  core::PatternEditor& editor_;
+  std::mutex mu_;                                            // banks_, bindings_, watches_
+  std::map<std::string, std::unique_ptr<MappedBank>> banks_; // ścieżka kanoniczna -> mapa
+  std::map<std::size_t, Binding> bindings_;                  // pattern -> (bank, slot)
+  std::map<int, std::string> watches_;                       // wd katalogu -> katalog
+
+  int inotify_fd_{-1};
+  int stop_fd_{-1};
+  std::atomic<bool> running_{false};
+  std::thread watcher_;
+
+  MappedBank* bank_(const std::string& path, bool reopen, std::string& err);
+  bool apply_(MappedBank& b, std::size_t slot, std::size_t pattern, std::string& msg);
+  void watch_dir_(const std::string& path);
+  void reload_(const std::string& path);
+  void watch_loop_();
+};
+
+} // namespace desktop_midi
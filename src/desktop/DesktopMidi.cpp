@@ -6,6 +6,7 @@
   #error "RtMidi header not found. Install rtmidi."
 #endif
 
+#include <atomic>
 #include <memory>
 #include <vector>
 #include <iostream>
@@ -14,14 +15,25 @@
 
 #include "ports/Midi.hpp"
 #include "ports/Clock.hpp"
+#include "core/SpscRing.hpp"
+#include "desktop/DesktopMidi.hpp"
+#include "desktop/EventLog.hpp"
 
-// Wypisz porty i wybierz pierwszy
-static unsigned autoSelectPort(RtMidi* dev, const char* label, const std::string& preferName) {
+// Wypisz porty i wybierz pierwszy (albo zadany numerem)
+static unsigned autoSelectPort(RtMidi* dev, const char* label, const std::string& preferName, int port = -1) {
   unsigned n = dev->getPortCount();
   if (n == 0) {
     std::cerr << "[MIDI] Brak portów " << label << "\n";
     throw std::runtime_error("No MIDI ports found");
   }
+  if (port >= 0) {
+    if (static_cast<unsigned>(port) >= n) {
+      std::cerr << "[MIDI] Nie ma portu " << label << " nr " << port << " (jest " << n << ")\n";
+      throw std::runtime_error("MIDI port not found");
+    }
+    std::cerr << "[MIDI] Port " << label << " " << port << " (" << dev->getPortName(port) << ")\n";
+    return static_cast<unsigned>(port);
+  }
   std::cerr << "[MIDI] Dostępne porty " << label << ":\n";
   for (unsigned i = 0; i < n; ++i) {
     std::string name = dev->getPortName(i);
@@ -35,54 +47,121 @@ static unsigned autoSelectPort(RtMidi* dev, const char* label, const std::string
   return 0; // fallback
 }
 
+// Wejście MIDI z RtMidi, w jednym z dwóch trybów:
+//  - Callback: RtMidi woła nas z własnego wątku – dekodujemy komunikat do
+//    prealokowanego pierścienia SPSC i od razu budzimy pętlę główną,
+//  - Poll: pętla sama pyta RtMidi (bufor wielokrotnego użytku, bez alokacji).
+// W obu trybach znacznik czasu pochodzi z delty backendu (czas przyjścia),
+// przeliczonej na zegar silnika – a nie z chwili, w której pętla się obudziła.
 class DesktopMidiIn final : public ports::IMidiIn {
 public:
-  explicit DesktopMidiIn(const ports::IClock& clock)
-    : clock_(clock), in_(std::make_unique<RtMidiIn>()) {
+  DesktopMidiIn(const ports::IClock& clock, desktop_midi::InputMode mode, int port)
+    : clock_(clock), mode_(mode), in_(std::make_unique<RtMidiIn>()) {
     in_->ignoreTypes(false, false, false);
-    auto idx = autoSelectPort(in_.get(), "IN", "MPKmini2");
+    auto idx = autoSelectPort(in_.get(), "IN", "MPKmini2", port);
+    if (mode_ == desktop_midi::InputMode::Callback) {
+      in_->setCallback(&DesktopMidiIn::on_message_, this);
+    } else {
+      buf_.reserve(1024);              // getMessage() tylko nadpisuje zawartość
+    }
     in_->openPort(idx);
   }
+  ~DesktopMidiIn() override {
+    if (mode_ == desktop_midi::InputMode::Callback) in_->cancelCallback();
+  }
 
   std::optional<ports::MidiMsg> poll() override {
-    std::vector<unsigned char> msg;
-    (void)in_->getMessage(&msg);       // non-blocking; msg=[] jeśli nic nie ma
-    if (msg.empty()) return std::nullopt;
+    if (mode_ == desktop_midi::InputMode::Callback)
+      return q_.try_pop();             // bez blokad – producentem jest wątek RtMidi
 
-    ports::MidiMsg m{};
-    if (msg.size() >= 1) m.status = msg[0];
-    if (msg.size() >= 2) m.data1  = msg[1];
-    if (msg.size() >= 3) m.data2  = msg[2];
-    m.t_ms = clock_.now_ms();
-    return m;
+    for (;;) {
+      const double delta = in_->getMessage(&buf_);  // non-blocking; buf_=[] jeśli nic nie ma
+      if (buf_.empty()) return std::nullopt;
+      if (auto m = decode_(buf_, delta)) return m;  // SysEx pomijamy, czytamy dalej
+    }
+  }
+
+  bool set_wakeup(ports::IWakeup* w) override {
+    if (mode_ != desktop_midi::InputMode::Callback) return false;
+    wakeup_.store(w, std::memory_order_release);
+    return true;
   }
 
 private:
+  // Backend może opóźnić dostarczenie o kilka ms; większa rozbieżność
+  // między deltą a zegarem silnika (np. po długiej ciszy) => kotwiczymy od nowa.
+  static constexpr uint64_t MAX_SKEW_US = 20'000;
+
   const ports::IClock& clock_;
+  const desktop_midi::InputMode mode_;
   std::unique_ptr<RtMidiIn> in_;
+  core::SpscRing<ports::MidiMsg, 256> q_;
+  std::vector<unsigned char> buf_;     // tryb Poll
+  std::atomic<ports::IWakeup*> wakeup_{nullptr};
+  bool     have_prev_{false};          // stan przeliczania delt (jeden wątek: callback albo poll)
+  uint64_t prev_us_{0};
+
+  // Czas przyjścia na zegarze silnika: poprzedni znacznik + delta z backendu,
+  // nigdy w przyszłości i nigdy dalej niż MAX_SKEW_US od "teraz".
+  uint64_t ingress_us_(double delta_s) {
+    const uint64_t now = clock_.now_us();
+    uint64_t t = now;
+    if (have_prev_ && delta_s >= 0.0) {
+      t = prev_us_ + static_cast<uint64_t>(delta_s * 1e6 + 0.5);
+      if (t > now || now - t > MAX_SKEW_US) t = now;
+    }
+    have_prev_ = true;
+    prev_us_   = t;
+    return t;
+  }
+
+  std::optional<ports::MidiMsg> decode_(const std::vector<unsigned char>& msg, double delta_s) {
+    const uint64_t t = ingress_us_(delta_s);   // delta liczy się także dla pominiętych
+    const std::size_t len = ports::message_length(msg[0]);
+    if (len == 0 || msg.size() < len) return std::nullopt;
+
+    ports::MidiMsg m{};
+    m.status = msg[0];
+    if (len >= 2) m.data1 = msg[1];
+    if (len >= 3) m.data2 = msg[2];
+    m.t_us = t;
+    return m;
+  }
+
+  static void on_message_(double delta, std::vector<unsigned char>* msg, void* user) {
+    auto* self = static_cast<DesktopMidiIn*>(user);
+    if (!msg || msg->empty()) return;
+
+    const auto m = self->decode_(*msg, delta);
+    if (!m) return;
+    (void)self->q_.try_push(*m);       // pełna kolejka => komunikat odrzucony (licznik w dropped())
+    if (auto* w = self->wakeup_.load(std::memory_order_acquire)) w->wake();
+  }
 };
 
+// Wyjście: bufor na stosie (bez alokacji), log tylko przez EventLog (inny wątek)
 class DesktopMidiOut final : public ports::IMidiOut {
 public:
-  DesktopMidiOut() : out_(std::make_unique<RtMidiOut>()) {
-    auto idx = autoSelectPort(out_.get(), "OUT", "IAC");
+  DesktopMidiOut(desktop_midi::EventLog* log, int port)
+    : out_(std::make_unique<RtMidiOut>()), log_(log) {
+    auto idx = autoSelectPort(out_.get(), "OUT", "IAC", port);
     out_->openPort(idx);
   }
 
   void send(const ports::MidiMsg& m) override {
-    std::vector<unsigned char> v{ m.status, m.data1, m.data2 };
-    out_->sendMessage(&v);             // lub: unsigned char b[3]{...}; out_->sendMessage(b,3);
-    const uint8_t channel = (m.status & 0x0F) + 1;  // Extract channel (1-16)
-    std::cout << ( (m.status & 0xF0) == 0x90 ? "[OUT ON ] " : "[OUT OFF] " )
-          << "ch=" << (int)channel << " note=" << (int)m.data1 << " vel=" << (int)m.data2 << " t=" << m.t_ms << "\n";
-
+    const std::size_t len = ports::message_length(m.status);
+    if (len == 0) return;              // SysEx itp. nie przechodzi przez MidiMsg
+    const unsigned char b[3]{ m.status, m.data1, m.data2 };
+    out_->sendMessage(b, len);
+    if (log_) log_->record(m);
   }
 private:
   std::unique_ptr<RtMidiOut> out_;
+  desktop_midi::EventLog*    log_;
 };
 
 // Fabryki (jedyna definicja)
 namespace desktop_midi {
-  std::unique_ptr<ports::IMidiIn>  makeIn (const ports::IClock& clk) { return std::make_unique<DesktopMidiIn>(clk); }
-  std::unique_ptr<ports::IMidiOut> makeOut()                         { return std::make_unique<DesktopMidiOut>(); }
+  std::unique_ptr<ports::IMidiIn>  makeIn (const ports::IClock& clk, InputMode mode, int port) { return std::make_unique<DesktopMidiIn>(clk, mode, port); }
+  std::unique_ptr<ports::IMidiOut> makeOut(EventLog* log, int port)                      { return std::make_unique<DesktopMidiOut>(log, port); }
 }
@@ -4,6 +4,14 @@
 #include "ports/Clock.hpp"
 
 namespace desktop_midi {
-  std::unique_ptr<ports::IMidiIn>  makeIn (const ports::IClock& clk);
-  std::unique_ptr<ports::IMidiOut> makeOut();
+  class EventLog;
+
+  // Callback: RtMidi budzi pętlę przy każdym komunikacie (domyślnie)
+  // Poll:     pętla sama odpytuje wejście (musi budzić się regularnie)
+  enum class InputMode { Callback, Poll };
+
+  // port < 0 => wybór automatyczny (po nazwie, inaczej pierwszy); port >= 0 => dokładnie ten
+  std::unique_ptr<ports::IMidiIn>  makeIn (const ports::IClock& clk, InputMode mode = InputMode::Callback, int port = -1);
+  // log == nullptr => wyjście nic nie loguje
+  std::unique_ptr<ports::IMidiOut> makeOut(EventLog* log = nullptr, int port = -1);
 }
@@ -0,0 +1,76 @@
+#include "desktop/EventLog.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#ifdef __linux__
+  #include <sys/resource.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+
+namespace desktop_midi {
+
+namespace {
+// Co ile opróżniamy pierścień – log nie musi być natychmiastowy
+constexpr auto DRAIN_PERIOD = std::chrono::milliseconds(20);
+
+void lower_priority_() {
+#ifdef __linux__
+  // nice +10 tylko dla tego wątku (na Linuksie priorytet "nice" jest per-wątek)
+  (void)setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+#endif
+}
+
+void format_(std::string& out, const ports::MidiMsg& m) {
+  char line[96];
+  const uint8_t type = m.status & 0xF0;
+  const int channel = (m.status & 0x0F) + 1;  // kanał 1..16
+  int n;
+  if (type == 0x90 || type == 0x80) {
+    n = std::snprintf(line, sizeof line, "%s ch=%d note=%d vel=%d t_us=%llu\n",
+                      type == 0x90 ? "[OUT ON ]" : "[OUT OFF]", channel, m.data1, m.data2,
+                      static_cast<unsigned long long>(m.t_us));
+  } else {
+    n = std::snprintf(line, sizeof line, "[OUT    ] status=0x%02X d1=%d d2=%d t_us=%llu\n",
+                      m.status, m.data1, m.data2, static_cast<unsigned long long>(m.t_us));
+  }
+  if (n > 0) out.append(line, static_cast<std::size_t>(n) < sizeof line ? static_cast<std::size_t>(n) : sizeof line - 1);
+}
+} // namespace
+
+EventLog::EventLog(LogLevel level)
+  : level_(level), thread_([this]{ run_(); }) {}
+
+EventLog::~EventLog() {
+  running_.store(false);
+  if (thread_.joinable()) thread_.join();
+}
+
+void EventLog::run_() {
+  lower_priority_();
+  std::string batch;
+  batch.reserve(64 * 1024);
+  uint64_t reported_drops = 0;
+
+  for (;;) {
+    const bool last = !running_.load();
+    batch.clear();
+    ring_.drain([&](const ports::MidiMsg& m){ format_(batch, m); });
+
+    const uint64_t drops = ring_.dropped();
+    if (drops != reported_drops) {
+      batch += "[LOG] dropped " + std::to_string(drops - reported_drops) + " events\n";
+      reported_drops = drops;
+    }
+    if (!batch.empty()) {
+      std::fwrite(batch.data(), 1, batch.size(), stdout);
+      std::fflush(stdout);
+    }
+    if (last) break;
+    std::this_thread::sleep_for(DRAIN_PERIOD);
+  }
+}
+
+} // namespace desktop_midi
@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include "core/SpscRing.hpp"
+#include "ports/Midi.hpp"
+
+namespace desktop_midi {
+
+// Szczegółowość logu zdarzeń wyjściowych
+enum class LogLevel : uint8_t {
+  Off   = 0,   // nic (zero kosztu na ścieżce czasu rzeczywistego)
+  Notes = 1,   // tylko NoteOn/NoteOff
+  All   = 2,   // wszystkie komunikaty
+};
+
+/*
+ * EventLog – log zdarzeń MIDI poza wątkiem czasu rzeczywistego.
+ *
+ * record() wrzuca komunikat do pierścienia SPSC (bez blokad, bez alokacji,
+ * bez formatowania). Osobny wątek o niskim priorytecie co kilkanaście ms
+ * zbiera paczkę, formatuje ją i wypisuje jednym zapisem na stdout.
+ * Gdy konsola nie nadąża – zdarzenia są odrzucane (dropped()), a nie blokują.
+ */
+class EventLog {
+public:
+  explicit EventLog(LogLevel level = LogLevel::Notes);
+  ~EventLog();
+  EventLog(const EventLog&) = delete;
+  EventLog& operator=(const EventLog&) = delete;
+
+  void set_level(LogLevel l) { level_.store(l, std::memory_order_relaxed); }
+  LogLevel level() const { return level_.load(std::memory_order_relaxed); }
+
+  // Wołane z wątku wysyłającego (jedyny producent)
+  void record(const ports::MidiMsg& m) {
+    const LogLevel l = level();
+    if (l == LogLevel::Off) return;
+    const uint8_t type = m.status & 0xF0;
+    if (l == LogLevel::Notes && type != 0x80 && type != 0x90) return;
+    (void)ring_.try_push(m);
+  }
+
+  uint64_t dropped() const { return ring_.dropped(); }
+
+private:
+  std::atomic<LogLevel> level_;
+  std::atomic<bool>     running_{true};
+  core::SpscRing<ports::MidiMsg, 4096> ring_;
+  std::thread           thread_;
+
+  void run_();
+};
+
+} // namespace desktop_midi
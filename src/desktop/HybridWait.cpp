@@ -0,0 +1,62 @@
+#include "desktop/HybridWait.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace desktop_midi {
+
+namespace {
+
+using std::chrono::steady_clock;
+
+double us_between(steady_clock::time_point a, steady_clock::time_point b) {
+  return std::chrono::duration<double, std::micro>(b - a).count();
+}
+
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+} // namespace
+
+void HybridWait::calibrate(Reactor& r, int rounds) {
+  for (int i = 0; i < rounds; ++i) {
+    const auto target = steady_clock::now() + std::chrono::microseconds(500);
+    r.wait(target);
+    const auto now = steady_clock::now();
+    if (now >= target) learn_(us_between(target, now));   // wcześniej => wake(), nie liczymy
+  }
+}
+
+bool HybridWait::wait(Reactor& r, std::optional<time_point> deadline) {
+  if (!deadline) { r.wait(std::nullopt); return false; }
+
+  auto now = steady_clock::now();
+  if (now >= *deadline) return true;                      // już po terminie – nie ma na co czekać
+  const auto margin = std::chrono::microseconds(spin_us());
+  if (*deadline - now > margin) {
+    const auto sleep_to = *deadline - margin;
+    r.wait(sleep_to);
+    now = steady_clock::now();
+    if (now < sleep_to) return false;                     // wake(): jest coś do zrobienia
+    learn_(us_between(sleep_to, now));
+  }
+  while ((now = steady_clock::now()) < *deadline) cpu_relax();
+  late_.record(static_cast<int64_t>(std::llround(us_between(*deadline, now))));
+  return true;
+}
+
+void HybridWait::learn_(double overshoot_us) {
+  constexpr double GAIN = 1.0 / 16;
+  mean_us_ += GAIN * (overshoot_us - mean_us_);
+  dev_us_  += GAIN * (std::fabs(overshoot_us - mean_us_) - dev_us_);
+  const double m = std::clamp(mean_us_ + 4.0 * dev_us_,
+                              static_cast<double>(MIN_SPIN_US), static_cast<double>(MAX_SPIN_US));
+  spin_us_.store(static_cast<uint32_t>(m), std::memory_order_relaxed);
+}
+
+} // namespace desktop_midi
@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include "core/Stats.hpp"
+#include "desktop/Reactor.hpp"
+
+namespace desktop_midi {
+
+/*
+ * HybridWait – czekanie do terminu: sen (Reactor/timerfd) + końcówka na spinie.
+ *
+ * Wybudzenie z timerfd spóźnia się o kilkadziesiąt–kilkaset µs (planista,
+ * przerwania, obciążenie). Śpimy więc do "termin - margines", a resztę
+ * odliczamy aktywnie na zegarze. Margines kalibruje się sam: po każdym
+ * wybudzeniu z timera uczymy się średniego spóźnienia snu i jego rozrzutu
+ * (średnie kroczące) i bierzemy średnia + 4 * rozrzut, w granicach
+ * [MIN_SPIN_US, MAX_SPIN_US].
+ *
+ * wake() (MIDI IN, CLI) przerywa sen jak dotąd; w fazie spinu zdarzenie
+ * czeka najwyżej margines. lateness() = faktyczne wybudzenie - termin.
+ *
+ * Jeden wątek czeka; lateness()/spin_us() wolno czytać z innego.
+ */
+class HybridWait {
+public:
+  using time_point = Reactor::time_point;
+
+  static constexpr uint32_t MIN_SPIN_US = 20;
+  static constexpr uint32_t MAX_SPIN_US = 1000;
+
+  // Kilkaset krótkich snów na starcie, żeby margines od razu był sensowny
+  void calibrate(Reactor& r, int rounds = 200);
+
+  // true => termin minął (pomiar w lateness(), o ile faktycznie czekaliśmy);
+  // false => obudził nas wake()
+  bool wait(Reactor& r, std::optional<time_point> deadline);
+
+  const core::LatencyHistogram& lateness() const { return late_; }
+  uint32_t spin_us() const { return spin_us_.load(std::memory_order_relaxed); }
+  void reset_stats() { late_.reset(); }
+
+private:
+  double mean_us_{50.0};           // średnie spóźnienie snu
+  double dev_us_{25.0};            // średnie odchylenie od niego
+  std::atomic<uint32_t> spin_us_{150};
+  core::LatencyHistogram late_;
+
+  void learn_(double overshoot_us);
+};
+
+} // namespace desktop_midi
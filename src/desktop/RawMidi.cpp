@@ -0,0 +1,157 @@
+#include "desktop/RawMidi.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+  #include <sys/eventfd.h>
+#endif
+
+#include "desktop/EventLog.hpp"
+
+namespace desktop_midi {
+
+namespace {
+
+// Paczka wyjściowa: tyle komunikatów naraz w jednym write() (tick ma ich zwykle kilka)
+constexpr std::size_t OUT_CHUNK = 256;
+// Ile najwyżej czekamy, aż odbiorca zrobi miejsce (reszta paczki przepada)
+constexpr int OUT_WAIT_MS = 1;
+
+int open_midi(const std::string& path, int flags) {
+  struct stat st{};
+  const bool exists = ::stat(path.c_str(), &st) == 0;
+  // FIFO: O_RDWR trzyma "drugą stronę" – czytelnik nie dostaje EOF, gdy nadawca
+  // się rozłączy, a pisarz nie czeka w open() na czytelnika (Linux)
+  if (exists && S_ISFIFO(st.st_mode)) flags = (flags & ~O_ACCMODE) | O_RDWR;
+  // Wyjście do zwykłego pliku (albo ścieżki, której jeszcze nie ma) = zrzut
+  // bajtów od zera; urządzeń i FIFO nie tworzymy ani nie obcinamy
+  if ((flags & O_ACCMODE) == O_WRONLY && (!exists || S_ISREG(st.st_mode))) flags |= O_CREAT | O_TRUNC;
+  const int fd = ::open(path.c_str(), flags | O_NONBLOCK | O_CLOEXEC | O_NOCTTY, 0644);
+  if (fd < 0) {
+    std::cerr << "[MIDI] Nie mogę otworzyć " << path << ": " << std::strerror(errno) << "\n";
+    throw std::runtime_error("cannot open raw MIDI " + path);
+  }
+  std::cerr << "[MIDI] Surowe MIDI: " << path << "\n";
+  return fd;
+}
+
+} // namespace
+
+// ============================== RawMidiIn ==============================
+
+RawMidiIn::RawMidiIn(int fd, const ports::IClock& clock, InputMode mode)
+  : fd_(fd), clock_(clock), mode_(mode) {
+  ::fcntl(fd_, F_SETFL, ::fcntl(fd_, F_GETFL) | O_NONBLOCK);
+  if (mode_ != InputMode::Callback) return;
+#ifdef __linux__
+  stop_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+  running_.store(true);
+  reader_ = std::thread([this] { reader_loop_(); });
+}
+
+RawMidiIn::~RawMidiIn() {
+  if (running_.exchange(false) && stop_fd_ >= 0) {
+    const uint64_t one = 1;
+    (void)!::write(stop_fd_, &one, sizeof one);
+  }
+  if (reader_.joinable()) reader_.join();
+  if (stop_fd_ >= 0) ::close(stop_fd_);
+  ::close(fd_);
+}
+
+bool RawMidiIn::read_once_() {
+  uint8_t buf[READ_CHUNK];
+  const ssize_t n = ::read(fd_, buf, sizeof buf);
+  if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+  if (n == 0) return false;                                  // koniec strumienia
+  parser_.feed(buf, static_cast<std::size_t>(n), clock_.now_us(),
+               [&](const ports::MidiMsg& m) { (void)q_.try_push(m); });
+  stray_.store(parser_.stray_bytes(), std::memory_order_relaxed);
+  return true;
+}
+
+std::optional<ports::MidiMsg> RawMidiIn::poll() {
+  if (mode_ == InputMode::Poll && q_.empty()) (void)read_once_();
+  return q_.try_pop();
+}
+
+bool RawMidiIn::set_wakeup(ports::IWakeup* w) {
+  if (mode_ != InputMode::Callback) return false;
+  wakeup_.store(w, std::memory_order_release);
+  return true;
+}
+
+void RawMidiIn::reader_loop_() {
+  while (running_.load()) {
+    pollfd fds[2] = {{fd_, POLLIN, 0}, {stop_fd_, POLLIN, 0}};
+    // bez eventfd (inny system) budzimy się co 100 ms, żeby zauważyć stop
+    const int r = ::poll(fds, stop_fd_ >= 0 ? 2 : 1, stop_fd_ >= 0 ? -1 : 100);
+    if (r < 0) { if (errno == EINTR) continue; break; }
+    if (stop_fd_ >= 0 && fds[1].revents) break;
+    if (!fds[0].revents) continue;
+    if (!read_once_()) {
+      std::cerr << "[MIDI] Surowe wejście zamknięte\n";
+      break;
+    }
+    if (!q_.empty())
+      if (auto* w = wakeup_.load(std::memory_order_acquire)) w->wake();
+  }
+}
+
+// ============================== RawMidiOut ==============================
+
+RawMidiOut::RawMidiOut(int fd, EventLog* log, core::MidiEncoder::Options enc)
+  : fd_(fd), log_(log), enc_(enc) {
+  ::fcntl(fd_, F_SETFL, ::fcntl(fd_, F_GETFL) | O_NONBLOCK);
+}
+
+RawMidiOut::~RawMidiOut() { ::close(fd_); }
+
+bool RawMidiOut::write_(const uint8_t* p, std::size_t n) {
+  while (n > 0) {
+    const ssize_t k = ::write(fd_, p, n);
+    if (k > 0) { p += k; n -= static_cast<std::size_t>(k); continue; }
+    if (k < 0 && errno == EINTR) continue;
+    if (k < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return false;
+    pollfd pf{fd_, POLLOUT, 0};                              // odbiorca nie nadąża
+    if (::poll(&pf, 1, OUT_WAIT_MS) <= 0) return false;
+  }
+  return true;
+}
+
+void RawMidiOut::send(const ports::MidiMsg& m) {
+  send_batch(&m, 1);
+}
+
+void RawMidiOut::send_batch(const ports::MidiMsg* msgs, std::size_t n) {
+  uint8_t buf[3 * OUT_CHUNK];
+  for (std::size_t i = 0; i < n;) {
+    std::size_t len = 0, cnt = 0;
+    for (; i < n && cnt < OUT_CHUNK; ++i, ++cnt) {
+      len += enc_.encode(msgs[i], buf + len);                // 0 B => SysEx itp. (nie przez MidiMsg)
+      if (log_) log_->record(msgs[i]);
+    }
+    if (len && !write_(buf, len)) {
+      dropped_ += cnt;
+      enc_.reset();                                          // odbiorca mógł zgubić status
+    }
+  }
+}
+
+// Fabryki
+std::unique_ptr<ports::IMidiIn> makeRawIn(const std::string& path, const ports::IClock& clk, InputMode mode) {
+  return std::make_unique<RawMidiIn>(open_midi(path, O_RDONLY), clk, mode);
+}
+std::unique_ptr<RawMidiOut> makeRawOut(const std::string& path, EventLog* log, core::MidiEncoder::Options enc) {
+  return std::make_unique<RawMidiOut>(open_midi(path, O_WRONLY), log, enc);
+}
+
+} // namespace desktop_midi
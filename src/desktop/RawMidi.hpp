@@ -0,0 +1,104 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include "core/MidiEncoder.hpp"
+#include "core/MidiParser.hpp"
+#include "core/SpscRing.hpp"
+#include "desktop/DesktopMidi.hpp"
+#include "ports/Clock.hpp"
+#include "ports/Midi.hpp"
+
+namespace desktop_midi {
+
+/*
+ * Surowe MIDI 1.0 na deskryptorze pliku – bez RtMidi:
+ * /dev/snd/midiC*D* (ALSA rawmidi), FIFO, pty, port szeregowy, pipe w teście.
+ *
+ * Wejście dekoduje strumień bajtów core::MidiParser prosto z bufora read()
+ * (running status, realtime w środku komunikatu, SysEx pomijany), znacznik
+ * czasu = chwila odczytu na zegarze silnika. Tryby jak w DesktopMidiIn:
+ *  - Callback: wątek czytający śpi w poll() na fd i budzi pętlę (set_wakeup),
+ *  - Poll: poll() silnika sam robi nieblokujący read().
+ *
+ * Obiekt przejmuje deskryptor (close w destruktorze).
+ */
+class RawMidiIn final : public ports::IMidiIn {
+public:
+  RawMidiIn(int fd, const ports::IClock& clock, InputMode mode = InputMode::Callback);
+  ~RawMidiIn() override;
+  RawMidiIn(const RawMidiIn&) = delete;
+  RawMidiIn& operator=(const RawMidiIn&) = delete;
+
+  std::optional<ports::MidiMsg> poll() override;
+  bool set_wakeup(ports::IWakeup* w) override;
+
+  uint64_t dropped() const { return q_.dropped(); }
+  uint64_t stray_bytes() const { return stray_.load(std::memory_order_relaxed); }
+
+private:
+  // Kawałek odczytu; w trybie Poll czytamy dopiero, gdy kolejka jest pusta,
+  // więc nawet same bajty realtime (1 B = 1 komunikat) się w niej mieszczą.
+  static constexpr std::size_t READ_CHUNK = 128;
+
+  int fd_;
+  int stop_fd_{-1};
+  const ports::IClock& clock_;
+  const InputMode mode_;
+  core::MidiParser parser_;
+  core::SpscRing<ports::MidiMsg, 256> q_;
+  std::atomic<ports::IWakeup*> wakeup_{nullptr};
+  std::atomic<uint64_t> stray_{0};
+  std::atomic<bool> running_{false};
+  std::thread reader_;
+
+  // read() + dekodowanie do kolejki; false => koniec strumienia albo błąd
+  bool read_once_();
+  void reader_loop_();
+};
+
+/*
+ * Wyjście na deskryptor: paczka (komunikaty jednego ticka albo okna lookahead)
+ * = jeden write(), kodowana core::MidiEncoder – running status i NoteOff jako
+ * NoteOn z velocity 0, chyba że port tego nie znosi (Options). Bajty
+ * zaoszczędzone względem pełnych komunikatów: bytes_saved().
+ *
+ * Deskryptor nieblokujący – pętla silnika nigdy nie czeka na odbiorcę dłużej
+ * niż ~1 ms; czego nie dało się zapisać, przepada (dropped()). Po takim
+ * urwaniu następny komunikat idzie z pełnym statusem, więc odbiorca się
+ * synchronizuje.
+ */
+class RawMidiOut final : public ports::IMidiOut {
+public:
+  RawMidiOut(int fd, EventLog* log = nullptr, core::MidiEncoder::Options enc = {});
+  ~RawMidiOut() override;
+  RawMidiOut(const RawMidiOut&) = delete;
+  RawMidiOut& operator=(const RawMidiOut&) = delete;
+
+  void send(const ports::MidiMsg& m) override;
+  void send_batch(const ports::MidiMsg* msgs, std::size_t n) override;
+
+  uint64_t dropped() const { return dropped_; }
+  uint64_t bytes_sent() const { return enc_.bytes_sent(); }
+  uint64_t bytes_saved() const { return enc_.bytes_saved(); }
+
+private:
+  int               fd_;
+  EventLog*         log_;
+  core::MidiEncoder enc_;
+  uint64_t          dropped_{0};
+
+  bool write_(const uint8_t* p, std::size_t n);
+};
+
+// Otwarcie ścieżki (FIFO otwieramy O_RDWR – brak drugiej strony to nie EOF/blokada;
+// wyjście do zwykłego pliku tworzy go albo obcina).
+// Błąd => std::runtime_error (jak makeIn/makeOut przy braku portów).
+std::unique_ptr<ports::IMidiIn>  makeRawIn (const std::string& path, const ports::IClock& clk, InputMode mode = InputMode::Callback);
+std::unique_ptr<RawMidiOut>      makeRawOut(const std::string& path, EventLog* log = nullptr,
+                                            core::MidiEncoder::Options enc = {});
+
+} // namespace desktop_midi
@@ -0,0 +1,93 @@
+#include "desktop/Reactor.hpp"
+
+#include <stdexcept>
+
+#ifdef __linux__
+  #include <cerrno>
+  #include <cstdint>
+  #include <sys/epoll.h>
+  #include <sys/eventfd.h>
+  #include <sys/prctl.h>
+  #include <sys/timerfd.h>
+  #include <unistd.h>
+#endif
+
+namespace desktop_midi {
+
+#ifdef __linux__
+
+Reactor::Reactor() {
+  // Domyślny "timer slack" (50 µs) rozmywa wybudzenia – prosimy o minimum
+  (void)prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+
+  epfd_    = epoll_create1(EPOLL_CLOEXEC);
+  timerfd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  eventfd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epfd_ < 0 || timerfd_ < 0 || eventfd_ < 0)
+    throw std::runtime_error("Reactor: epoll/timerfd/eventfd init failed");
+
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.fd = timerfd_;
+  epoll_ctl(epfd_, EPOLL_CTL_ADD, timerfd_, &ev);
+  ev.data.fd = eventfd_;
+  epoll_ctl(epfd_, EPOLL_CTL_ADD, eventfd_, &ev);
+}
+
+Reactor::~Reactor() {
+  if (eventfd_ >= 0) close(eventfd_);
+  if (timerfd_ >= 0) close(timerfd_);
+  if (epfd_ >= 0)    close(epfd_);
+}
+
+void Reactor::wait(std::optional<time_point> deadline) {
+  // steady_clock na Linuksie == CLOCK_MONOTONIC, więc czas przenosimy 1:1
+  itimerspec its{};
+  if (deadline) {
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      deadline->time_since_epoch()).count();
+    its.it_value.tv_sec  = static_cast<time_t>(ns / 1'000'000'000);
+    its.it_value.tv_nsec = static_cast<long>(ns % 1'000'000'000);
+    if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0) its.it_value.tv_nsec = 1; // 0 = disarm
+  }
+  timerfd_settime(timerfd_, TFD_TIMER_ABSTIME, &its, nullptr); // it_value=0 => wyłącz timer
+
+  epoll_event evs[2];
+  const int n = epoll_wait(epfd_, evs, 2, -1);   // EINTR (np. SIGINT) – po prostu wracamy
+  for (int i = 0; i < n; ++i) {
+    uint64_t v;
+    (void)!read(evs[i].data.fd, &v, sizeof v);   // wyzeruj licznik timerfd/eventfd
+  }
+}
+
+void Reactor::wake() {
+  const uint64_t one = 1;
+  (void)!write(eventfd_, &one, sizeof one);
+}
+
+#else
+
+namespace {
+// Bez eventfd sygnał nie przerwie czekania – nie śpimy dłużej niż to
+constexpr auto MAX_IDLE = std::chrono::milliseconds(100);
+}
+
+Reactor::Reactor() = default;
+Reactor::~Reactor() = default;
+
+void Reactor::wait(std::optional<time_point> deadline) {
+  const auto cap = std::chrono::steady_clock::now() + MAX_IDLE;
+  const auto until = (deadline && *deadline < cap) ? *deadline : cap;
+  std::unique_lock<std::mutex> lk(mu_);
+  cv_.wait_until(lk, until, [this]{ return pending_; });
+  pending_ = false;
+}
+
+void Reactor::wake() {
+  { std::lock_guard<std::mutex> lk(mu_); pending_ = true; }
+  cv_.notify_one();
+}
+
+#endif
+
+} // namespace desktop_midi
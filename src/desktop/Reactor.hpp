@@ -0,0 +1,45 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include "ports/Wakeup.hpp"
+
+namespace desktop_midi {
+
+/*
+ * Reactor – jedno miejsce, w którym pętla główna śpi.
+ *
+ * Budzi się, gdy:
+ *  - minie termin silnika (najbliższy OFF albo krok) – timerfd z czasem absolutnym,
+ *  - ktoś zawoła wake() (MIDI IN, CLI, SIGINT) – eventfd.
+ * Na Linuksie: epoll + timerfd + eventfd (wake() jest async-signal-safe).
+ * Gdzie indziej: condition_variable (z limitem snu, bo sygnał jej nie obudzi).
+ */
+class Reactor final : public ports::IWakeup {
+public:
+  using time_point = std::chrono::steady_clock::time_point;
+
+  Reactor();
+  ~Reactor() override;
+  Reactor(const Reactor&) = delete;
+  Reactor& operator=(const Reactor&) = delete;
+
+  // Śpij do 'deadline' (brak => do najbliższego wake()).
+  void wait(std::optional<time_point> deadline);
+
+  void wake() override;
+
+private:
+#ifdef __linux__
+  int epfd_{-1};
+  int timerfd_{-1};
+  int eventfd_{-1};
+#else
+  std::mutex mu_;
+  std::condition_variable cv_;
+  bool pending_{false};
+#endif
+};
+
+} // namespace desktop_midi
@@ -0,0 +1,115 @@
+#include "desktop/Realtime.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef __linux__
+  #include <malloc.h>
+  #include <pthread.h>
+  #include <sched.h>
+  #include <sys/mman.h>
+  #include <unistd.h>
+#endif
+
+namespace desktop_midi {
+
+namespace {
+
+void add_problem(std::string& s, const char* what, int err) {
+  if (!s.empty()) s += "; ";
+  s += what;
+  if (err) { s += ": "; s += std::strerror(err); }
+}
+
+// Dotknij stosu na zapas: kolejne wywołania w pętli RT nie złapią page faultu
+[[gnu::noinline]] void prefault_stack() {
+  volatile unsigned char buf[PREFAULT_STACK];
+  for (std::size_t i = 0; i < sizeof buf; i += 4096) buf[i] = 0;
+}
+
+} // namespace
+
+#ifdef __linux__
+
+bool lock_memory(std::string& why) {
+  // glibc: zwolnione bloki zostają w procesie, duże nie idą przez mmap –
+  // inaczej każdy nowy blok to świeże (niezablokowane jeszcze) strony
+  (void)mallopt(M_TRIM_THRESHOLD, -1);
+  (void)mallopt(M_MMAP_MAX, 0);
+
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+    const int err = errno;
+    add_problem(why, "mlockall", err);
+    if (err == ENOMEM || err == EPERM) why += " (raise 'ulimit -l' or run with CAP_IPC_LOCK)";
+    return false;
+  }
+  // Rozgrzej stertę: strony trafiają do procesu teraz, a nie przy pierwszej alokacji w pętli
+  if (auto* p = static_cast<unsigned char*>(std::malloc(PREFAULT_HEAP))) {
+    const long page = sysconf(_SC_PAGESIZE);
+    for (std::size_t i = 0; i < PREFAULT_HEAP; i += static_cast<std::size_t>(page > 0 ? page : 4096))
+      static_cast<volatile unsigned char*>(p)[i] = 0;
+    std::free(p);
+  }
+  return true;
+}
+
+RtStatus enter_realtime(const RtOptions& opt) {
+  RtStatus st;
+
+  if (opt.fifo) {
+    sched_param sp{};
+    const int lo = sched_get_priority_min(SCHED_FIFO), hi = sched_get_priority_max(SCHED_FIFO);
+    sp.sched_priority = opt.priority < lo ? lo : opt.priority > hi ? hi : opt.priority;
+    if (const int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp); err == 0) {
+      st.fifo = true;
+      st.priority = sp.sched_priority;
+    } else {
+      add_problem(st.problems, "SCHED_FIFO", err);
+      if (err == EPERM) st.problems += " (need CAP_SYS_NICE or an rtprio limit)";
+    }
+  }
+
+  if (opt.cpu >= 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(opt.cpu, &set);
+    if (const int err = pthread_setaffinity_np(pthread_self(), sizeof set, &set); err == 0) {
+      st.pinned = true;
+      st.cpu = opt.cpu;
+    } else {
+      add_problem(st.problems, "CPU affinity", err);
+    }
+  }
+
+  prefault_stack();
+  st.stack_prefaulted = true;
+  return st;
+}
+
+#else
+
+bool lock_memory(std::string& why) {
+  add_problem(why, "memory locking not supported on this platform", 0);
+  return false;
+}
+
+RtStatus enter_realtime(const RtOptions& opt) {
+  RtStatus st;
+  if (opt.fifo || opt.cpu >= 0) add_problem(st.problems, "SCHED_FIFO / affinity not supported on this platform", 0);
+  prefault_stack();
+  st.stack_prefaulted = true;
+  return st;
+}
+
+#endif
+
+std::string describe(const RtStatus& st) {
+  std::string s = st.fifo ? "SCHED_FIFO " + std::to_string(st.priority) : std::string("normal scheduling");
+  if (st.pinned) s += ", CPU " + std::to_string(st.cpu);
+  if (st.stack_prefaulted) s += ", stack prefaulted";
+  if (!st.problems.empty()) s += " [" + st.problems + "]";
+  return s;
+}
+
+} // namespace desktop_midi
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace desktop_midi {
+
+/*
+ * Tryb czasu rzeczywistego (opcjonalny, --rt).
+ *
+ * lock_memory() – raz na proces, przed startem wątków RT:
+ *   mlockall(MCL_CURRENT | MCL_FUTURE), glibc bez oddawania pamięci do systemu
+ *   i bez mmap dla dużych bloków, plus wstępnie dotknięta sterta – page fault
+ *   w trakcie grania to kilkadziesiąt µs, a po mlockall już się nie zdarzy.
+ * enter_realtime() – w wątku, który ma być RT:
+ *   SCHED_FIFO z zadanym priorytetem, przypięcie do CPU, wstępnie dotknięty stos.
+ *
+ * Każdy krok może się nie udać (brak CAP_SYS_NICE / limitu rtprio / memlock,
+ * inny system) – wtedy jedziemy dalej jako zwykły wątek, a status mówi, czego
+ * zabrakło. Nic tu nie rzuca wyjątków.
+ */
+struct RtOptions {
+  bool fifo    = true;         // false => bez zmiany planisty (np. samo przypięcie)
+  int priority = 80;           // SCHED_FIFO 1..99
+  int cpu      = -1;           // -1 => bez przypinania
+};
+
+struct RtStatus {
+  bool fifo{false};
+  int  priority{0};
+  bool pinned{false};
+  int  cpu{-1};
+  bool stack_prefaulted{false};
+  std::string problems;        // co się nie udało i dlaczego (puste => wszystko OK)
+};
+
+constexpr std::size_t PREFAULT_STACK = 256 * 1024;
+constexpr std::size_t PREFAULT_HEAP  = 8 * 1024 * 1024;
+
+// false => pamięć nie jest zablokowana (powód w 'why')
+bool lock_memory(std::string& why);
+
+RtStatus enter_realtime(const RtOptions& opt);
+
+// Jedna linijka do logu startowego
+std::string describe(const RtStatus& st);
+
+} // namespace desktop_midi
@@ -0,0 +1,126 @@
+#include "desktop/ScheduledOut.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <optional>
+
+namespace desktop_midi {
+
+ScheduledOut::ScheduledOut(ports::IMidiOut& inner, const ports::IClock& clock, const RtOptions* rt)
+  : inner_(inner), clock_(clock), rt_(rt != nullptr), rt_opt_(rt ? *rt : RtOptions{}) {
+  pending_.reserve(PENDING);
+  thread_ = std::thread([this]{ run_(); });
+  while (!ready_.load(std::memory_order_acquire)) std::this_thread::yield();
+}
+
+ScheduledOut::~ScheduledOut() {
+  running_.store(false);
+  reactor_.wake();
+  if (thread_.joinable()) thread_.join();
+}
+
+void ScheduledOut::send_batch(const ports::MidiMsg* msgs, std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    const Item it{msgs[i], Kind::At};
+    if (!ring_.try_push(it)) push_wait_(it);
+  }
+  reactor_.wake();
+}
+
+void ScheduledOut::push_wait_(const Item& it) {
+  using namespace std::chrono;
+  stalls_.fetch_add(1, std::memory_order_relaxed);
+  const uint8_t type = it.m.status & 0xF0;
+  const bool must = it.kind == Kind::Cancel || type == 0x80 || (type == 0x90 && it.m.data2 == 0);
+  const auto give_up = steady_clock::now() + microseconds(PUSH_WAIT_US);
+  do {
+    reactor_.wake();                                    // wątek wysyłający opróżni pierścień
+    std::this_thread::yield();
+    if (ring_.try_push(it)) return;
+  } while (must || steady_clock::now() < give_up);
+  dropped_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool ScheduledOut::cancel_after(uint64_t after_us) {
+  ports::MidiMsg m{};
+  m.t_us = after_us;
+  push_(Item{m, Kind::Cancel});
+  return true;
+}
+
+void ScheduledOut::run_() {
+  using namespace std::chrono;
+  if (rt_) {
+    rt_status_ = enter_realtime(rt_opt_);
+    waiter_.calibrate(reactor_);
+  }
+  ready_.store(true, std::memory_order_release);
+
+  while (running_.load()) {
+    ring_.drain([this](const Item& it){ take_(it); });
+    const uint64_t now = clock_.now_us();
+    send_due_(now);
+
+    std::optional<steady_clock::time_point> dl;
+    if (head_ < pending_.size()) {
+      const uint64_t t = pending_[head_].t_us;
+      dl = steady_clock::now() + microseconds(t > now ? t - now : 0);
+    }
+    if (rt_) (void)waiter_.wait(reactor_, dl);
+    else     reactor_.wait(dl);
+  }
+
+  // Koniec: to, co jeszcze w drodze, plus zaległe OFF-y od razu (bez wiszących nut)
+  ring_.drain([this](const Item& it){ take_(it); });
+  for (std::size_t i = head_; i < pending_.size(); ++i) {
+    const uint8_t type = pending_[i].status & 0xF0;
+    if (type == 0x80 || (type == 0x90 && pending_[i].data2 == 0)) inner_.send(pending_[i]);
+  }
+  pending_.clear();
+  head_ = 0;
+}
+
+void ScheduledOut::take_(const Item& it) {
+  switch (it.kind) {
+    case Kind::Now:
+      inner_.send(it.m);
+      break;
+    case Kind::At:
+      insert_(it.m);
+      break;
+    case Kind::Cancel: {
+      const auto first = pending_.begin() + static_cast<std::ptrdiff_t>(head_);
+      const auto cut = std::upper_bound(first, pending_.end(), it.m.t_us,
+                         [](uint64_t t, const ports::MidiMsg& m){ return t < m.t_us; });
+      pending_.erase(cut, pending_.end());
+    } break;
+  }
+}
+
+void ScheduledOut::insert_(const ports::MidiMsg& m) {
+  if (pending_.size() == pending_.capacity()) {
+    if (head_ == 0) {                        // naprawdę pełno – najwcześniejszy od razu
+      inner_.send(pending_[head_++]);
+      overflow_.fetch_add(1, std::memory_order_relaxed);
+    }
+    // odzyskaj miejsce po wysłanych (bez realokacji)
+    pending_.erase(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(head_));
+    head_ = 0;
+  }
+  // paczki przychodzą posortowane, więc zwykle to dopisanie na końcu
+  auto pos = pending_.end();
+  const auto first = pending_.begin() + static_cast<std::ptrdiff_t>(head_);
+  while (pos != first && (pos - 1)->t_us > m.t_us) --pos;
+  pending_.insert(pos, m);
+}
+
+void ScheduledOut::send_due_(uint64_t now) {
+  // wszystko, na co przyszła pora, jedną paczką (leży ciągiem, rosnąco wg t_us)
+  std::size_t end = head_;
+  while (end < pending_.size() && pending_[end].t_us <= now) ++end;
+  if (end > head_) inner_.send_batch(&pending_[head_], end - head_);
+  head_ = end;
+  if (head_ == pending_.size()) { pending_.clear(); head_ = 0; }
+}
+
+} // namespace desktop_midi
@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "core/SpscRing.hpp"
+#include "desktop/HybridWait.hpp"
+#include "desktop/Reactor.hpp"
+#include "desktop/Realtime.hpp"
+#include "ports/Clock.hpp"
+#include "ports/Midi.hpp"
+
+namespace desktop_midi {
+
+/*
+ * ScheduledOut – wyjście z własnym wątkiem wysyłającym (tryb lookahead).
+ *
+ * Silnik oddaje paczki komunikatów na przyszłość (send_batch); wątek trzyma je
+ * posortowane i wysyła każdy do 'inner' dokładnie w chwili t_us (timerfd przez
+ * Reactor). Pętla silnika może się spóźnić o cały horyzont, a rytm na wyjściu
+ * zostaje równy. cancel_after() odwołuje to, co jeszcze nie wyszło.
+ *
+ * Do wątku prowadzi pierścień SPSC – producent (pętla silnika) nie alokuje
+ * i zwykle nie czeka. Pełny pierścień (wątek wysyłający stoi dłużej niż
+ * kilka okien) => producent budzi wątek i czeka na miejsce: NoteOff i cancel
+ * do skutku (zgubiony OFF to wisząca nuta), reszta najwyżej PUSH_WAIT_US,
+ * potem przepada – liczniki stalls() / dropped().
+ * 'inner' jest wołany wyłącznie z wątku wysyłającego.
+ *
+ * Z 'rt' wątek wysyłający wchodzi w tryb czasu rzeczywistego (Realtime.hpp)
+ * i czeka hybrydowo (HybridWait) – konstruktor wraca dopiero po tej konfiguracji.
+ */
+class ScheduledOut final : public ports::IMidiOut {
+public:
+  static constexpr std::size_t QUEUE   = 4096;   // pierścień producent -> wątek
+  static constexpr std::size_t PENDING = 8192;   // zaplanowane, jeszcze niewysłane
+  static constexpr uint64_t    PUSH_WAIT_US = 2000; // pełny pierścień: tyle czeka komunikat inny niż OFF
+
+  ScheduledOut(ports::IMidiOut& inner, const ports::IClock& clock, const RtOptions* rt = nullptr);
+  ~ScheduledOut() override;
+  ScheduledOut(const ScheduledOut&) = delete;
+  ScheduledOut& operator=(const ScheduledOut&) = delete;
+
+  void send(const ports::MidiMsg& m) override { push_(Item{m, Kind::Now}); }
+  void send_batch(const ports::MidiMsg* msgs, std::size_t n) override;
+  bool cancel_after(uint64_t after_us) override;
+
+  // Komunikaty odrzucone przy pełnym pierścieniu (nigdy NoteOff)
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+  // Ile razy producent czekał na miejsce w pierścieniu
+  uint64_t stalls() const { return stalls_.load(std::memory_order_relaxed); }
+  // Wysłane przed czasem, bo lista oczekujących była pełna
+  uint64_t sent_early() const { return overflow_.load(std::memory_order_relaxed); }
+
+  // Tryb RT: co udało się ustawić i jak punktualnie budzi się wątek (nullptr => bez RT)
+  const RtStatus*   rt_status() const { return rt_ ? &rt_status_ : nullptr; }
+  const HybridWait* waiter() const    { return rt_ ? &waiter_ : nullptr; }
+  HybridWait*       waiter()          { return rt_ ? &waiter_ : nullptr; }
+
+private:
+  enum class Kind : uint8_t { At, Now, Cancel };
+  struct Item { ports::MidiMsg m; Kind kind; };
+
+  ports::IMidiOut&     inner_;
+  const ports::IClock& clock_;
+  core::SpscRing<Item, QUEUE> ring_;
+  Reactor              reactor_;
+  std::atomic<bool>    running_{true};
+  std::atomic<uint64_t> overflow_{0};
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<uint64_t> stalls_{0};
+
+  bool       rt_{false};
+  RtOptions  rt_opt_{};
+  RtStatus   rt_status_{};      // pisze wątek przed ready_, potem tylko odczyt
+  HybridWait waiter_{};
+  std::atomic<bool> ready_{false};
+
+  // Tylko wątek wysyłający: posortowane wg t_us, ważne [head_, end)
+  std::vector<ports::MidiMsg> pending_;
+  std::size_t head_{0};
+
+  std::thread thread_;
+
+  void push_(const Item& it) {
+    if (!ring_.try_push(it)) push_wait_(it);
+    reactor_.wake();
+  }
+  void push_wait_(const Item& it);
+  void run_();
+  void take_(const Item& it);
+  void insert_(const ports::MidiMsg& m);
+  void send_due_(uint64_t now);
+};
+
+} // namespace desktop_midi
@@ -0,0 +1,175 @@
+#include "desktop/ShardHost.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <optional>
+
+namespace desktop_midi {
+
+namespace {
+
+int64_t steady_ns() {
+  using namespace std::chrono;
+  return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void bump(std::atomic<uint64_t>& c, uint64_t d = 1) {
+  c.store(c.load(std::memory_order_relaxed) + d, std::memory_order_relaxed);
+}
+
+} // namespace
+
+ShardHost::ShardHost(const ports::IClock& clock, Config cfg) : clock_(clock), cfg_(cfg) {
+  const std::size_t n = std::max<std::size_t>(1, cfg_.workers);
+  for (std::size_t w = 0; w < n; ++w) shards_.push_back(std::make_unique<Shard>());
+}
+
+ShardHost::~ShardHost() { stop(); }
+
+std::size_t ShardHost::add(ports::IMidiIn* in, ports::IMidiOut& out, std::size_t patterns) {
+  const std::size_t i = instances_.size();
+  Shard& s = *shards_[i % shards_.size()];
+  const ports::IClock& clk = cfg_.free_run ? static_cast<const ports::IClock&>(s.vclock) : clock_;
+
+  auto inst = std::make_unique<Instance>(Instance{in, CountingOut(out, s.midi_out), nullptr});
+  inst->eng = std::make_unique<core::PatternEngine>(inst->out, clk, patterns);
+  if (in && !in->set_wakeup(&s.reactor)) s.polled = true;
+  s.inst.push_back(inst.get());
+  instances_.push_back(std::move(inst));
+  return i;
+}
+
+void ShardHost::start() {
+  if (running_.exchange(true)) return;
+  for (std::size_t w = 0; w < shards_.size(); ++w) {
+    Shard& s = *shards_[w];
+    s.ready.store(false);
+    s.thread = std::thread([this, &s, w] { run_(s, w); });
+  }
+  // Konfiguracja RT/pinningu zrobiona – status shardów można już czytać
+  for (auto& s : shards_)
+    while (!s->ready.load(std::memory_order_acquire)) std::this_thread::yield();
+}
+
+void ShardHost::wait() {
+  for (auto& s : shards_)
+    if (s->thread.joinable()) s->thread.join();
+}
+
+void ShardHost::stop() {
+  if (!cfg_.free_run) {
+    running_.store(false);
+    for (auto& s : shards_) s->reactor.wake();
+  }
+  wait();
+  running_.store(false);
+}
+
+bool ShardHost::set_bpm(double bpm) {
+  // Jedna chwila dla wszystkich: każdy silnik kotwiczy zmianę tu, niezależnie
+  // od tego, kiedy jego shard ją odbierze
+  const Tempo t{bpm, cfg_.free_run ? 0 : clock_.now_us()};
+  const auto give_up = std::chrono::steady_clock::now() + TEMPO_WAIT;
+  bool all = true;
+  for (auto& s : shards_) {
+    // Pełny pierścień: shard opróżnia go na początku każdego obrotu – budzimy
+    // i ponawiamy. Kolejność zmian zostaje (ostatnia wartość nie wystarczy:
+    // shardy muszą przejść te same kotwice). Przed start() nikt nie czyta.
+    while (!s->tempo.try_push(t)) {
+      if (!running_.load(std::memory_order_relaxed) || std::chrono::steady_clock::now() >= give_up) {
+        tempo_dropped_.fetch_add(1, std::memory_order_relaxed);
+        all = false;
+        break;
+      }
+      s->reactor.wake();
+      std::this_thread::yield();
+    }
+    s->reactor.wake();
+  }
+  return all;
+}
+
+ShardHost::Load ShardHost::load(std::size_t w) const {
+  const Shard& s = *shards_[w];
+  Load l;
+  l.instances   = s.inst.size();
+  l.loops       = s.loops.load(std::memory_order_relaxed);
+  l.midi_in     = s.midi_in.load(std::memory_order_relaxed);
+  l.midi_out    = s.midi_out.load(std::memory_order_relaxed);
+  l.max_busy_us = s.max_busy_ns.load(std::memory_order_relaxed) / 1000;
+  const int64_t since = s.since_ns.load(std::memory_order_relaxed);
+  const double wall = since ? static_cast<double>(steady_ns() - since) : 0.0;
+  l.wall_s      = wall / 1e9;
+  l.utilization = wall > 0 ? static_cast<double>(s.busy_ns.load(std::memory_order_relaxed)) / wall : 0.0;
+  if (s.ready.load(std::memory_order_acquire)) l.rt = s.rt;
+  return l;
+}
+
+void ShardHost::reset_load() {
+  // Liczniki zeruje wątek sterujący – pojedyncze obroty mogą się "zgubić", to tylko metryka
+  for (auto& s : shards_) {
+    s->busy_ns.store(0, std::memory_order_relaxed);
+    s->loops.store(0, std::memory_order_relaxed);
+    s->midi_in.store(0, std::memory_order_relaxed);
+    s->midi_out.store(0, std::memory_order_relaxed);
+    s->max_busy_ns.store(0, std::memory_order_relaxed);
+    s->since_ns.store(steady_ns(), std::memory_order_relaxed);
+  }
+}
+
+void ShardHost::run_(Shard& s, std::size_t w) {
+  using namespace std::chrono;
+  if (cfg_.rt || cfg_.first_cpu >= 0) {
+    RtOptions opt = cfg_.rt ? *cfg_.rt : RtOptions{};
+    opt.cpu = cfg_.first_cpu >= 0 ? cfg_.first_cpu + static_cast<int>(w) : -1;
+    opt.fifo = cfg_.rt != nullptr;          // bez --rt: samo przypięcie
+    s.rt = enter_realtime(opt);
+    if (cfg_.rt && !cfg_.free_run) s.waiter.calibrate(s.reactor);
+  }
+  s.since_ns.store(steady_ns(), std::memory_order_relaxed);
+  s.ready.store(true, std::memory_order_release);
+
+  const uint64_t end_us = cfg_.free_run_us;
+  while (cfg_.free_run ? s.vclock.now_us() < end_us : running_.load(std::memory_order_relaxed)) {
+    const int64_t t0 = steady_ns();
+
+    s.tempo.drain([&](const Tempo& t) {
+      for (auto* in : s.inst) in->eng->set_bpm_at(t.bpm, t.at_us);
+    });
+    for (auto* in : s.inst) {
+      if (!in->in) continue;
+      while (auto m = in->in->poll()) { in->eng->on_midi_in(*m); bump(s.midi_in); }
+    }
+    std::optional<uint64_t> dl;
+    for (auto* in : s.inst) {
+      in->eng->tick();
+      if (const auto d = in->eng->next_deadline_us(); d && (!dl || *d < *dl)) dl = d;
+    }
+
+    const auto busy = static_cast<uint64_t>(steady_ns() - t0);
+    bump(s.busy_ns, busy);
+    bump(s.loops);
+    if (busy > s.max_busy_ns.load(std::memory_order_relaxed)) s.max_busy_ns.store(busy, std::memory_order_relaxed);
+
+    if (cfg_.free_run) {
+      // czas wirtualny: prosto do następnego terminu (nic zaplanowanego => koniec)
+      if (!dl)                           s.vclock.set_us(end_us);
+      else if (*dl > s.vclock.now_us())  s.vclock.set_us(std::min(*dl, end_us));
+      continue;
+    }
+    if (s.polled) {
+      const uint64_t poll_at = clock_.now_us() + 1000;
+      if (!dl || *dl > poll_at) dl = poll_at;
+    }
+    // zegar silnika (µs) -> steady_clock: ta sama oś, przesunięta o różnicę "teraz"
+    std::optional<steady_clock::time_point> until;
+    if (dl) {
+      const uint64_t now = clock_.now_us();
+      until = steady_clock::now() + microseconds(*dl > now ? *dl - now : 0);
+    }
+    if (cfg_.rt) (void)s.waiter.wait(s.reactor, until);
+    else         s.reactor.wait(until);
+  }
+}
+
+} // namespace desktop_midi
@@ -0,0 +1,140 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "core/PatternEngine.hpp"
+#include "core/SpscRing.hpp"
+#include "desktop/HybridWait.hpp"
+#include "desktop/Reactor.hpp"
+#include "desktop/Realtime.hpp"
+#include "ports/Clock.hpp"
+#include "ports/Midi.hpp"
+#include "sim/VirtualClock.hpp"
+
+namespace desktop_midi {
+
+/*
+ * ShardHost – wiele niezależnych instancji PatternEngine (każda z własnym
+ * wejściem, wyjściem, akordem i patternami) rozłożonych na pulę wątków.
+ *
+ *  - instancja i trafia do shardu i % workers; shard = jeden wątek (opcjonalnie
+ *    przypięty do CPU first_cpu + w, opcjonalnie SCHED_FIFO) z własnym Reactorem,
+ *  - instancje się nie komunikują – shard nie dzieli z innymi niczego gorącego,
+ *    więc przepustowość rośnie z liczbą rdzeni,
+ *  - tempo ustawiamy dla wszystkich naraz: ta sama para (bpm, chwila) trafia
+ *    pierścieniem do każdego shardu, a silniki kotwiczą zmianę w tej samej
+ *    chwili – osie beatów zostają identyczne (patrz PatternEngine::set_bpm_at);
+ *    pełny pierścień => wątek sterujący budzi shard i ponawia (do TEMPO_WAIT),
+ *    zmiany nie przepadają po cichu – porażki liczy tempo_dropped(),
+ *  - każdy shard liczy obciążenie: czas pracy vs czas ściany, obroty pętli,
+ *    komunikaty IN/OUT, najdłuższy obrót.
+ *
+ * free_run: zamiast czekać na zegar, każdy shard przeskakuje własnym zegarem
+ * wirtualnym do kolejnego terminu – do pomiaru przepustowości (shard_bench).
+ *
+ * Instancje dodajemy i konfigurujemy (engine(i)) przed start(); potem silnik
+ * należy do wątku swojego shardu.
+ */
+class ShardHost {
+public:
+  struct Config {
+    std::size_t      workers   = 1;
+    int              first_cpu = -1;       // >= 0 => shard w przypięty do CPU first_cpu + w
+    const RtOptions* rt        = nullptr;  // SCHED_FIFO + HybridWait dla shardów
+    bool             free_run  = false;
+    uint64_t         free_run_us = 0;      // ile czasu wirtualnego liczy każdy shard
+  };
+
+  // Obciążenie shardu (odczyt z dowolnego wątku; wartości przybliżone)
+  struct Load {
+    std::size_t instances{0};
+    double   utilization{0};   // czas pracy / czas od startu (0..1)
+    uint64_t loops{0};
+    uint64_t midi_in{0};
+    uint64_t midi_out{0};
+    uint64_t max_busy_us{0};   // najdłuższy pojedynczy obrót pętli
+    double   wall_s{0};
+    RtStatus rt{};
+  };
+
+  ShardHost(const ports::IClock& clock, Config cfg);
+  ~ShardHost();
+  ShardHost(const ShardHost&) = delete;
+  ShardHost& operator=(const ShardHost&) = delete;
+
+  // in == nullptr => instancja bez wejścia. Zwraca numer instancji.
+  std::size_t add(ports::IMidiIn* in, ports::IMidiOut& out,
+                  std::size_t patterns = core::PatternEngine::DEFAULT_PATTERNS);
+  core::PatternEngine& engine(std::size_t i) { return *instances_[i]->eng; }
+  std::size_t size() const { return instances_.size(); }
+
+  void start();
+  void stop();                 // free_run: czeka, aż shardy skończą
+  void wait();                 // free_run: czekaj na koniec bez zatrzymywania
+
+  // Wspólne tempo dla wszystkich instancji (z wątku sterującego). Pełny
+  // pierścień shardu => czekamy, aż shard go opróżni, najwyżej TEMPO_WAIT.
+  // false => któryś shard zmiany nie dostał (liczone w tempo_dropped()).
+  static constexpr std::chrono::milliseconds TEMPO_WAIT{50};
+  bool set_bpm(double bpm);
+  uint64_t tempo_dropped() const { return tempo_dropped_.load(std::memory_order_relaxed); }
+
+  std::size_t workers() const { return shards_.size(); }
+  Load load(std::size_t w) const;
+  void reset_load();
+
+private:
+  // Wyjście instancji liczy komunikaty swojego shardu
+  class CountingOut final : public ports::IMidiOut {
+  public:
+    CountingOut(ports::IMidiOut& inner, std::atomic<uint64_t>& n) : inner_(inner), n_(n) {}
+    void send(const ports::MidiMsg& m) override { bump_(); inner_.send(m); }
+    void send_batch(const ports::MidiMsg* msgs, std::size_t k) override {
+      n_.store(n_.load(std::memory_order_relaxed) + k, std::memory_order_relaxed);
+      inner_.send_batch(msgs, k);
+    }
+    bool cancel_after(uint64_t after_us) override { return inner_.cancel_after(after_us); }
+  private:
+    ports::IMidiOut&       inner_;
+    std::atomic<uint64_t>& n_;
+    void bump_() { n_.store(n_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); }
+  };
+
+  struct Instance {
+    ports::IMidiIn* in;
+    CountingOut     out;
+    std::unique_ptr<core::PatternEngine> eng;
+  };
+
+  struct Tempo { double bpm; uint64_t at_us; };
+
+  struct Shard {
+    std::vector<Instance*> inst;
+    Reactor      reactor;
+    HybridWait   waiter;
+    VirtualClock vclock;
+    core::SpscRing<Tempo, 64> tempo;
+    bool         polled{false};            // któreś wejście nie budzi => śpimy max 1 ms
+    RtStatus     rt{};                     // pisze wątek przed ready
+    std::atomic<bool> ready{false};
+    std::thread  thread;
+
+    // liczniki (jeden pisarz – wątek shardu)
+    std::atomic<uint64_t> busy_ns{0}, loops{0}, midi_in{0}, midi_out{0}, max_busy_ns{0};
+    std::atomic<int64_t>  since_ns{0};     // początek okna pomiaru (steady_clock)
+  };
+
+  const ports::IClock& clock_;
+  Config cfg_;
+  std::vector<std::unique_ptr<Shard>>    shards_;
+  std::vector<std::unique_ptr<Instance>> instances_;
+  std::atomic<bool> running_{false};
+  std::atomic<uint64_t> tempo_dropped_{0};   // shardy, które nie dostały zmiany tempa
+
+  void run_(Shard& s, std::size_t w);
+};
+
+} // namespace desktop_midi
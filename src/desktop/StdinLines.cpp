@@ -0,0 +1,66 @@
+#include "desktop/StdinLines.hpp"
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+namespace desktop_midi {
+
+StdinLines::StdinLines() {
+  int fd[2];
+  if (::pipe(fd) != 0) return;                              // bez pipe'a: tylko stdin (jak getline)
+  stop_r_ = fd[0];
+  stop_w_ = fd[1];
+  for (int f : fd) ::fcntl(f, F_SETFD, FD_CLOEXEC);
+  ::fcntl(stop_w_, F_SETFL, ::fcntl(stop_w_, F_GETFL) | O_NONBLOCK);   // handler nie może czekać
+}
+
+StdinLines::~StdinLines() {
+  if (stop_r_ >= 0) ::close(stop_r_);
+  if (stop_w_ >= 0) ::close(stop_w_);
+}
+
+void StdinLines::stop() {
+  stopped_.store(true);
+  if (stop_w_ >= 0) {
+    const char one = 1;
+    (void)!::write(stop_w_, &one, 1);
+  }
+}
+
+bool StdinLines::take_line_(std::string& line) {
+  const auto nl = buf_.find('\n');
+  if (nl == std::string::npos) {
+    if (!eof_ || buf_.empty()) return false;
+    line.swap(buf_);                                        // ostatnia linia bez '\n'
+    buf_.clear();
+    return true;
+  }
+  line.assign(buf_, 0, nl);
+  buf_.erase(0, nl + 1);
+  return true;
+}
+
+bool StdinLines::next(std::string& line) {
+  for (;;) {
+    if (stopped_.load()) return false;
+    if (take_line_(line)) return true;
+    if (eof_) return false;
+
+    pollfd fds[2] = {{STDIN_FILENO, POLLIN, 0}, {stop_r_, POLLIN, 0}};
+    const int r = ::poll(fds, stop_r_ >= 0 ? 2 : 1, -1);
+    if (r < 0) { if (errno == EINTR) continue; return false; }
+    if (stop_r_ >= 0 && fds[1].revents) return false;
+    if (!fds[0].revents) continue;
+
+    char chunk[4096];
+    const ssize_t n = ::read(STDIN_FILENO, chunk, sizeof chunk);
+    if (n < 0) { if (errno == EINTR || errno == EAGAIN) continue; return false; }
+    if (n == 0) eof_ = true;
+    else        buf_.append(chunk, static_cast<std::size_t>(n));
+  }
+}
+
+} // namespace desktop_midi
@@ -0,0 +1,39 @@
+#pragma once
+#include <atomic>
+#include <string>
+
+namespace desktop_midi {
+
+/*
+ * StdinLines – linie ze stdin, które da się przerwać.
+ *
+ * std::getline(std::cin) śpi w read() i nic go nie obudzi: po SIGINT wątek CLI
+ * (albo pętla rack) czekałby na Enter, a program – na niego przy wyjściu.
+ * Tutaj poll() czeka na stdin ORAZ na self-pipe; stop() pisze do pipe'a
+ * (write() jest async-signal-safe, więc wolno z handlera sygnału) i next()
+ * wraca z false. Niepełna ostatnia linia przed EOF też jest linią.
+ *
+ * Jeden czytelnik (next); stop() z dowolnego wątku. Po stop() next() zawsze false.
+ * Nie mieszać z std::cin – bufor jest tutaj.
+ */
+class StdinLines {
+public:
+  StdinLines();
+  ~StdinLines();
+  StdinLines(const StdinLines&) = delete;
+  StdinLines& operator=(const StdinLines&) = delete;
+
+  // Następna linia bez '\n'; false => EOF, błąd albo stop()
+  bool next(std::string& line);
+  void stop();
+
+private:
+  int stop_r_{-1}, stop_w_{-1};
+  std::atomic<bool> stopped_{false};
+  std::string buf_;
+  bool eof_{false};
+
+  bool take_line_(std::string& line);
+};
+
+} // namespace desktop_midi
@@ -0,0 +1,71 @@
+#include "desktop/TraceRecorder.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+namespace desktop_midi {
+
+namespace {
+// Co ile dopisujemy paczkę – plik nie musi być aktualny co do milisekundy
+constexpr auto DRAIN_PERIOD = std::chrono::milliseconds(20);
+} // namespace
+
+bool TraceRecorder::open(const std::string& path, const core::PatternEngine& eng, std::string& err) {
+  if (open_.load()) { err = "trace already open"; return false; }
+  file_ = std::fopen(path.c_str(), "wb");
+  if (!file_) { err = "cannot create " + path + ": " + std::strerror(errno); return false; }
+
+  const auto n = static_cast<uint32_t>(eng.num_patterns());
+  const auto hdr = core::make_trace_header(eng.engine_config(), latched_.now_us(), n);
+  std::vector<unsigned char> head(core::trace_events_offset(n), 0);
+  std::memcpy(head.data(), &hdr, sizeof hdr);
+  for (uint32_t i = 0; i < n; ++i) {
+    const auto rec = core::to_bank_record(eng.pattern(i));
+    std::memcpy(head.data() + sizeof hdr + i * sizeof rec, &rec, sizeof rec);
+  }
+  if (std::fwrite(head.data(), 1, head.size(), file_) != head.size()) {
+    err = "cannot write " + path;
+    std::fclose(file_);
+    file_ = nullptr;
+    return false;
+  }
+
+  running_.store(true);
+  open_.store(true);
+  writer_ = std::thread([this] { run_(); });
+  return true;
+}
+
+TraceRecorder::~TraceRecorder() {
+  open_.store(false);
+  running_.store(false);
+  if (writer_.joinable()) writer_.join();
+  if (!file_) return;
+  // Liczba zgubionych zdarzeń – do nagłówka (replay ostrzeże o niepełnym śladzie)
+  const auto lost = static_cast<uint32_t>(ring_.dropped());
+  if (lost && std::fseek(file_, static_cast<long>(offsetof(core::TraceHeader, dropped)), SEEK_SET) == 0)
+    (void)std::fwrite(&lost, sizeof lost, 1, file_);
+  std::fclose(file_);
+}
+
+void TraceRecorder::run_() {
+  std::vector<core::TraceEvent> batch;
+  batch.reserve(8192);
+  for (;;) {
+    const bool last = !running_.load();
+    batch.clear();
+    ring_.drain([&](const core::TraceEvent& e) { batch.push_back(e); });
+    if (!batch.empty()) {
+      (void)std::fwrite(batch.data(), sizeof(core::TraceEvent), batch.size(), file_);
+      recorded_.fetch_add(batch.size(), std::memory_order_relaxed);
+    }
+    if (last) break;
+    std::this_thread::sleep_for(DRAIN_PERIOD);
+  }
+  std::fflush(file_);
+}
+
+} // namespace desktop_midi
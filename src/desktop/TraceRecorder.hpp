@@ -0,0 +1,111 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include "core/PatternEngine.hpp"
+#include "core/SpscRing.hpp"
+#include "core/Trace.hpp"
+#include "ports/Clock.hpp"
+#include "ports/Midi.hpp"
+
+namespace desktop_midi {
+
+/*
+ * TraceRecorder – nagrywa sesję silnika do pliku śladu (core/Trace.hpp),
+ * który arp_replay odtwarza bit w bit.
+ *
+ * Silnik dostaje clock() – zegar "zatrzaśnięty": stoi między wywołaniami,
+ * a pętla silnika przestawia go na teraz hookiem przed każdym wywołaniem
+ * (input / tick / tempo / latch). Dzięki temu zapisana chwila to dokładnie ta,
+ * którą silnik przeczytał. Wyjście silnika idzie przez tap(out) – zapis
+ * Out/Cancel, potem dalej do właściwego backendu.
+ *
+ * Hooki i tap woła tylko wątek silnika: zdarzenie (16 B) trafia do pierścienia
+ * SPSC bez blokad i alokacji; wątek zapisujący co kilkanaście ms dopisuje
+ * paczkę do pliku. Pierścień pełny => zdarzenie przepada, liczba zgubionych
+ * ląduje w nagłówku przy zamknięciu (replay ostrzega).
+ *
+ * Edycje patternów w trakcie (CLI, banki): silnik zgłasza każdą odebraną
+ * publikację przez patterns() (core::PatternTap) w tick(), więc zapis ma
+ * chwilę zatrzaśniętą dla tego ticku – arp_replay publikuje ją przed nim.
+ */
+class TraceRecorder {
+public:
+  explicit TraceRecorder(const ports::IClock& clock) : latched_(clock), tap_(*this), pattern_tap_(*this) {}
+  ~TraceRecorder();
+  TraceRecorder(const TraceRecorder&) = delete;
+  TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+  // Zegar dla silnika
+  const ports::IClock& clock() const { return latched_; }
+  // Wyjście silnika: zapisz i przekaż do 'out'
+  ports::IMidiOut& tap(ports::IMidiOut& out) { tap_.out = &out; return tap_; }
+  // Podsłuch publikacji dla silnika (PatternEngine::set_pattern_tap)
+  core::PatternTap& patterns() { return pattern_tap_; }
+
+  // Nagłówek (migawka konfiguracji i patternów silnika) + start zapisu.
+  // Po set_engine_config(): chwila konfiguracji = ostatni latch().
+  bool open(const std::string& path, const core::PatternEngine& eng, std::string& err);
+
+  // Hooki pętli silnika – przed odpowiednim wywołaniem silnika
+  uint64_t latch() { return latched_.latch(); }
+  void input(const ports::MidiMsg& m) { push_(core::trace_input(m, latch())); }
+  void tick() { push_(core::trace_tick(latch())); }
+  void tempo(double bpm) { push_(core::trace_tempo(bpm, latch())); }
+
+  uint64_t recorded() const { return recorded_.load(std::memory_order_relaxed); }
+  uint64_t dropped() const { return ring_.dropped(); }
+
+private:
+  class LatchedClock final : public ports::IClock {
+  public:
+    explicit LatchedClock(const ports::IClock& src) : src_(src) {}
+    uint64_t now_us() const override { return t_us_; }
+    uint64_t latch() { t_us_ = src_.now_us(); return t_us_; }
+  private:
+    const ports::IClock& src_;
+    uint64_t t_us_{0};
+  };
+
+  struct Tap final : ports::IMidiOut {
+    explicit Tap(TraceRecorder& r) : rec(r) {}
+    void send(const ports::MidiMsg& m) override { rec.push_(core::trace_output(m)); out->send(m); }
+    void send_batch(const ports::MidiMsg* msgs, std::size_t n) override {
+      for (std::size_t i = 0; i < n; ++i) rec.push_(core::trace_output(msgs[i]));
+      out->send_batch(msgs, n);
+    }
+    bool cancel_after(uint64_t after_us) override {
+      const bool ok = out->cancel_after(after_us);
+      rec.push_(core::trace_cancel(after_us, ok));
+      return ok;
+    }
+    TraceRecorder&   rec;
+    ports::IMidiOut* out{nullptr};
+  };
+
+  struct PatternRec final : core::PatternTap {
+    explicit PatternRec(TraceRecorder& r) : rec(r) {}
+    void collected(uint32_t pattern, const core::PatternSnapshot& snap) override {
+      core::trace_pattern(pattern, snap.when, core::to_bank_record(snap.cfg), rec.latched_.now_us(),
+                          [this](const core::TraceEvent& e) { rec.push_(e); });
+    }
+    TraceRecorder& rec;
+  };
+
+  LatchedClock latched_;
+  Tap          tap_;
+  PatternRec   pattern_tap_;
+  core::SpscRing<core::TraceEvent, 8192> ring_;
+  std::atomic<bool>     open_{false};
+  std::atomic<bool>     running_{false};
+  std::atomic<uint64_t> recorded_{0};
+  std::FILE*            file_{nullptr};
+  std::thread           writer_;
+
+  void push_(const core::TraceEvent& e) { if (open_.load(std::memory_order_relaxed)) (void)ring_.try_push(e); }
+  void run_();
+};
+
+} // namespace desktop_midi
@@ -1,160 +1,505 @@
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <optional>
 #include <thread>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
 #include "ports/Clock.hpp"
 #include "ports/Midi.hpp"
 #include "desktop/DesktopMidi.hpp"
+#include "desktop/EventLog.hpp"
+#include "desktop/BankLibrary.hpp"
+#include "desktop/HybridWait.hpp"
+#include "desktop/RawMidi.hpp"
+#include "desktop/Reactor.hpp"
+#include "desktop/Realtime.hpp"
+#include "desktop/ScheduledOut.hpp"
+#include "desktop/ShardHost.hpp"
+#include "desktop/StdinLines.hpp"
+#include "desktop/TraceRecorder.hpp"
 #include "core/PatternEngine.hpp"
-#include "core/PatternBuilder.hpp"
+#include "core/FactoryPatterns.hpp"
+#include "core/PatternEditor.hpp"
+#include "core/Stats.hpp"
+#include "core/VoiceTracker.hpp"
 #include "ui/Cli.hpp"
+#include "ui/StatsView.hpp"
 
 class DesktopClock final : public ports::IClock {
 public:
-  uint64_t now_ms() const override {
+  uint64_t now_us() const override {
     using namespace std::chrono;
-    static const auto t0 = steady_clock::now();
-    return duration_cast<milliseconds>(steady_clock::now() - t0).count();
+    return duration_cast<microseconds>(steady_clock::now() - t0_()).count();
+  }
+  // Odwrotnie: czas silnika (µs) -> punkt na steady_clock (dla Reactor::wait)
+  std::chrono::steady_clock::time_point at_us(uint64_t us) const {
+    return t0_() + std::chrono::microseconds(us);
+  }
+private:
+  static std::chrono::steady_clock::time_point t0_() {
+    static const auto t0 = std::chrono::steady_clock::now();
+    return t0;
   }
 };
 
 static std::atomic<bool> g_running{true};
-void handle_sigint(int){ g_running.store(false); }
+static std::atomic<desktop_midi::Reactor*> g_reactor{nullptr};
+static std::atomic<desktop_midi::StdinLines*> g_stdin{nullptr};
+void handle_sigint(int){
+  g_running.store(false);
+  if (auto* r = g_reactor.load()) r->wake(); // eventfd write – bezpieczne w handlerze
+  if (auto* s = g_stdin.load()) s->stop();   // jw. (pipe) – CLI nie czeka na Enter
+}
+
+// Cel handle_sigint na czas życia obiektu: wskaźnik zerowany przy każdym
+// wyjściu z zakresu (błąd, wyjątek, koniec) – przed zniszczeniem obiektu,
+// więc handler nigdy nie sięgnie po wiszący wskaźnik
+template<class T>
+class SigintTarget {
+public:
+  SigintTarget(std::atomic<T*>& slot, T& obj) : slot_(slot) { slot_.store(&obj); }
+  ~SigintTarget() { slot_.store(nullptr); }
+  SigintTarget(const SigintTarget&) = delete;
+  SigintTarget& operator=(const SigintTarget&) = delete;
+private:
+  std::atomic<T*>& slot_;
+};
+
+static void print_usage() {
+  std::cout <<
+    "Usage: midi_arp [options]\n"
+    "  --poll-input   poll MIDI IN from the main loop instead of RtMidi callback\n"
+    "  --patterns N   number of patterns in the engine (default 4)\n"
+    "  --stats-out F  write timing stats as JSON to file F on exit\n"
+    "  --lookahead MS render MS ahead, send from a timed sender thread (0 = off)\n"
+    "  --held N       max held chord notes, 1..128 (default 8; 128 = whole keyboard)\n"
+    "  --ext-clock    follow MIDI Clock / Start / Stop from MIDI IN (bpm ignored)\n"
+    "  --rt           realtime mode: engine (and sender) thread with SCHED_FIFO,\n"
+    "                 locked memory, hybrid sleep/spin wait; degrades if not permitted\n"
+    "  --rt-prio N    SCHED_FIFO priority for --rt (default 80)\n"
+    "  --rt-cpu N     pin realtime threads to CPU N\n"
+    "  --rack N       N independent arpeggiators on MIDI port pairs 0..N-1\n"
+    "  --workers W    rack: worker threads (default: CPU count); pinned from --rt-cpu\n"
+    "  --raw-in P     read MIDI IN bytes from a file/device/FIFO P instead of RtMidi\n"
+    "                 (e.g. /dev/snd/midiC1D0); --poll-input applies too\n"
+    "  --raw-out P    write MIDI OUT bytes to P instead of RtMidi (a regular file is created/truncated)\n"
+    "                 (running status + NoteOff as NoteOn vel 0 to save DIN bandwidth)\n"
+    "  --full-status  raw out: always send full messages (ports that reject running status)\n"
+    "  --voices N     max sounding notes per MIDI channel, 1..128 (default 128)\n"
+    "  --steal P      full channel: oldest|lowest|highest note makes room, none = drop new\n"
+    "  --record F     record MIDI IN, timing and engine output to trace file F (arp_replay)\n"
+    "  --help         show this help\n";
+}
+
+// Zwolnij to, co brzmi, i podsumuj pracę VoiceTrackera. Wołać po zatrzymaniu
+// tego, co pisze do trackera (pętla, wątek wysyłający – ten dosyła swoje OFF-y);
+// OFF-y, które silnik trzymał jeszcze u siebie, nie wyjdą już nigdy.
+static void release_voices(core::VoiceTracker& v, const ports::IClock& clock, const char* who) {
+  const std::size_t freed = v.release_all(clock.now_us());
+  const auto& c = v.counters();
+  if (freed || c.retriggers || c.steals || c.rejected)
+    std::cout << who << "voices: " << freed << " released on exit, " << c.retriggers << " retriggers, "
+              << c.steals << " stolen, " << c.rejected << " rejected, " << c.redundant << " redundant offs dropped\n";
+}
+
+// Tryb "rack": N niezależnych silników (para portów i na instancję) rozłożonych
+// na wątki ShardHost. Wspólne jest tylko tempo; sterowanie prostymi komendami.
+static int run_rack(const ports::IClock& clock, desktop_midi::StdinLines& input,
+                    desktop_midi::InputMode inMode, std::size_t n,
+                    std::size_t workers, std::size_t numPatterns, std::size_t maxHeld,
+                    core::VoiceTracker::Options vopt, bool rt, desktop_midi::RtOptions rtOpt) {
+  desktop_midi::ShardHost::Config hc;
+  hc.workers   = workers ? workers : std::max(1u, std::thread::hardware_concurrency());
+  hc.workers   = std::min(hc.workers, n);
+  hc.first_cpu = rtOpt.cpu;
+  hc.rt        = rt ? &rtOpt : nullptr;
+  desktop_midi::ShardHost host(clock, hc);
+
+  std::vector<std::unique_ptr<ports::IMidiIn>>  ins;
+  std::vector<std::unique_ptr<ports::IMidiOut>> outs;
+  std::vector<std::unique_ptr<core::VoiceTracker>> voices;
+  core::EngineConfig ec;
+  ec.bpm = 122.0;
+  ec.overlap_ms = 12;
+  ec.chord_capacity = static_cast<uint8_t>(maxHeld);
+  for (std::size_t i = 0; i < n; ++i) {
+    // Bez EventLog – ten ma jednego producenta, a tu piszą wszystkie shardy
+    ins.push_back(desktop_midi::makeIn(clock, inMode, static_cast<int>(i)));
+    outs.push_back(desktop_midi::makeOut(nullptr, static_cast<int>(i)));
+    voices.push_back(std::make_unique<core::VoiceTracker>(*outs.back(), vopt));
+    auto& eng = host.engine(host.add(ins.back().get(), *voices.back(), numPatterns));
+    eng.set_engine_config(ec);
+    core::load_factory_patterns(eng);
+  }
+
+  host.start();
+  std::cout << "Rack: " << n << " instances on " << host.workers() << " worker(s)\n";
+  for (std::size_t w = 0; w < host.workers(); ++w)
+    std::cout << "  shard " << w << ": " << desktop_midi::describe(host.load(w).rt) << "\n";
+  std::cout << "Commands: bpm N | load | reset | quit\n";
+
+  std::string line;
+  while (g_running.load() && input.next(line)) {
+    if (line.rfind("bpm ", 0) == 0) {
+      const double bpm = std::clamp(std::atof(line.c_str() + 4), 20.0, 300.0);
+      if (host.set_bpm(bpm)) std::cout << "BPM = " << bpm << " (all instances)\n";
+      else std::cout << "BPM = " << bpm << " NOT applied on every shard (" << host.tempo_dropped()
+                     << " missed so far) – shards desynchronized\n";
+    } else if (line == "load") {
+      for (std::size_t w = 0; w < host.workers(); ++w) {
+        const auto l = host.load(w);
+        std::printf("  shard %zu: %zu inst, util %5.1f%%, loops %llu, in %llu, out %llu, max loop %llu us\n",
+                    w, l.instances, l.utilization * 100.0, (unsigned long long)l.loops,
+                    (unsigned long long)l.midi_in, (unsigned long long)l.midi_out,
+                    (unsigned long long)l.max_busy_us);
+      }
+      std::fflush(stdout);
+    } else if (line == "reset") {
+      host.reset_load();
+      std::cout << "load reset\n";
+    } else if (line == "quit" || line == "q") {
+      break;
+    } else if (!line.empty()) {
+      std::cout << "Commands: bpm N | load | reset | quit\n";
+    }
+  }
+  host.stop();
+  for (std::size_t i = 0; i < n; ++i)
+    release_voices(*voices[i], clock, ("[" + std::to_string(i) + "] ").c_str());
+  std::cout << "Bye\n";
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  auto inMode = desktop_midi::InputMode::Callback;
+  std::size_t numPatterns = core::PatternEngine::DEFAULT_PATTERNS;
+  const char* statsOut = nullptr;
+  const char* recordPath = nullptr;
+  const char* rawIn = nullptr;
+  const char* rawOut = nullptr;
+  core::MidiEncoder::Options rawEnc;
+  core::VoiceTracker::Options voiceOpt;
+  int lookaheadMs = 0;
+  bool extClock = false;
+  bool rt = false;
+  desktop_midi::RtOptions rtOpt;
+  std::size_t rack = 0, workers = 0;
+  std::size_t maxHeld = core::MAX_HELD_NOTES;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if      (arg == "--poll-input") inMode = desktop_midi::InputMode::Poll;
+    else if (arg == "--patterns" && i + 1 < argc) {
+      numPatterns = std::max<std::size_t>(2, std::strtoul(argv[++i], nullptr, 10));
+    }
+    else if (arg == "--stats-out" && i + 1 < argc) statsOut = argv[++i];
+    else if (arg == "--record" && i + 1 < argc) recordPath = argv[++i];
+    else if (arg == "--raw-in" && i + 1 < argc)  rawIn = argv[++i];
+    else if (arg == "--raw-out" && i + 1 < argc) rawOut = argv[++i];
+    else if (arg == "--full-status") rawEnc = core::MidiEncoder::Options{false, false};
+    else if (arg == "--voices" && i + 1 < argc) {
+      voiceOpt.voices = static_cast<uint8_t>(std::clamp<unsigned long>(std::strtoul(argv[++i], nullptr, 10), 1, core::MAX_CHORD_NOTES));
+    }
+    else if (arg == "--steal" && i + 1 < argc) {
+      const std::string p = argv[++i];
+      using S = core::VoiceTracker::Steal;
+      if      (p == "oldest")  voiceOpt.steal = S::Oldest;
+      else if (p == "lowest")  voiceOpt.steal = S::Lowest;
+      else if (p == "highest") voiceOpt.steal = S::Highest;
+      else if (p == "none")    voiceOpt.steal = S::None;
+      else { std::cerr << "--steal: oldest | lowest | highest | none\n"; return 1; }
+    }
+    else if (arg == "--lookahead" && i + 1 < argc) {
+      lookaheadMs = std::clamp(std::atoi(argv[++i]), 0, 1000);
+    }
+    else if (arg == "--held" && i + 1 < argc) {
+      maxHeld = std::clamp<std::size_t>(std::strtoul(argv[++i], nullptr, 10), 1, core::MAX_CHORD_NOTES);
+    }
+    else if (arg == "--ext-clock") extClock = true;
+    else if (arg == "--rt") rt = true;
+    else if (arg == "--rt-prio" && i + 1 < argc) rtOpt.priority = std::clamp(std::atoi(argv[++i]), 1, 99);
+    else if (arg == "--rt-cpu" && i + 1 < argc)  rtOpt.cpu = std::max(0, std::atoi(argv[++i]));
+    else if (arg == "--rack" && i + 1 < argc)    rack = std::strtoul(argv[++i], nullptr, 10);
+    else if (arg == "--workers" && i + 1 < argc) workers = std::strtoul(argv[++i], nullptr, 10);
+    else if (arg == "--help" || arg == "-h") { print_usage(); return 0; }
+    else { std::cerr << "Unknown option: " << arg << "\n"; print_usage(); return 1; }
+  }
+
+  // RT: pamięć blokujemy, zanim powstaną wątki i bufory
+  if (rt) {
+    std::string why;
+    if (desktop_midi::lock_memory(why)) std::cout << "RT: memory locked\n";
+    else                                std::cout << "RT: memory not locked [" << why << "]\n";
+  }
 
-int main() {
-  std::signal(SIGINT, handle_sigint);
   DesktopClock clock;
+  desktop_midi::StdinLines stdinLines;
+  const SigintTarget stdinTarget(g_stdin, stdinLines);
+  if (rack > 0) {
+    if (recordPath || rawIn || rawOut) {
+      std::cerr << "--record / --raw-in / --raw-out work with a single engine only (no --rack)\n";
+      return 1;
+    }
+    std::signal(SIGINT, handle_sigint);
+    return run_rack(clock, stdinLines, inMode, rack, workers, numPatterns, maxHeld, voiceOpt, rt, rtOpt);
+  }
 
-  auto midiIn  = desktop_midi::makeIn(clock);
-  auto midiOut = desktop_midi::makeOut();
+  desktop_midi::Reactor reactor;
+  const SigintTarget reactorTarget(g_reactor, reactor);
+  std::signal(SIGINT, handle_sigint);
 
-  core::PatternEngine eng(*midiOut, clock);
+  desktop_midi::EventLog outLog(desktop_midi::LogLevel::Notes);
+  std::unique_ptr<ports::IMidiIn>  midiIn;
+  std::unique_ptr<ports::IMidiOut> midiOut;
+  desktop_midi::RawMidiOut* rawMidiOut = nullptr;
+  // Brak portu / nieotwieralna ścieżka => komunikat i kod błędu, nie abort
+  try {
+    midiIn = rawIn ? desktop_midi::makeRawIn(rawIn, clock, inMode) : desktop_midi::makeIn(clock, inMode);
+    if (rawOut) {
+      auto o = desktop_midi::makeRawOut(rawOut, &outLog, rawEnc);
+      rawMidiOut = o.get();
+      midiOut = std::move(o);
+    } else {
+      midiOut = desktop_midi::makeOut(&outLog);
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "MIDI: " << e.what() << "\n";
+    return 1;
+  }
+  // Wejście bez budzika (polling) => pętla nie może spać dłużej niż 1 ms
+  const bool inWakes = midiIn->set_wakeup(&reactor);
+
+  // Pomiar spóźnień na samym wyjściu (przed backendem)
+  core::StatsOut statOut(*midiOut, clock);
+  // Brzmiące nuty (retrigger, limit głosów, panic) – za wątkiem wysyłającym,
+  // więc widzi tylko to, co naprawdę wychodzi
+  core::VoiceTracker voices(statOut, voiceOpt);
+  // Lookahead: silnik oddaje paczki, wysyła je osobny wątek w zaplanowanych chwilach
+  std::optional<desktop_midi::ScheduledOut> sched;
+  if (lookaheadMs > 0) sched.emplace(voices, clock, rt ? &rtOpt : nullptr);
+  if (sched && sched->rt_status())
+    std::cout << "RT sender thread: " << desktop_midi::describe(*sched->rt_status()) << "\n";
+  ports::IMidiOut& backOut = sched ? static_cast<ports::IMidiOut&>(*sched) : voices;
+
+  // Nagrywanie sesji: silnik na zegarze zatrzaskiwanym przez pętlę, wyjście przez podsłuch
+  std::optional<desktop_midi::TraceRecorder> rec;
+  if (recordPath) rec.emplace(clock);
+  const ports::IClock& engClock = rec ? rec->clock() : static_cast<const ports::IClock&>(clock);
+  ports::IMidiOut& engOut = rec ? rec->tap(backOut) : backOut;
+
+  core::PatternEngine eng(engOut, engClock, numPatterns);
+  const core::PatternEngine& ceng = eng;        // podgląd bez oznaczania edycji
 
   // Global config
   core::EngineConfig ec;
   ec.bpm = 122.0;
   ec.overlap_ms = 12;
+  ec.lookahead_ms = static_cast<uint16_t>(lookaheadMs);
+  ec.external_clock = extClock;
+  ec.chord_capacity = static_cast<uint8_t>(maxHeld);
+  if (rec) rec->latch();
   eng.set_engine_config(ec);
 
-  // Pattern 0 przez builder
-  auto& p0 = eng.pattern(0);
-  p0.channel  = 1;
-  p0.division = 2; // ósemki
-  core::PatternBuilder b0(p0);
-  b0.clear()
-    .indices({1,3,2})
-    .each().gate(70).vel(100).oct(0).prob(100).on().done();
-
-  // Opcjonalnie pattern 1
-  auto& p1 = eng.pattern(1);
-  p1.channel  = 2;
-  p1.division = 4; // szesnastki
-  core::PatternBuilder b1(p1);
-  b1.clear().indices({1,2,3}).each().gate(50).vel(90).oct(+1).on().done();
-
-  // CLI
+  // Patterny startowe (0: ósemki, 1: szesnastki)
+  core::load_factory_patterns(eng);
+
+  if (rec) {
+    std::string err;
+    if (!rec->open(recordPath, eng, err)) { std::cerr << err << "\n"; return 1; }
+    eng.set_pattern_tap(&rec->patterns());   // edycje z CLI / banków też do śladu
+    std::cout << "Recording session trace to " << recordPath << "\n";
+  }
+
+  // Edycje z CLI: szkice + publikacja migawek (silnik nie czyta tego, co się edytuje)
+  core::PatternEditor editor(eng, &reactor);
+  // Banki patternów z plików (load/save w CLI, przeładowanie po zmianie pliku)
+  desktop_midi::BankLibrary banks(editor);
+
+  // RT: punktualność wybudzeń pętli silnika (i wątku wysyłającego, jeśli jest)
+  desktop_midi::HybridWait waiter;
+
+  // 'stats': pętla silnika kopiuje tu statystyki, wątek CLI je wypisuje.
+  // Rozmiar ustalony teraz – kopia w pętli nie alokuje.
+  ui::StatsSnapshot statSnap;
+  statSnap.engine = eng.stats();
+
+  // CLI – odpowiedzi pętli silnika wypisuje wątek CLI
   ui::CommandQueue cq;
-  auto cli_thread = ui::start_cli(g_running, cq);
+  cq.set_wakeup(&reactor);
+  const auto print_reply = [&](const ui::Reply& r) {
+    using T = ui::Command::Type;
+    switch (r.type) {
+      case T::SetBpm:
+        if (r.external_clock) std::cout << "BPM follows external clock (" << r.bpm << ")\n";
+        else                  std::cout << "BPM = " << r.bpm << "\n";
+        break;
+      case T::SetLogLevel:
+        std::cout << "log level = " << r.a << " (dropped " << r.log_dropped << ")\n";
+        break;
+      case T::Stats:
+        if (r.a == 2) { std::cout << "stats reset\n"; break; }
+        std::cout << std::flush;
+        ui::print_stats(statSnap, r.a == 1);
+        std::fflush(stdout);
+        break;
+      case T::Panic:
+        std::cout << "panic: all notes off\n";
+        break;
+      default:
+        break;
+    }
+  };
+  auto cli_thread = ui::start_cli(g_running, cq, editor, &banks, print_reply,
+                                  [&](std::string& line) { return stdinLines.next(line); });
   std::cout << "Ready. Type 'help'.\n";
 
-  using clock_t = std::chrono::steady_clock;
-  auto next = clock_t::now();
-
-  while (g_running.load()) {
-    // MIDI IN
-    while (auto m = midiIn->poll()) eng.on_midi_in(*m);
-
-    // Komendy z CLI (aplikuj TYLKO tutaj, w wątku głównym)
-    for (auto& cmd : cq.drain()) {
-      using T = ui::Command::Type;
-      switch (cmd.type) {
-        case T::Help: ui::print_help(); break;
-        case T::Show: {
-          if (cmd.a >= 0 && cmd.a < (int)core::PatternEngine::NUM_PATTERNS) {
-            ui::print_pattern(eng.pattern((std::size_t)cmd.a), cmd.a);
-          } else {
-            for (int i = 0; i < (int)core::PatternEngine::NUM_PATTERNS; ++i)
-              ui::print_pattern(eng.pattern((std::size_t)i), i);
-          }
-        } break;
-        case T::SetBpm: {
-          ec.bpm = (cmd.a > 0 ? cmd.a : (int)ec.bpm);
-          eng.set_engine_config(ec);
-          std::cout << "BPM = " << ec.bpm << "\n";
-        } break;
-        case T::SetPatDiv: {
-          int pat = cmd.a, div = cmd.b;
-          if (pat>=0 && pat<(int)core::PatternEngine::NUM_PATTERNS && div>0) {
-            eng.pattern((std::size_t)pat).division = (uint16_t)div;
-            std::cout << "pat " << pat << " division = " << div << "\n";
-          }
-        } break;
-        case T::SetPatLen: {
-          int pat = cmd.a, len = cmd.b;
-          if (pat>=0 && pat<(int)core::PatternEngine::NUM_PATTERNS) {
-            auto& p = eng.pattern((std::size_t)pat);
-            p.length = (std::size_t)std::clamp(len, 0, (int)core::MAX_STEPS);
-            std::cout << "pat " << pat << " length = " << p.length << "\n";
-          }
-        } break;
-        case T::SetStepIdx: {
-          int pat=cmd.a, st=cmd.b, v=cmd.c;
-          if (pat>=0 && pat<(int)core::PatternEngine::NUM_PATTERNS) {
-            auto& p = eng.pattern((std::size_t)pat);
-            if (st>=0 && st<(int)p.length) { p.steps[(std::size_t)st].note_index = (uint8_t)std::clamp(v,0,8); }
-          }
-        } break;
-        case T::SetStepVel: {
-          int pat=cmd.a, st=cmd.b, v=cmd.c;
-          if (pat>=0 && pat<(int)core::PatternEngine::NUM_PATTERNS) {
-            auto& p = eng.pattern((std::size_t)pat);
-            if (st>=0 && st<(int)p.length) { p.steps[(std::size_t)st].velocity = (uint8_t)std::clamp(v,1,127); }
-          }
-        } break;
-        case T::SetStepGate: {
-          int pat=cmd.a, st=cmd.b, v=cmd.c;
-          if (pat>=0 && pat<(int)core::PatternEngine::NUM_PATTERNS) {
-            auto& p = eng.pattern((std::size_t)pat);
-            if (st>=0 && st<(int)p.length) { p.steps[(std::size_t)st].gate_pct = (uint8_t)std::clamp(v,1,200); }
-          }
-        } break;
-        case T::SetStepOct: {
-          int pat=cmd.a, st=cmd.b, v=cmd.c;
-          if (pat>=0 && pat<(int)core::PatternEngine::NUM_PATTERNS) {
-            auto& p = eng.pattern((std::size_t)pat);
-            if (st>=0 && st<(int)p.length) { p.steps[(std::size_t)st].octave = (int8_t)std::clamp(v,-8,8); }
-          }
-        } break;
-        case T::SetStepProb: {
-          int pat=cmd.a, st=cmd.b, v=cmd.c;
-          if (pat>=0 && pat<(int)core::PatternEngine::NUM_PATTERNS) {
-            auto& p = eng.pattern((std::size_t)pat);
-            if (st>=0 && st<(int)p.length) { p.steps[(std::size_t)st].probability = (uint8_t)std::clamp(v,0,100); }
-          }
-        } break;
-        case T::ToggleStep: {
-          int pat=cmd.a, st=cmd.b, on=cmd.c;
-          if (pat>=0 && pat<(int)core::PatternEngine::NUM_PATTERNS) {
-            auto& p = eng.pattern((std::size_t)pat);
-            if (st>=0 && st<(int)p.length) { p.steps[(std::size_t)st].enabled = (on!=0); }
-          }
-        } break;
-        case T::Quit:
-          g_running.store(false);
-          break;
-      }
+  const auto print_wakeups = [&](std::FILE* f) {
+    if (rt) ui::print_wakeup(f, "engine loop", waiter.lateness(), waiter.spin_us());
+    if (sched && sched->waiter()) ui::print_wakeup(f, "sender", sched->waiter()->lateness(), sched->waiter()->spin_us());
+  };
+  const auto timing_waiter = [&]() -> const desktop_midi::HybridWait* {
+    if (sched) return sched->waiter();
+    return rt ? &waiter : nullptr;
+  };
+  // Kopia do wypisania w wątku CLI (same przypisania do gotowych buforów)
+  const auto snapshot_stats = [&](ui::StatsSnapshot& s) {
+    using W = ui::StatsSnapshot;
+    s.engine = eng.stats();
+    s.output = statOut.stats();
+    const desktop_midi::HybridWait* w[2] = {rt ? &waiter : nullptr, sched ? sched->waiter() : nullptr};
+    for (std::size_t i : {W::ENGINE_LOOP, W::SENDER}) {
+      s.has_wakeup[i] = w[i] != nullptr;
+      if (!w[i]) continue;
+      s.wakeup[i] = w[i]->lateness();
+      s.spin_us[i] = w[i]->spin_us();
     }
+    const auto* tw = timing_waiter();
+    s.json_wakeup = !tw ? -1 : tw == &waiter ? int{W::ENGINE_LOOP} : int{W::SENDER};
+  };
+
+  const auto engine_loop = [&] {
+    while (g_running.load()) {
+      // MIDI IN
+      while (auto m = midiIn->poll()) {
+        if (rec) rec->input(*m);
+        eng.on_midi_in(*m);
+      }
 
-    // Granie / czas
-    eng.tick();
+      // Komendy z CLI (aplikuj TYLKO tutaj, w wątku pętli silnika). Tu nic nie
+      // wypisujemy – odpowiedź (dane) idzie do wątku CLI, ten ją formatuje.
+      cq.drain([&](const ui::Command& cmd) {
+        using T = ui::Command::Type;
+        ui::Reply r;
+        r.type = cmd.type;
+        r.a = cmd.a;
+        switch (cmd.type) {
+          case T::SetBpm: {
+            ec.bpm = (cmd.a > 0 ? cmd.a : (int)ec.bpm);
+            if (rec) rec->tempo(ec.bpm);
+            eng.set_engine_config(ec);
+            r.external_clock = ec.external_clock;
+            r.bpm = ec.external_clock ? ceng.clock_sync().bpm() : ec.bpm;
+          } break;
+          case T::SetLogLevel: {
+            if (cmd.a >= 0 && cmd.a <= 2) outLog.set_level(static_cast<desktop_midi::LogLevel>(cmd.a));
+            r.a = (int)outLog.level();
+            r.log_dropped = outLog.dropped();
+          } break;
+          case T::Stats: {
+            if (cmd.a == 2) {
+              eng.reset_stats();
+              statOut.reset_stats();
+              waiter.reset_stats();
+              if (sched && sched->waiter()) sched->waiter()->reset_stats();
+            } else {
+              snapshot_stats(statSnap);
+            }
+          } break;
+          case T::Panic: {
+            // All Notes Off na każdym kanale – VoiceTracker zamienia go na OFF-y
+            // brzmiących nut. Obok podsłuchu nagrywania (to nie wyjście silnika);
+            // z lookahead idzie przez wątek wysyłający, który jako jedyny pisze do trackera.
+            const uint64_t now = clock.now_us();
+            for (uint8_t ch = 0; ch < 16; ++ch)
+              backOut.send(ports::MidiMsg{static_cast<uint8_t>(0xB0 | ch), 123, 0, now});
+          } break;
+          case T::Quit:
+            g_running.store(false);
+            break;
+          default:
+            break;   // show / edycje patternów obsługuje wątek CLI (PatternEditor)
+        }
+        if (ui::has_reply(cmd.type)) (void)cq.reply(r);
+      });
 
-    // Równy tick na PC
-    next += std::chrono::milliseconds(1);
-    std::this_thread::sleep_until(next);
+      // Granie / czas
+      if (rec) rec->tick();
+      eng.tick();
+
+      // Śpij do najbliższego terminu silnika (albo do MIDI IN / komendy / SIGINT)
+      if (!g_running.load()) break;
+      auto dl = eng.next_deadline_us();
+      if (!inWakes) {
+        const uint64_t poll_at = clock.now_us() + 1000;
+        if (!dl || *dl > poll_at) dl = poll_at;
+      }
+      const auto until = dl ? std::optional(clock.at_us(*dl)) : std::nullopt;
+      if (rt) (void)waiter.wait(reactor, until);
+      else    reactor.wait(until);
+    }
+  };
+
+  if (rt) {
+    // Pętla silnika (MIDI IN, komendy, tick) w osobnym wątku RT; główny tylko czeka
+    // (opis trybu wypisuje wątek główny – wątek RT nie pisze na terminal)
+    std::promise<desktop_midi::RtStatus> started;
+    std::thread rtThread([&] {
+      const auto st = desktop_midi::enter_realtime(rtOpt);
+      waiter.calibrate(reactor);
+      started.set_value(st);
+      engine_loop();
+    });
+    const auto st = started.get_future().get();
+    std::cout << "RT engine thread: " << desktop_midi::describe(st)
+              << ", spin margin " << waiter.spin_us() << " us\n";
+    rtThread.join();
+  } else {
+    engine_loop();
   }
 
+  if (statsOut) {
+    if (std::FILE* f = std::fopen(statsOut, "w")) {
+      const auto* w = timing_waiter();
+      ui::print_stats_json(eng.stats(), statOut.stats(), f, w ? &w->lateness() : nullptr);
+      std::fclose(f);
+    } else {
+      std::cerr << "cannot write " << statsOut << "\n";
+    }
+  }
+  if (rt) { std::cout << "Wake-up (actual - deadline, us)\n"; print_wakeups(stdout); }
+  if (sched && (sched->dropped() || sched->stalls() || sched->sent_early()))
+    std::cout << "sender: " << sched->stalls() << " waits for a full queue, " << sched->dropped()
+              << " messages dropped, " << sched->sent_early() << " sent early\n";
+  // Najpierw to, co brzmi: wątek wysyłający dosyła OFF-y i staje, tracker
+  // zwalnia resztę. Dopiero potem CLI – mogło czekać na linię (wyjście z SIGINT)
+  sched.reset();                                    // wątek wysyłający skończył – tracker i liczniki stoją
+  release_voices(voices, clock, "");
+  stdinLines.stop();
   if (cli_thread.joinable()) cli_thread.join();
+  if (rawMidiOut) {
+    const uint64_t sent = rawMidiOut->bytes_sent(), saved = rawMidiOut->bytes_saved();
+    std::cout << "raw out: " << sent << " bytes sent, " << saved << " saved by running status ("
+              << (sent + saved ? 100 * saved / (sent + saved) : 0) << "%), "
+              << rawMidiOut->dropped() << " messages dropped\n";
+  }
+  if (rec && rec->dropped()) std::cerr << "trace: " << rec->dropped() << " events dropped – replay will diverge\n";
   std::cout << "Bye\n";
   return 0;
 }
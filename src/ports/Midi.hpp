@@ -1,28 +1,59 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
 #include <optional>
+#include "ports/Wakeup.hpp"
 
 namespace ports {
 
-// Minimalna reprezentacja komunikatu MIDI (3 bajty + timestamp w ms).
+// Minimalna reprezentacja komunikatu MIDI (3 bajty + timestamp w µs).
 // status: 0x8x = Note Off, 0x9x = Note On (x = kanał-1), itd.
 struct MidiMsg {
   uint8_t status{0};
   uint8_t data1{0};   // np. numer nuty
   uint8_t data2{0};   // np. velocity
-  uint64_t t_ms{0};   // timestamp w ms (od IClock)
+  uint64_t t_us{0};   // timestamp w µs (od IClock)
 };
 
+// Ile bajtów ma komunikat o danym statusie (0 => SysEx/nieznany, długość zmienna)
+constexpr std::size_t message_length(uint8_t status) {
+  if (status < 0x80) return 0;
+  switch (status & 0xF0) {
+    case 0xC0: case 0xD0: return 2;            // Program Change, Channel Pressure
+    case 0xF0:
+      switch (status) {
+        case 0xF1: case 0xF3: return 2;        // MTC quarter frame, Song Select
+        case 0xF2:            return 3;        // Song Position Pointer
+        case 0xF0: case 0xF7: return 0;        // SysEx
+        default:              return 1;        // Tune Request, realtime
+      }
+    default: return 3;                         // Note On/Off, CC, Poly AT, Pitch Bend
+  }
+}
+
 // Wejście MIDI: non-blocking poll() — zwraca wiadomość albo std::nullopt
 struct IMidiIn {
   virtual ~IMidiIn() = default;
   virtual std::optional<MidiMsg> poll() = 0;
+  // Opcjonalnie: obudź pętlę, gdy przyjdzie komunikat.
+  // false => backend tego nie umie (czysty polling) – pętla musi budzić się sama.
+  virtual bool set_wakeup(IWakeup* w) { (void)w; return false; }
 };
 
-// Wyjście MIDI: send() — wysyła jeden komunikat
+// Wyjście MIDI: send() — wysyła jeden komunikat (od razu)
 struct IMidiOut {
   virtual ~IMidiOut() = default;
   virtual void send(const MidiMsg& msg) = 0;
+
+  // Tryb lookahead: paczka komunikatów na przyszłość (rosnąco wg t_us).
+  // Backend z planowaniem wysyła każdy dokładnie w chwili t_us (znaczniki
+  // urządzenia albo własny wątek); domyślnie – wszystko od razu.
+  virtual void send_batch(const MidiMsg* msgs, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) send(msgs[i]);
+  }
+  // Odwołaj zaplanowane, jeszcze niewysłane komunikaty z t_us > after_us.
+  // false => backend tego nie umie (co poszło w paczce, to zagra).
+  virtual bool cancel_after(uint64_t after_us) { (void)after_us; return false; }
 };
 
 } // namespace ports
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// ports::IPatternStore – trwały magazyn patternów (banki). Na PC: pliki
+// mapowane do pamięci, na MCU: np. sektor flash. CLI woła go ze swojego wątku.
+namespace ports {
+struct IPatternStore {
+  virtual ~IPatternStore() = default;
+  // Pattern 'pattern' <- slot banku (zmiana od najbliższego taktu). 'msg' – co się stało.
+  virtual bool load(const std::string& bank, std::size_t slot, std::size_t pattern, std::string& msg) = 0;
+  // Slot banku <- bieżący szkic patternu 'pattern' (bank rośnie w razie potrzeby)
+  virtual bool save(const std::string& bank, std::size_t slot, std::size_t pattern, std::string& msg) = 0;
+};
+} // namespace ports
@@ -0,0 +1,11 @@
+#pragma once
+
+// ports::IWakeup – "budzik" pętli głównej. Źródła zdarzeń (MIDI IN, CLI)
+// sygnalizują nim, że jest coś do zrobienia, zanim minie termin silnika.
+// Na PC: eventfd/epoll, na MCU: np. flaga + WFI.
+namespace ports {
+struct IWakeup {
+  virtual ~IWakeup() = default;
+  virtual void wake() = 0; // musi być bezpieczne z dowolnego wątku
+};
+} // namespace ports
@@ -0,0 +1,115 @@
+#pragma once
+#include <cctype>
+#include <cstdint>
+#include <istream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "core/Transport.hpp"
+
+namespace render {
+
+/*
+ * ChordScript – oś czasu wejścia (co "gra klawiszowiec") dla renderu offline.
+ *
+ * Jedna linia = jedno zdarzenie:  <czas> <komenda> [argumenty]
+ *   czas:  liczba beatów (ćwierćnut), np. 4 albo 6.5; z sufiksem "ms" – milisekundy
+ *   bpm <v>          – zmiana tempa
+ *   on <nuty...>     – NoteOn (numery 0..127 albo nazwy: C4=60, F#3, Bb2)
+ *   off <nuty...>    – NoteOff
+ *   chord <nuty...>  – puść wszystko, co trzymane, i przytrzymaj podane
+ *   release          – puść wszystko
+ *   end              – koniec renderu
+ * '#' zaczyna komentarz. Czasy muszą być niemalejące.
+ */
+struct ScriptEvent {
+  enum class Kind { On, Off, Chord, Release, Bpm, End } kind{Kind::On};
+  uint64_t t_us{0};
+  std::vector<uint8_t> notes;
+  double bpm{0.0};
+};
+
+struct ChordScript {
+  std::vector<ScriptEvent> events;
+  double   start_bpm{120.0};   // tempo obowiązujące w chwili 0
+  uint64_t end_us{0};          // koniec renderu (ostatnie zdarzenie, jeśli brak 'end')
+};
+
+namespace detail {
+
+inline int parse_note(const std::string& tok) {
+  if (!tok.empty() && std::isdigit(static_cast<unsigned char>(tok[0]))) {
+    const int n = std::stoi(tok);
+    if (n < 0 || n > 127) throw std::runtime_error("note out of range: " + tok);
+    return n;
+  }
+  static const int base[7] = {9, 11, 0, 2, 4, 5, 7};     // A B C D E F G
+  const char l = static_cast<char>(std::toupper(static_cast<unsigned char>(tok.empty() ? '?' : tok[0])));
+  if (l < 'A' || l > 'G') throw std::runtime_error("bad note: " + tok);
+  int n = base[l - 'A'];
+  std::size_t i = 1;
+  while (i < tok.size() && (tok[i] == '#' || tok[i] == 'b')) n += (tok[i++] == '#') ? 1 : -1;
+  if (i >= tok.size()) throw std::runtime_error("bad note (missing octave): " + tok);
+  n += 12 * (std::stoi(tok.substr(i)) + 1);               // C4 = 60
+  if (n < 0 || n > 127) throw std::runtime_error("note out of range: " + tok);
+  return n;
+}
+
+} // namespace detail
+
+inline ChordScript parse_chord_script(std::istream& in) {
+  ChordScript s;
+  core::Transport tr(120.0);   // przelicza beaty na µs z uwzględnieniem zmian tempa
+  uint64_t last_t = 0;
+  bool have_end = false;
+  std::string line;
+
+  for (int lineno = 1; std::getline(in, line); ++lineno) {
+    if (const auto h = line.find('#'); h != std::string::npos) line.resize(h);
+    std::istringstream iss(line);
+    std::string when, cmd;
+    if (!(iss >> when)) continue;
+    if (!(iss >> cmd)) throw std::runtime_error("line " + std::to_string(lineno) + ": missing command");
+
+    try {
+      ScriptEvent ev;
+      if (when.size() > 2 && when.compare(when.size() - 2, 2, "ms") == 0) {
+        ev.t_us = static_cast<uint64_t>(std::stod(when.substr(0, when.size() - 2)) * 1000.0);
+      } else {
+        ev.t_us = tr.time_at(std::stod(when));
+      }
+      if (ev.t_us < last_t) throw std::runtime_error("time goes backwards");
+      last_t = ev.t_us;
+
+      if (cmd == "bpm") {
+        ev.kind = ScriptEvent::Kind::Bpm;
+        if (!(iss >> ev.bpm) || ev.bpm <= 0) throw std::runtime_error("bad bpm");
+        tr.set_bpm(ev.bpm, ev.t_us);
+        if (ev.t_us == 0) s.start_bpm = ev.bpm;
+      } else if (cmd == "on" || cmd == "off" || cmd == "chord") {
+        ev.kind = (cmd == "on") ? ScriptEvent::Kind::On
+                : (cmd == "off") ? ScriptEvent::Kind::Off : ScriptEvent::Kind::Chord;
+        for (std::string tok; iss >> tok; ) ev.notes.push_back(static_cast<uint8_t>(detail::parse_note(tok)));
+      } else if (cmd == "release") {
+        ev.kind = ScriptEvent::Kind::Release;
+      } else if (cmd == "end") {
+        ev.kind = ScriptEvent::Kind::End;
+        s.end_us = ev.t_us;
+        have_end = true;
+      } else {
+        throw std::runtime_error("unknown command '" + cmd + "'");
+      }
+      s.events.push_back(std::move(ev));
+      if (have_end) break;
+    } catch (const std::logic_error&) {            // stoi/stod
+      throw std::runtime_error("line " + std::to_string(lineno) + ": bad number");
+    } catch (const std::runtime_error& e) {
+      throw std::runtime_error("line " + std::to_string(lineno) + ": " + e.what());
+    }
+  }
+  if (!have_end) s.end_us = last_t;
+  return s;
+}
+
+} // namespace render
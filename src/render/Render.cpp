@@ -0,0 +1,158 @@
+// arp_render – render offline (szybciej niż w czasie rzeczywistym) do pliku .mid.
+//
+// Skrypt akordów (render/ChordScript.hpp) jest wejściem z "klawiatury";
+// silnik chodzi na wirtualnym zegarze, który przeskakuje prosto do następnego
+// terminu (krok / NoteOff / zdarzenie skryptu). Bez urządzeń MIDI, bez audio,
+// wynik jest deterministyczny – nadaje się do CI i podglądów wsadowych.
+//
+// Użycie: arp_render <skrypt> <wyjście.mid> [--engine pattern|arp] [--order O] [--patterns N]
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include "core/ArpEngine.hpp"
+#include "core/FactoryPatterns.hpp"
+#include "core/PatternEngine.hpp"
+#include "render/ChordScript.hpp"
+#include "render/SmfWriter.hpp"
+#include "sim/Harness.hpp"
+#include "sim/VirtualClock.hpp"
+
+namespace {
+
+constexpr uint8_t  INPUT_VELOCITY = 100;
+constexpr uint64_t TAIL_US = 10'000'000;   // max. ogon po 'end' na dogranie NoteOff-ów
+
+// Różnice API obu silników w jednym miejscu
+void set_bpm(core::PatternEngine& eng, double bpm) {
+  core::EngineConfig ec;
+  ec.bpm = bpm;
+  ec.overlap_ms = 12;
+  eng.set_engine_config(ec);
+}
+template<class Order>
+void set_bpm(core::BasicArpEngine<Order>& eng, double bpm) {
+  core::ArpConfig c;
+  c.bpm = bpm;
+  eng.set_config(c);
+}
+
+template<class Engine>
+void run(Engine& eng, VirtualClock& clock, const render::ChordScript& script,
+         render::SmfWriter& smf) {
+  std::array<bool, 128> held{};
+  auto key = [&](uint8_t note, bool on) {
+    if (held[note] == on) return;
+    held[note] = on;
+    eng.on_midi_in(ports::MidiMsg{static_cast<uint8_t>(on ? 0x90 : 0x80), note,
+                                  static_cast<uint8_t>(on ? INPUT_VELOCITY : 0), clock.now_us()});
+  };
+  auto release_all = [&] { for (int n = 0; n < 128; ++n) key(static_cast<uint8_t>(n), false); };
+
+  std::size_t next = 0;
+  for (;;) {
+    // 1) silnik dogrywa wszystko do chwili zdarzenia (albo końca skryptu)
+    uint64_t t = script.end_us;
+    if (next < script.events.size()) t = std::min(t, script.events[next].t_us);
+    run_until(eng, clock, t);
+
+    // 2) zdarzenia skryptu przypadające na teraz
+    const uint64_t now = clock.now_us();
+    while (next < script.events.size() && script.events[next].t_us <= now) {
+      const auto& ev = script.events[next++];
+      using K = render::ScriptEvent::Kind;
+      switch (ev.kind) {
+        case K::On:      for (auto n : ev.notes) key(n, true);  break;
+        case K::Off:     for (auto n : ev.notes) key(n, false); break;
+        case K::Chord:   release_all(); for (auto n : ev.notes) key(n, true); break;
+        case K::Release: release_all(); break;
+        case K::Bpm:     set_bpm(eng, ev.bpm); smf.set_tempo(now, ev.bpm); break;
+        case K::End:     break;
+      }
+    }
+    if (now >= script.end_us) break;
+    // Termin <= now (np. OFF zaplanowany przez zdarzenie z kroku 2) => run_until
+    // obsłuży go w tej samej chwili, zanim zegar pójdzie dalej.
+  }
+
+  // Koniec: puść klawisze i dograj wiszące NoteOff-y (z ich terminami).
+  // Bez akordu silnik już nic nie włącza, więc wystarczy krótki ogon.
+  release_all();
+  drain(eng, clock, script.end_us + TAIL_US);
+}
+
+void usage() {
+  std::fprintf(stderr,
+    "Usage: arp_render <script> <out.mid> [options]\n"
+    "  --engine pattern|arp   engine to drive (default pattern)\n"
+    "  --order O              arp note order: %s (default up)\n"
+    "  --patterns N           number of patterns for the pattern engine (default 4)\n",
+    core::order::ORDER_NAMES);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 3) { usage(); return 1; }
+  const std::string in_path = argv[1], out_path = argv[2];
+  std::string engine = "pattern";
+  std::string order = "up";
+  std::size_t num_patterns = core::PatternEngine::DEFAULT_PATTERNS;
+  for (int i = 3; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--engine" && i + 1 < argc) engine = argv[++i];
+    else if (arg == "--order" && i + 1 < argc) order = argv[++i];
+    else if (arg == "--patterns" && i + 1 < argc) {
+      num_patterns = std::max<std::size_t>(2, std::strtoul(argv[++i], nullptr, 10));
+    }
+    else { usage(); return 1; }
+  }
+  if (engine != "pattern" && engine != "arp") { usage(); return 1; }
+
+  render::ChordScript script;
+  try {
+    std::ifstream f(in_path);
+    if (!f) throw std::runtime_error("cannot open " + in_path);
+    script = render::parse_chord_script(f);
+  } catch (const std::exception& e) {
+    std::fprintf(stderr, "%s: %s\n", in_path.c_str(), e.what());
+    return 1;
+  }
+
+  const auto wall0 = std::chrono::steady_clock::now();
+  VirtualClock clock;
+  render::SmfWriter smf(script.start_bpm);
+  VectorMidiOut out(&clock);       // znacznik = zegar wirtualny w chwili wysłania
+
+  if (engine == "pattern") {
+    core::PatternEngine eng(out, clock, num_patterns);
+    set_bpm(eng, script.start_bpm);
+    core::load_factory_patterns(eng);
+    run(eng, clock, script, smf);
+  } else {
+    // polityka kolejności wybrana raz – krok silnika ma ją wklejoną
+    const bool known = core::order::with_order(order, [&](auto tag) {
+      core::BasicArpEngine<decltype(tag)> eng(out, clock);
+      set_bpm(eng, script.start_bpm);
+      run(eng, clock, script, smf);
+    });
+    if (!known) { usage(); return 1; }
+  }
+  const double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+
+  for (const auto& m : out.msgs) smf.add(m);
+  if (!smf.write(out_path)) {
+    std::fprintf(stderr, "cannot write %s\n", out_path.c_str());
+    return 1;
+  }
+  const double media_s = static_cast<double>(script.end_us) / 1e6;
+  std::printf("%s: %zu events, %.1f s of music in %.3f s (x%.0f)\n",
+              out_path.c_str(), smf.size(), media_s, wall_s,
+              wall_s > 0 ? media_s / wall_s : 0.0);
+  return 0;
+}
@@ -0,0 +1,214 @@
+// arp_replay – odtworzenie nagranej sesji (midi_arp --record) na zegarze wirtualnym.
+//
+// Ślad (core/Trace.hpp) niesie migawkę konfiguracji i patternów, wejście MIDI
+// z chwilą przyjścia, chwile tick(), zmiany tempa i odebrane edycje patternów
+// (publikowane do skrzynki przed swoim tick()). Silnik dostaje te same
+// wywołania w tych samych chwilach – bez czekania, z pełną prędkością – a jego
+// wyjście porównujemy z wyjściem nagranym na żywo: zgodność bit w bit albo
+// pierwsze miejsce rozjazdu. --repeat N powtarza odtworzenie (test obciążenia
+// prawdziwym materiałem z koncertu).
+//
+// Użycie: arp_replay <ślad.trace> [--mid wyjście.mid] [--repeat N]
+// Kod wyjścia: 0 = wyjście zgodne, 3 = rozjazd, 1 = błąd.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "core/PatternBank.hpp"
+#include "core/PatternEditor.hpp"
+#include "core/PatternEngine.hpp"
+#include "core/Trace.hpp"
+#include "render/SmfWriter.hpp"
+#include "sim/VirtualClock.hpp"
+
+namespace {
+
+// Wyjście silnika -> zdarzenia śladu (ten sam zapis co podsłuch w TraceRecorder).
+// cancel_after odpowiada tak, jak backend w nagraniu (kolejne wyniki z śladu).
+class ReplayOut final : public ports::IMidiOut {
+public:
+  explicit ReplayOut(const std::vector<bool>& cancels) : cancels_(cancels) {}
+  void send(const ports::MidiMsg& m) override { got.push_back(core::trace_output(m)); }
+  bool cancel_after(uint64_t after_us) override {
+    const bool ok = next_cancel_ < cancels_.size() && cancels_[next_cancel_];
+    ++next_cancel_;
+    got.push_back(core::trace_cancel(after_us, ok));
+    return ok;
+  }
+  std::vector<core::TraceEvent> got;
+private:
+  const std::vector<bool>& cancels_;
+  std::size_t next_cancel_{0};
+};
+
+// Edycja patternu z nagrania (zdarzenie Pattern + PatternData); false => niepełna
+// (zdarzenia zgubione przy zapisie) albo spoza śladu
+bool recorded_edit(const core::TraceView& trace, const core::TraceEvent* e, core::BankRecord& rec) {
+  return e->arg < trace.patterns() && e->status <= static_cast<uint8_t>(core::Quantize::Bar) &&
+         core::trace_pattern_record(e, trace.end(), rec);
+}
+
+// Edycje odebrane w tick() stoją w śladzie zaraz za jego zdarzeniem Tick –
+// publikujemy je przed tym tick(), w tej samej kolejności (jak PatternEditor w midi_arp)
+void publish_recorded(const core::TraceView& trace, const core::TraceEvent* e, core::PatternEditor& editor) {
+  core::BankRecord rec;
+  for (; e != trace.end() && e->kind == static_cast<uint8_t>(core::TraceKind::Pattern);
+         e += 1 + core::TRACE_RECORD_EVENTS) {
+    if (!recorded_edit(trace, e, rec)) return;
+    (void)core::from_bank_record(rec, editor.draft(e->arg));   // sprawdzone w main
+    editor.publish(e->arg, static_cast<core::Quantize>(e->status));
+  }
+}
+
+struct Replayed {
+  std::vector<core::TraceEvent> out;
+  uint64_t end_us{0};
+};
+
+Replayed replay(const core::TraceView& trace, const std::vector<bool>& cancels) {
+  VirtualClock clock;
+  ReplayOut out(cancels);
+  out.got.reserve(trace.size());
+  core::PatternEngine eng(out, clock, trace.patterns());
+
+  // Stan z chwili nagrania: konfiguracja, potem patterny (jak w midi_arp).
+  // Edytujemy tylko patterny inne niż domyślne – każda edycja "dotyka" pattern,
+  // a to przy lookahead przesuwa okno; midi_arp też dotknął tylko tych.
+  core::EngineConfig ec = core::trace_engine_config(trace.header());
+  clock.set_us(trace.header().config_us);
+  eng.set_engine_config(ec);
+  const core::PatternEngine& ceng = eng;
+  for (std::size_t i = 0; i < trace.patterns(); ++i) {
+    const core::BankRecord cur = core::to_bank_record(ceng.pattern(i));
+    if (std::memcmp(&cur, &trace.pattern(i), sizeof cur) != 0)
+      (void)core::from_bank_record(trace.pattern(i), eng.pattern(i));   // sprawdzone w main
+  }
+
+  core::PatternEditor editor(eng);
+
+  using K = core::TraceKind;
+  for (const core::TraceEvent* e = trace.begin(); e != trace.end(); ++e) {
+    switch (static_cast<K>(e->kind)) {
+      case K::In:    clock.set_us(e->t_us); eng.on_midi_in(core::trace_message(*e)); break;
+      case K::Tick:
+        clock.set_us(e->t_us);
+        publish_recorded(trace, e + 1, editor);
+        eng.tick();
+        break;
+      case K::Tempo:
+        clock.set_us(e->t_us);
+        ec.bpm = e->arg / 1000.0;
+        eng.set_engine_config(ec);
+        break;
+      case K::Out: case K::Cancel: break;   // nagrane wyjście – do porównania
+      case K::Pattern: case K::PatternData: break;   // opublikowane przed swoim tick()
+    }
+  }
+  return Replayed{std::move(out.got), clock.now_us()};
+}
+
+void print_event(const char* label, const core::TraceEvent* e) {
+  if (!e) { std::printf("  %-8s (none)\n", label); return; }
+  if (e->kind == static_cast<uint8_t>(core::TraceKind::Cancel)) {
+    std::printf("  %-8s cancel_after t_us=%llu -> %u\n", label, static_cast<unsigned long long>(e->t_us), e->arg);
+  } else {
+    std::printf("  %-8s status=0x%02X d1=%d d2=%d t_us=%llu\n", label, e->status, e->data1, e->data2,
+                static_cast<unsigned long long>(e->t_us));
+  }
+}
+
+void usage() {
+  std::fprintf(stderr,
+    "Usage: arp_replay <session.trace> [options]\n"
+    "  --mid F       write the replayed output to a .mid file\n"
+    "  --repeat N    replay N times and report throughput (load test)\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) { usage(); return 1; }
+  const std::string in_path = argv[1];
+  std::string mid_path;
+  long repeat = 1;
+  for (int i = 2; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--mid" && i + 1 < argc) mid_path = argv[++i];
+    else if (arg == "--repeat" && i + 1 < argc) repeat = std::max(1L, std::strtol(argv[++i], nullptr, 10));
+    else { usage(); return 1; }
+  }
+
+  std::ifstream f(in_path, std::ios::binary);
+  if (!f) { std::fprintf(stderr, "cannot open %s\n", in_path.c_str()); return 1; }
+  const std::vector<char> data{std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()};
+  const core::TraceView trace(data.data(), data.size());
+  if (!trace.valid()) { std::fprintf(stderr, "%s: %s\n", in_path.c_str(), trace.error()); return 1; }
+  for (std::size_t i = 0; i < trace.patterns(); ++i) {
+    core::BankRecordError bad;
+    if (core::check_bank_record(trace.pattern(i), &bad)) continue;
+    char why[96];
+    core::format_bank_error(bad, why, sizeof why);
+    std::fprintf(stderr, "%s: pattern %zu: %s\n", in_path.c_str(), i, why);
+    return 1;
+  }
+  if (trace.header().dropped)
+    std::fprintf(stderr, "warning: %u events were dropped while recording – expect divergence\n", trace.header().dropped);
+
+  // Nagrane wyjście (Out/Cancel w kolejności) i odpowiedzi backendu na cancel_after
+  std::vector<core::TraceEvent> expected;
+  std::vector<bool> cancels;
+  std::size_t inputs = 0, edits = 0, broken_edits = 0;
+  for (const core::TraceEvent& e : trace) {
+    if (core::is_trace_output(e)) expected.push_back(e);
+    if (e.kind == static_cast<uint8_t>(core::TraceKind::Cancel)) cancels.push_back(e.arg != 0);
+    if (e.kind == static_cast<uint8_t>(core::TraceKind::In)) ++inputs;
+    if (e.kind != static_cast<uint8_t>(core::TraceKind::Pattern)) continue;
+    core::BankRecord rec;
+    if (!recorded_edit(trace, &e, rec)) { ++broken_edits; continue; }
+    core::BankRecordError bad;
+    if (!core::check_bank_record(rec, &bad)) {
+      char why[96];
+      core::format_bank_error(bad, why, sizeof why);
+      std::fprintf(stderr, "%s: edit of pattern %u at t_us=%llu: %s\n", in_path.c_str(), e.arg,
+                   static_cast<unsigned long long>(e.t_us), why);
+      return 1;
+    }
+    ++edits;
+  }
+  if (broken_edits)
+    std::fprintf(stderr, "warning: %zu pattern edits are incomplete in the trace – expect divergence\n", broken_edits);
+
+  const auto wall0 = std::chrono::steady_clock::now();
+  Replayed r = replay(trace, cancels);
+  for (long k = 1; k < repeat; ++k) r = replay(trace, cancels);
+  const double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall0).count();
+
+  const double media_s = static_cast<double>(r.end_us - trace.header().config_us) / 1e6;
+  std::printf("%s: %zu events (%zu MIDI IN, %zu pattern edits), %.1f s of session, %ld x in %.3f s (x%.0f)\n",
+              in_path.c_str(), trace.size(), inputs, edits, media_s, repeat, wall_s,
+              wall_s > 0 ? media_s * static_cast<double>(repeat) / wall_s : 0.0);
+
+  if (!mid_path.empty()) {
+    render::SmfWriter smf(trace.header().bpm);
+    for (const auto& e : r.out)
+      if (e.kind == static_cast<uint8_t>(core::TraceKind::Out)) smf.add(ports::MidiMsg{e.status, e.data1, e.data2, e.t_us});
+    if (!smf.write(mid_path)) { std::fprintf(stderr, "cannot write %s\n", mid_path.c_str()); return 1; }
+  }
+
+  const auto [a, b] = std::mismatch(expected.begin(), expected.end(), r.out.begin(), r.out.end());
+  if (a == expected.end() && b == r.out.end()) {
+    std::printf("output identical: %zu events\n", expected.size());
+    return 0;
+  }
+  std::printf("output DIVERGES at event %zu (recorded %zu, replayed %zu)\n",
+              static_cast<std::size_t>(a - expected.begin()), expected.size(), r.out.size());
+  print_event("recorded", a != expected.end() ? &*a : nullptr);
+  print_event("replayed", b != r.out.end() ? &*b : nullptr);
+  return 3;
+}
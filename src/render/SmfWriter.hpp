@@ -0,0 +1,107 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "ports/Midi.hpp"
+
+namespace render {
+
+/*
+ * SmfWriter – zapis Standard MIDI File (format 0, jedna ścieżka).
+ *
+ * Zdarzenia przychodzą ze znacznikiem w µs (zegar silnika); na ticki
+ * przeliczamy je wg mapy temp, którą wołający buduje przez set_tempo()
+ * (każda zmiana tempa trafia też do pliku jako meta-zdarzenie FF 51).
+ */
+class SmfWriter {
+public:
+  static constexpr uint16_t PPQ = 960;   // ticków na ćwierćnutę
+
+  explicit SmfWriter(double bpm = 120.0) { tempo_.push_back(Tempo{0, 0.0, us_per_beat_(bpm)}); }
+
+  // Zmiana tempa od chwili t_us (wołać w kolejności czasu)
+  void set_tempo(uint64_t t_us, double bpm) {
+    const double tick = tick_at_(t_us);
+    if (tempo_.back().t_us == t_us) tempo_.pop_back();
+    tempo_.push_back(Tempo{t_us, tick, us_per_beat_(bpm)});
+  }
+
+  void add(const ports::MidiMsg& m) {
+    if (ports::message_length(m.status) == 0) return;
+    events_.push_back(m);
+  }
+
+  std::size_t size() const { return events_.size(); }
+
+  bool write(const std::string& path) const {
+    struct Ev { uint64_t tick; int order; uint8_t b[6]; uint8_t len; };
+    std::vector<Ev> evs;
+    evs.reserve(events_.size() + tempo_.size());
+
+    for (const auto& t : tempo_) {
+      const auto us = static_cast<uint32_t>(std::llround(t.us_per_beat));
+      Ev e{to_tick_(t.tick), 0, {0xFF, 0x51, 0x03, uint8_t(us >> 16), uint8_t(us >> 8), uint8_t(us)}, 6};
+      evs.push_back(e);
+    }
+    for (const auto& m : events_) {
+      Ev e{to_tick_(tick_at_(m.t_us)), 1, {m.status, m.data1, m.data2, 0, 0, 0},
+           static_cast<uint8_t>(ports::message_length(m.status))};
+      evs.push_back(e);
+    }
+    // stabilnie: meta tempa przed nutami w tym samym ticku, reszta w kolejności nadejścia
+    std::stable_sort(evs.begin(), evs.end(), [](const Ev& a, const Ev& b){
+      return a.tick < b.tick || (a.tick == b.tick && a.order < b.order);
+    });
+
+    std::vector<uint8_t> trk;
+    trk.reserve(evs.size() * 5 + 16);
+    uint64_t last = 0;
+    for (const auto& e : evs) {
+      put_vlq_(trk, static_cast<uint32_t>(e.tick - last));
+      last = e.tick;
+      trk.insert(trk.end(), e.b, e.b + e.len);
+    }
+    trk.insert(trk.end(), {0x00, 0xFF, 0x2F, 0x00});   // End of Track
+
+    std::ofstream f(path, std::ios::binary);
+    if (!f) return false;
+    const uint8_t hdr[14] = {'M','T','h','d', 0,0,0,6, 0,0, 0,1, uint8_t(PPQ >> 8), uint8_t(PPQ)};
+    f.write(reinterpret_cast<const char*>(hdr), sizeof hdr);
+    const auto n = static_cast<uint32_t>(trk.size());
+    const uint8_t th[8] = {'M','T','r','k', uint8_t(n >> 24), uint8_t(n >> 16), uint8_t(n >> 8), uint8_t(n)};
+    f.write(reinterpret_cast<const char*>(th), sizeof th);
+    f.write(reinterpret_cast<const char*>(trk.data()), static_cast<std::streamsize>(trk.size()));
+    return static_cast<bool>(f);
+  }
+
+private:
+  struct Tempo { uint64_t t_us; double tick; double us_per_beat; };
+  std::vector<Tempo> tempo_;
+  std::vector<ports::MidiMsg> events_;
+
+  static double us_per_beat_(double bpm) { return 60'000'000.0 / (bpm > 0 ? bpm : 120.0); }
+
+  // Pozycja w tickach (ułamkowa) dla chwili t_us
+  double tick_at_(uint64_t t_us) const {
+    auto it = std::upper_bound(tempo_.begin(), tempo_.end(), t_us,
+                               [](uint64_t t, const Tempo& s){ return t < s.t_us; });
+    const Tempo& s = *(it == tempo_.begin() ? it : it - 1);
+    const double dt = static_cast<double>(t_us) - static_cast<double>(s.t_us);
+    return s.tick + dt * PPQ / s.us_per_beat;
+  }
+
+  static uint64_t to_tick_(double tick) { return tick <= 0 ? 0 : static_cast<uint64_t>(std::llround(tick)); }
+
+  static void put_vlq_(std::vector<uint8_t>& out, uint32_t v) {
+    uint8_t buf[5];
+    int n = 0;
+    buf[n++] = v & 0x7F;
+    while (v >>= 7) buf[n++] = static_cast<uint8_t>(0x80 | (v & 0x7F));
+    while (n) out.push_back(buf[--n]);
+  }
+};
+
+} // namespace render
@@ -0,0 +1,259 @@
+// clock_sim – symulacja zewnętrznego MIDI Clock z rozrzutem (jak z USB).
+//
+// "Master" wysyła 24 impulsy na ćwierćnutę w idealnych chwilach; do PatternEngine
+// dochodzą one przez SimMidiQueue/SimMidiIn z losowym opóźnieniem 0..jitter µs
+// (znacznik przyjścia = chwila dotarcia). Silnik chodzi na zegarze wirtualnym
+// w trybie external_clock i gra jeden krok co 1/division ćwierćnuty – przy
+// division 16 co drugi krok wypada między impulsami.
+//
+// Raport:
+//  - czas zbieżności estymaty tempa (do ±0.5% i już tam zostaje), na start
+//    i po zmianie tempa (--to-bpm),
+//  - błąd fazy kroków względem idealnej siatki mastera (średnia = stałe
+//    opóźnienie, rozrzut wokół średniej = to, co słychać),
+//  - dla porównania rozrzut surowych impulsów (kroki "na impulsach"),
+//  - pozycję na ostatnim impulsie (silnik vs master) – z --drop-every N co
+//    N-ty impuls po Start ginie po drodze i pozycja nie może się rozjechać.
+//
+// Użycie: clock_sim [--bpm B] [--to-bpm B] [--jitter-us J] [--seconds S]
+//                   [--div D] [--preroll BEATS] [--seed N] [--drop-every N]
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "core/PatternEngine.hpp"
+#include "sim/SimMidi.hpp"
+#include "sim/VirtualClock.hpp"
+
+namespace {
+
+constexpr double TEMPO_TOLERANCE = 0.005;   // zbieżność: |bpm_est - bpm| / bpm
+constexpr uint64_t T0_US = 1'000'000;       // pierwszy impuls mastera
+
+struct Options {
+  double   bpm = 120.0;
+  double   to_bpm = 0.0;       // >0 => skok tempa w połowie przebiegu
+  uint64_t jitter_us = 1000;
+  double   seconds = 60.0;
+  uint16_t division = 16;
+  int      preroll = 2;        // ćwierćnuty zegara przed Start (PLL może się zatrzasnąć)
+  uint32_t seed = 1;
+  uint64_t drop_every = 0;     // >0 => co N-ty impuls po Start nie dochodzi
+};
+
+// Idealna oś mastera: impuls nr n (od pierwszego wysłanego) i jego chwila
+class Master {
+public:
+  Master(double bpm1, double bpm2, uint64_t change_pulse)
+    : p1_(core::US_PER_MINUTE / (bpm1 * core::ClockSync::PPQN)),
+      p2_(core::US_PER_MINUTE / (bpm2 * core::ClockSync::PPQN)),
+      change_(change_pulse) {}
+
+  double pulse_time(double n) const {
+    const double c = static_cast<double>(change_);
+    return static_cast<double>(T0_US) + (n <= c ? n * p1_ : c * p1_ + (n - c) * p2_);
+  }
+  double pulse_at(double t) const {
+    const double c = static_cast<double>(change_), tc = pulse_time(c);
+    const double dt = t - static_cast<double>(T0_US);
+    return t <= tc ? dt / p1_ : c + (t - tc) / p2_;
+  }
+  uint64_t change_pulse() const { return change_; }
+
+private:
+  double p1_, p2_;
+  uint64_t change_;
+};
+
+// Wyjście: zapamiętaj znaczniki NoteOn
+class CaptureOut final : public ports::IMidiOut {
+public:
+  void send(const ports::MidiMsg& m) override {
+    if ((m.status & 0xF0) == 0x90 && m.data2 > 0) on_us.push_back(m.t_us);
+  }
+  std::vector<uint64_t> on_us;
+};
+
+struct Spread {
+  double mean{0}, sd{0}, p50{0}, p99{0}, max{0};
+  std::size_t n{0};
+};
+
+// Średnia i rozrzut wokół średniej (percentyle |x - mean|)
+Spread spread(std::vector<double> v) {
+  Spread s;
+  s.n = v.size();
+  if (v.empty()) return s;
+  for (double x : v) s.mean += x;
+  s.mean /= static_cast<double>(v.size());
+  for (double& x : v) { s.sd += (x - s.mean) * (x - s.mean); x = std::fabs(x - s.mean); }
+  s.sd = std::sqrt(s.sd / static_cast<double>(v.size()));
+  std::sort(v.begin(), v.end());
+  const auto at = [&](double p) { return v[static_cast<std::size_t>(p * static_cast<double>(v.size() - 1))]; };
+  s.p50 = at(0.50); s.p99 = at(0.99); s.max = v.back();
+  return s;
+}
+
+void print_spread(const char* name, const Spread& s) {
+  std::printf("  %-22s n=%-7zu mean=%9.1f  sd=%7.1f  |dev| p50=%7.1f p99=%7.1f max=%7.1f\n",
+              name, s.n, s.mean, s.sd, s.p50, s.p99, s.max);
+}
+
+bool parse(int argc, char** argv, Options& o) {
+  for (int i = 1; i < argc; ++i) {
+    const bool more = i + 1 < argc;
+    if      (!std::strcmp(argv[i], "--bpm") && more)       o.bpm = std::atof(argv[++i]);
+    else if (!std::strcmp(argv[i], "--to-bpm") && more)    o.to_bpm = std::atof(argv[++i]);
+    else if (!std::strcmp(argv[i], "--jitter-us") && more) o.jitter_us = std::strtoull(argv[++i], nullptr, 10);
+    else if (!std::strcmp(argv[i], "--seconds") && more)   o.seconds = std::atof(argv[++i]);
+    else if (!std::strcmp(argv[i], "--div") && more)       o.division = static_cast<uint16_t>(std::atoi(argv[++i]));
+    else if (!std::strcmp(argv[i], "--preroll") && more)   o.preroll = std::max(0, std::atoi(argv[++i]));
+    else if (!std::strcmp(argv[i], "--seed") && more)      o.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    else if (!std::strcmp(argv[i], "--drop-every") && more) o.drop_every = std::strtoull(argv[++i], nullptr, 10);
+    else return false;
+  }
+  return o.bpm > 0 && o.to_bpm >= 0 && o.seconds > 0 && o.division > 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  Options o;
+  if (!parse(argc, argv, o)) {
+    std::fprintf(stderr, "Usage: clock_sim [--bpm B] [--to-bpm B] [--jitter-us J] [--seconds S]\n"
+                         "                 [--div D] [--preroll BEATS] [--seed N] [--drop-every N]\n");
+    return 1;
+  }
+  const double bpm2 = o.to_bpm > 0 ? o.to_bpm : o.bpm;
+  const double period1 = core::US_PER_MINUTE / (o.bpm * core::ClockSync::PPQN);
+  const auto total_pulses = static_cast<uint64_t>(o.seconds * 1e6 / period1);
+  const uint64_t preroll = static_cast<uint64_t>(o.preroll) * core::ClockSync::PPQN;
+  const Master master(o.bpm, bpm2, o.to_bpm > 0 ? preroll + (total_pulses - preroll) / 2 : UINT64_MAX / 2);
+
+  VirtualClock clock;
+  CaptureOut out;
+  core::PatternEngine eng(out, clock, 1);
+  core::EngineConfig ec;
+  ec.external_clock = true;
+  eng.set_engine_config(ec);
+  {
+    auto& p = eng.pattern(0);
+    p.division = o.division;
+    p.length = 1;
+    p.steps[0].note_index = 1;
+    p.steps[0].gate_pct = 50;
+  }
+  eng.on_midi_in(ports::MidiMsg{0x90, 60, 100, 0});   // trzymany akord: jedna nuta
+
+  SimMidiQueue q;
+  SimMidiIn in(q);
+  std::mt19937 rng(o.seed);
+  std::uniform_int_distribution<uint64_t> delay(0, o.jitter_us);
+
+  // Komunikaty mastera w kolejności przyjścia: Start tuż przed impulsem nr preroll
+  struct Arrival { uint64_t t; uint8_t status; uint64_t pulse; };
+  std::vector<Arrival> arrivals;
+  std::vector<double> pulse_dev;                 // surowy impuls - idealny (po Start)
+  uint64_t dropped = 0;
+  for (uint64_t n = 0; n < total_pulses; ++n) {
+    const double ideal = master.pulse_time(static_cast<double>(n));
+    if (n == preroll) arrivals.push_back({static_cast<uint64_t>(ideal) - 1000, 0xFA, n});
+    // zgubiony impuls (nigdy pierwszy po Start ani ostatni – ten wyznacza pozycję końcową)
+    if (o.drop_every && n > preroll && n + 1 < total_pulses && (n - preroll) % o.drop_every == 0) {
+      ++dropped;
+      continue;
+    }
+    const uint64_t t = static_cast<uint64_t>(std::llround(ideal)) + delay(rng);
+    arrivals.push_back({t, 0xF8, n});
+    if (n >= preroll) pulse_dev.push_back(static_cast<double>(t) - ideal);
+  }
+  // rozrzut może zamienić kolejność sąsiadów tylko przy jitter > okres – wtedy i USB by ją zachowało
+  std::stable_sort(arrivals.begin(), arrivals.end(), [](const Arrival& a, const Arrival& b) { return a.t < b.t; });
+
+  // Estymata tempa po każdym impulsie (do zbieżności); numer impulsu wg mastera,
+  // więc zgubione impulsy nie przesuwają granicy odcinków
+  struct TempoSample { uint64_t pulse; double t; double bpm; };
+  std::vector<TempoSample> tempo;
+  tempo.reserve(total_pulses);
+  std::vector<uint64_t> in_flight;               // numery impulsów w kolejce, w kolejności
+  std::size_t taken = 0;
+
+  std::size_t next = 0;
+  const uint64_t end_us = arrivals.back().t + 1;
+  while (clock.now_us() < end_us) {
+    uint64_t t = next < arrivals.size() ? arrivals[next].t : end_us;
+    if (const auto dl = eng.next_deadline_us()) t = std::min(t, *dl);
+    clock.set_us(t);
+    while (next < arrivals.size() && arrivals[next].t <= clock.now_us()) {
+      q.try_push(ports::MidiMsg{arrivals[next].status, 0, 0, arrivals[next].t});
+      if (arrivals[next].status == 0xF8) in_flight.push_back(arrivals[next].pulse);
+      ++next;
+    }
+    while (auto m = in.poll()) {
+      eng.on_midi_in(*m);
+      if (m->status == 0xF8) tempo.push_back({in_flight[taken++], static_cast<double>(m->t_us), eng.clock_sync().bpm()});
+    }
+    eng.tick();
+  }
+
+  // Zbieżność: od początku odcinka do pierwszego impulsu, po którym estymata już nie wychodzi z tolerancji
+  const auto converge = [&](uint64_t from, uint64_t to, double bpm) -> double {
+    uint64_t last_bad = from;
+    bool any_bad = false;
+    for (const auto& s : tempo) {
+      if (s.pulse < from || s.pulse >= to) continue;
+      if (std::fabs(s.bpm - bpm) / bpm > TEMPO_TOLERANCE) { last_bad = s.pulse; any_bad = true; }
+    }
+    const uint64_t ok = any_bad ? last_bad + 1 : from;
+    const auto s = std::find_if(tempo.begin(), tempo.end(), [&](const TempoSample& x) { return x.pulse >= ok; });
+    if (ok >= to || s == tempo.end() || s->pulse >= to) return -1.0;
+    return (s->t - master.pulse_time(static_cast<double>(from))) / 1000.0;
+  };
+  const uint64_t change = std::min<uint64_t>(master.change_pulse(), total_pulses);
+  const double conv1 = converge(0, change, o.bpm);
+  const double conv2 = change < total_pulses ? converge(change, total_pulses, bpm2) : 0.0;
+
+  // Błąd fazy kroków: NoteOn vs najbliższy punkt idealnej siatki (beat 0 = impuls po Start)
+  const double pulses_per_step = static_cast<double>(core::ClockSync::PPQN) / o.division;
+  const double steady_from = std::max(master.pulse_time(static_cast<double>(preroll)),
+                                      master.pulse_time(0) + std::max(conv1, 0.0) * 1000.0);
+  const double change_t = master.pulse_time(static_cast<double>(change));
+  std::vector<double> all_err, steady_err;
+  for (const uint64_t t_on : out.on_us) {
+    const double rel = master.pulse_at(static_cast<double>(t_on)) - static_cast<double>(preroll);
+    const double k = std::round(rel / pulses_per_step);
+    const double err = static_cast<double>(t_on) - master.pulse_time(static_cast<double>(preroll) + k * pulses_per_step);
+    all_err.push_back(err);
+    const double t = static_cast<double>(t_on);
+    const bool settled = t >= steady_from && (t < change_t || t >= change_t + std::max(conv2, 0.0) * 1000.0);
+    if (settled) steady_err.push_back(err);
+  }
+
+  std::printf("clock_sim: %.2f bpm%s, jitter 0..%llu us, %llu pulses, division %u, preroll %d beats\n",
+              o.bpm, o.to_bpm > 0 ? " (tempo jump at half)" : "", (unsigned long long)o.jitter_us,
+              (unsigned long long)total_pulses, o.division, o.preroll);
+  std::printf("Tempo convergence (within %.1f%%, stays there), ms from first pulse of segment\n", TEMPO_TOLERANCE * 100);
+  if (conv1 < 0) std::printf("  start:       did not converge\n");
+  else           std::printf("  start:       %9.1f ms\n", conv1);
+  if (o.to_bpm > 0) {
+    if (conv2 < 0) std::printf("  -> %.2f bpm: did not converge\n", bpm2);
+    else           std::printf("  -> %.2f bpm: %9.1f ms\n", bpm2, conv2);
+  }
+  std::printf("  final estimate: %.3f bpm (true %.3f)\n", eng.clock_sync().bpm(), bpm2);
+  std::printf("Phase error vs master grid, us (mean = constant latency, |dev| = audible jitter)\n");
+  print_spread("steps, settled", spread(steady_err));
+  print_spread("steps, all", spread(all_err));
+  print_spread("raw pulses (no PLL)", spread(pulse_dev));
+
+  // Pozycja: impuls nr preroll to pozycja 0, ostatni impuls mastera dotarł zawsze
+  const auto engine_pos = static_cast<int64_t>(std::llround(eng.clock_sync().position_beats() * core::ClockSync::PPQN));
+  const auto master_pos = static_cast<int64_t>(total_pulses - 1 - preroll);
+  std::printf("Position at last pulse: engine %lld, master %lld pulses (%+lld); %llu dropped, %llu detected as lost\n",
+              (long long)engine_pos, (long long)master_pos, (long long)(engine_pos - master_pos),
+              (unsigned long long)dropped, (unsigned long long)eng.clock_sync().lost_pulses());
+  return 0;
+}
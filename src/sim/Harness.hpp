@@ -0,0 +1,72 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ports/Clock.hpp"
+#include "ports/Midi.hpp"
+#include "sim/VirtualClock.hpp"
+
+// Uprząż do uruchamiania silników w pamięci, na zegarze wirtualnym:
+// wyjście do wektora + pętla "dograj do chwili t" skacząca po terminach silnika.
+// Wspólna dla renderu offline, benchmarków i porównań ze "złotym" wyjściem
+// (ten sam skrypt => te same komunikaty, bajt w bajt).
+
+// Wyjście MIDI do wektora.
+// clock != nullptr => znacznik = czas zegara w chwili wysłania (jak urządzenie),
+// inaczej znacznik z silnika. cancellable => cancel_after() usuwa komunikaty
+// z t_us > after (jak backend z planowaniem – tryb lookahead).
+class VectorMidiOut final : public ports::IMidiOut {
+public:
+  explicit VectorMidiOut(const ports::IClock* clock = nullptr, bool cancellable = false)
+    : clock_(clock), cancellable_(cancellable) {}
+
+  void send(const ports::MidiMsg& m) override {
+    msgs.push_back(m);
+    if (clock_) msgs.back().t_us = clock_->now_us();
+  }
+  bool cancel_after(uint64_t after_us) override {
+    if (!cancellable_) return false;
+    msgs.erase(std::remove_if(msgs.begin(), msgs.end(), [&](const ports::MidiMsg& m) { return m.t_us > after_us; }),
+               msgs.end());
+    return true;
+  }
+
+  std::size_t count(uint8_t type) const {
+    return static_cast<std::size_t>(std::count_if(msgs.begin(), msgs.end(),
+      [&](const ports::MidiMsg& m) { return (m.status & 0xF0) == type; }));
+  }
+  void clear() { msgs.clear(); }
+
+  std::vector<ports::MidiMsg> msgs;
+
+private:
+  const ports::IClock* clock_;
+  bool cancellable_;
+};
+
+// Dograj wszystko do chwili t włącznie: tick() w każdym terminie silnika < t,
+// na koniec tick() w t. Zegar zostaje w t. Termin <= teraz (np. po zmianie
+// akordu) => kolejny tick w tej samej chwili.
+template<class Engine>
+void run_until(Engine& eng, VirtualClock& clock, uint64_t t) {
+  for (;;) {
+    const auto dl = eng.next_deadline_us();
+    const uint64_t next = (dl && *dl < t) ? *dl : t;
+    clock.set_us(next);
+    eng.tick();
+    if (clock.now_us() >= t) return;
+  }
+}
+
+// Dograj zaległe terminy (np. wiszące NoteOff-y po puszczeniu klawiszy),
+// ale nie dalej niż do 'limit'; stop także wtedy, gdy silnik stoi w miejscu.
+template<class Engine>
+void drain(Engine& eng, VirtualClock& clock, uint64_t limit) {
+  while (const auto dl = eng.next_deadline_us()) {
+    if (*dl > limit) break;
+    clock.set_us(*dl);
+    eng.tick();
+    if (eng.next_deadline_us() == dl) break;             // nic się nie ruszyło
+  }
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+#include "ports/Clock.hpp"
+
+// Wirtualny zegar – czas płynie tylko wtedy, gdy ktoś go przestawi.
+// Render offline i symulacje przeskakują nim prosto do następnego terminu
+// silnika, więc godziny materiału liczą się w milisekundach, deterministycznie.
+class VirtualClock final : public ports::IClock {
+public:
+  uint64_t now_us() const override { return t_us_; }
+
+  void set_us(uint64_t t) { if (t > t_us_) t_us_ = t; }   // czas nie cofa się
+  void advance_us(uint64_t dt) { t_us_ += dt; }
+
+private:
+  uint64_t t_us_{0};
+};
@@ -0,0 +1,285 @@
+// engine_golden – "złote" oczekiwania dla silników (ctest).
+//
+// Silnik chodzi na zegarze wirtualnym (sim/Harness.hpp: run_until / drain),
+// wyjście trafia do VectorMidiOut ze znacznikami silnika, a każdy przypadek
+// porównuje komunikaty co do mikrosekundy z listą policzoną ręcznie:
+// gate, legato/overlap, seedy probability, kurczenie akordu, przepełnienie
+// kolejki OFF-ów. Kod wyjścia != 0 => któryś przypadek nie przeszedł.
+#include <cstdio>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "core/ArpEngine.hpp"
+#include "core/PatternEngine.hpp"
+#include "core/Rng.hpp"
+#include "sim/Harness.hpp"
+#include "sim/VirtualClock.hpp"
+
+namespace {
+
+constexpr uint8_t ON = 0x90, OFF = 0x80;
+
+struct Ev { uint8_t status; uint8_t note; uint8_t vel; uint64_t t_us; };
+
+int g_failed = 0;
+
+bool check(bool ok, const char* name, const std::string& what) {
+  if (!ok) { std::printf("FAIL %s: %s\n", name, what.c_str()); ++g_failed; }
+  return ok;
+}
+
+std::string show(const ports::MidiMsg& m) {
+  char buf[64];
+  std::snprintf(buf, sizeof buf, "%02X %u %u @%llu", m.status, m.data1, m.data2,
+                static_cast<unsigned long long>(m.t_us));
+  return buf;
+}
+
+// Dokładnie te komunikaty, w tej kolejności
+bool expect_msgs(const char* name, const std::vector<ports::MidiMsg>& got, std::initializer_list<Ev> want) {
+  std::size_t i = 0;
+  for (const auto& w : want) {
+    if (i >= got.size())
+      return check(false, name, "missing #" + std::to_string(i) + " " + show({w.status, w.note, w.vel, w.t_us}));
+    const auto& m = got[i];
+    if (m.status != w.status || m.data1 != w.note || m.data2 != w.vel || m.t_us != w.t_us)
+      return check(false, name, "#" + std::to_string(i) + " got " + show(m) +
+                                ", want " + show({w.status, w.note, w.vel, w.t_us}));
+    ++i;
+  }
+  return check(got.size() == i, name, "extra " + (i < got.size() ? show(got[i]) : std::string()));
+}
+
+// Jeden pattern na kanale 1, 120 bpm (ćwierćnuta = 500 ms), overlap 10 ms
+struct Rig {
+  VirtualClock clock;
+  VectorMidiOut out;
+  core::PatternEngine eng;
+
+  explicit Rig(std::size_t patterns = 1) : eng(out, clock, patterns) {
+    core::EngineConfig ec;
+    ec.bpm = 120.0;
+    ec.overlap_ms = 10;
+    eng.set_engine_config(ec);
+  }
+  void key(uint8_t note, bool on) {
+    eng.on_midi_in(ports::MidiMsg{static_cast<uint8_t>(on ? ON : OFF), note,
+                                  static_cast<uint8_t>(on ? 100 : 0), clock.now_us()});
+  }
+};
+
+core::Step step(uint8_t idx, uint8_t gate, uint8_t vel = 100, uint8_t prob = 100) {
+  core::Step s;
+  s.note_index = idx;
+  s.gate_pct = gate;
+  s.velocity = vel;
+  s.probability = prob;
+  return s;
+}
+
+// Gate 50% ósemki (krok 250 ms): OFF po 125 ms + overlap, bez nakładania
+void gate() {
+  Rig r;
+  auto& p = r.eng.pattern(0);
+  p.division = 2;
+  p.length = 2;
+  p.steps[0] = step(1, 50);
+  p.steps[1] = step(2, 50, 90);
+  r.key(60, true); r.key(64, true);
+  run_until(r.eng, r.clock, 600'000);
+  expect_msgs("gate", r.out.msgs, {
+    {ON, 60, 100, 0},      {OFF, 60, 0, 135'000},
+    {ON, 64, 90, 250'000}, {OFF, 64, 0, 385'000},
+    {ON, 60, 100, 500'000},
+  });
+}
+
+// Gate 100%: OFF poprzedniej nuty = ON następnej + overlap (nakładka 10 ms);
+// ta sama nuta w kolejnym kroku – nowy ON przed OFF-em starej (legato)
+void legato() {
+  {
+    Rig r;
+    auto& p = r.eng.pattern(0);
+    p.length = 2;
+    p.steps[0] = step(1, 100);
+    p.steps[1] = step(2, 100);
+    r.key(60, true); r.key(64, true);
+    run_until(r.eng, r.clock, 600'000);
+    expect_msgs("legato", r.out.msgs, {
+      {ON, 60, 100, 0},
+      {ON, 64, 100, 250'000}, {OFF, 60, 0, 260'000},
+      {ON, 60, 100, 500'000}, {OFF, 64, 0, 510'000},
+    });
+  }
+  {
+    Rig r;
+    auto& p = r.eng.pattern(0);
+    p.length = 1;
+    p.steps[0] = step(1, 100);
+    r.key(60, true);
+    run_until(r.eng, r.clock, 600'000);
+    expect_msgs("legato same note", r.out.msgs, {
+      {ON, 60, 100, 0},
+      {ON, 60, 100, 250'000}, {OFF, 60, 0, 260'000},
+      {ON, 60, 100, 500'000}, {OFF, 60, 0, 510'000},
+    });
+  }
+}
+
+// Które z 16 kroków (probability 50%) zagrały – bit k = krok k
+uint32_t played_mask(const Rig& r, uint32_t pattern) {
+  uint32_t mask = 0;
+  for (const auto& m : r.out.msgs)
+    if ((m.status & 0xF0) == ON && (m.status & 0x0F) == pattern)
+      mask |= 1u << (m.t_us / 125'000);
+  return mask;
+}
+
+void setup_prob(Rig& r, std::size_t i, uint32_t seed) {
+  auto& p = r.eng.pattern(i);
+  p.channel = static_cast<uint8_t>(i + 1);
+  p.division = 4;
+  p.length = 16;
+  p.seed = seed;
+  for (std::size_t k = 0; k < 16; ++k) p.steps[k] = step(1, 50, 100, 50);
+}
+
+// Ten sam seed => ta sama sekwencja; strumień = numer patternu, więc dwa
+// patterny z tym samym seedem grają różnie, a edycja jednego nie przesuwa drugiego
+void probability() {
+  constexpr uint64_t BAR2 = 2'000'000;                 // 16 szesnastek
+  // Seed 7, pattern 0: kroki 1, 5, 6, 8, 11, 13 (jedno losowanie Pcg32 na krok).
+  // Zmiana tej maski = inna sekwencja dla zapisanych banków – świadoma decyzja.
+  constexpr uint32_t want = 0x2962;
+  uint32_t ref = 0;
+  core::Pcg32 rng(7, 0);
+  for (uint32_t k = 0; k < 16; ++k) if (rng.chance(50)) ref |= 1u << k;
+  check(ref == want, "probability", "Pcg32(7, 0) sequence changed");
+
+  Rig a(2);
+  setup_prob(a, 0, 7);
+  setup_prob(a, 1, 7);
+  a.key(60, true);
+  run_until(a.eng, a.clock, BAR2 - 1);
+  const uint32_t p0 = played_mask(a, 0), p1 = played_mask(a, 1);
+  check(p0 == want, "probability", "seed 7 pattern 0 mask " + std::to_string(p0) + " != " + std::to_string(want));
+  check(p1 != p0, "probability", "pattern 1 repeats pattern 0's stream");
+
+  // Drugi przebieg z tym samym seedem, ale z edycją patternu 1 w trakcie
+  Rig b(2);
+  setup_prob(b, 0, 7);
+  setup_prob(b, 1, 7);
+  b.key(60, true);
+  run_until(b.eng, b.clock, BAR2 / 2);
+  b.eng.pattern(1).seed = 99;
+  run_until(b.eng, b.clock, BAR2 - 1);
+  check(played_mask(b, 0) == want, "probability", "editing pattern 1 shifted pattern 0");
+  check(played_mask(b, 1) != p1, "probability", "seed change on pattern 1 had no effect");
+
+  // Inny seed => inna sekwencja
+  Rig c(1);
+  setup_prob(c, 0, 8);
+  c.key(60, true);
+  run_until(c.eng, c.clock, BAR2 - 1);
+  check(played_mask(c, 0) != want, "probability", "seed 8 plays like seed 7");
+}
+
+// Akord 4 nut, puszczone 2 w trakcie: indeksy 3 i 4 stają się pauzami,
+// OFF-y już zagranych nut wychodzą w swoich terminach
+void chord_shrink() {
+  Rig r;
+  auto& p = r.eng.pattern(0);
+  p.length = 4;
+  for (uint8_t k = 0; k < 4; ++k) p.steps[k] = step(static_cast<uint8_t>(k + 1), 50);
+  for (uint8_t n : {60, 64, 67, 71}) r.key(n, true);
+  run_until(r.eng, r.clock, 800'000);
+  r.key(67, false); r.key(71, false);
+  run_until(r.eng, r.clock, 2'400'000);
+  expect_msgs("chord shrink", r.out.msgs, {
+    {ON, 60, 100, 0},           {OFF, 60, 0, 135'000},
+    {ON, 64, 100, 250'000},     {OFF, 64, 0, 385'000},
+    {ON, 67, 100, 500'000},     {OFF, 67, 0, 635'000},
+    {ON, 71, 100, 750'000},     {OFF, 71, 0, 885'000},
+    {ON, 60, 100, 1'000'000},   {OFF, 60, 0, 1'135'000},
+    {ON, 64, 100, 1'250'000},   {OFF, 64, 0, 1'385'000},
+    {ON, 60, 100, 2'000'000},   {OFF, 60, 0, 2'135'000},
+    {ON, 64, 100, 2'250'000},   {OFF, 64, 0, 2'385'000},
+  });
+}
+
+// Restart patternu (długość 0 -> 1) gra krok od razu; przy 20 bpm i gate 200%
+// każdy OFF czeka 6 s, więc 300 restartów co 1 ms przepełnia kolejkę (256).
+// Pełna kolejka wysyła najwcześniejszy OFF od razu (znacznik = bieżący krok),
+// liczy off_overflows, a żaden ON nie zostaje bez OFF-a.
+void off_overflow() {
+  constexpr std::size_t RESTARTS = 300, CAPACITY = 256;
+  Rig r;
+  core::EngineConfig ec;
+  ec.bpm = 20.0;
+  ec.overlap_ms = 10;
+  r.eng.set_engine_config(ec);
+  r.key(60, true);
+  for (std::size_t k = 0; k < RESTARTS; ++k) {
+    auto& p = r.eng.pattern(0);
+    p.division = 1;
+    p.length = 1;
+    p.steps[0] = step(1, 200);
+    run_until(r.eng, r.clock, k * 1000);
+    r.eng.pattern(0).length = 0;
+    run_until(r.eng, r.clock, k * 1000 + 500);
+  }
+  const auto& st = r.eng.stats();
+  check(st.off_overflows == RESTARTS - CAPACITY, "off overflow",
+        "off_overflows " + std::to_string(st.off_overflows));
+
+  std::vector<uint64_t> ons, offs;
+  for (const auto& m : r.out.msgs) ((m.status & 0xF0) == ON ? ons : offs).push_back(m.t_us);
+  check(ons.size() == RESTARTS, "off overflow", "ons " + std::to_string(ons.size()));
+  check(offs.size() == RESTARTS - CAPACITY, "off overflow", "early offs " + std::to_string(offs.size()));
+  for (std::size_t k = 0; k < offs.size() && k + CAPACITY < ons.size(); ++k)
+    if (!check(offs[k] == ons[k + CAPACITY], "off overflow",
+               "early off #" + std::to_string(k) + " at " + std::to_string(offs[k])))
+      break;
+
+  // Reszta w terminach: ostatni OFF = ostatni ON + 2 ćwierćnuty (6 s) + overlap
+  r.key(60, false);
+  drain(r.eng, r.clock, 20'000'000);
+  offs.clear();
+  for (const auto& m : r.out.msgs) if ((m.status & 0xF0) == OFF) offs.push_back(m.t_us);
+  check(offs.size() == RESTARTS, "off overflow", "offs after drain " + std::to_string(offs.size()));
+  check(!offs.empty() && offs.back() == ons.back() + 6'010'000, "off overflow", "last off not on its deadline");
+}
+
+// ArpEngine: stała velocity z konfiguracji, velocity wejścia tylko na życzenie (0)
+void arp_velocity() {
+  for (uint8_t v : {uint8_t{100}, uint8_t{0}}) {
+    VirtualClock clock;
+    VectorMidiOut out;
+    core::ArpEngine eng(out, clock);
+    core::ArpConfig c;
+    c.velocity = v;
+    eng.set_config(c);
+    eng.on_midi_in(ports::MidiMsg{ON, 60, 37, 0});
+    run_until(eng, clock, 100'000);
+    const uint8_t want = v ? v : 37;
+    check(!out.msgs.empty() && out.msgs.front().data2 == want, "arp velocity",
+          "velocity " + std::to_string(out.msgs.empty() ? 0 : out.msgs.front().data2) +
+          " != " + std::to_string(want));
+  }
+}
+
+} // namespace
+
+int main() {
+  gate();
+  legato();
+  probability();
+  chord_shrink();
+  off_overflow();
+  arp_velocity();
+  if (g_failed) { std::printf("%d check(s) failed\n", g_failed); return 1; }
+  std::printf("all engine checks passed\n");
+  return 0;
+}
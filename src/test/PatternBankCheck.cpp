@@ -0,0 +1,173 @@
+// pattern_bank – rekordy banku spoza zakresów nie dochodzą do silnika (ctest).
+//
+// Każde pole rekordu (kanał, division, długość, idx/vel/gate/oct/prob kroku)
+// poza zakresem CLI => from_bank_record / BankView::load odrzucają rekord,
+// a pattern zostaje nietknięty; wartości brzegowe przechodzą. Do tego
+// BankLibrary na prawdziwym pliku: zły slot => błąd z powodem, nic nie
+// publikuje. Kod wyjścia != 0 => któryś przypadek nie przeszedł.
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "core/PatternBank.hpp"
+#include "core/PatternEditor.hpp"
+#include "core/PatternEngine.hpp"
+#include "desktop/BankLibrary.hpp"
+#include "sim/Harness.hpp"
+#include "sim/VirtualClock.hpp"
+
+namespace {
+
+int g_failed = 0;
+
+bool check(bool ok, const char* name, const std::string& what) {
+  if (!ok) { std::printf("FAIL %s: %s\n", name, what.c_str()); ++g_failed; }
+  return ok;
+}
+
+// Poprawny rekord z niedomyślną treścią (żeby "nietknięty" coś znaczyło)
+core::BankRecord good_record() {
+  core::PatternConfig p{};
+  p.channel  = 3;
+  p.division = 4;
+  p.seed     = 99;
+  p.length   = 8;
+  for (std::size_t i = 0; i < p.length; ++i) p.steps[i].note_index = static_cast<uint8_t>(1 + i % 3);
+  return core::to_bank_record(p);
+}
+
+bool same_pattern(const core::PatternConfig& a, const core::PatternConfig& b) {
+  const core::BankRecord ra = core::to_bank_record(a), rb = core::to_bank_record(b);
+  return std::memcmp(&ra, &rb, sizeof ra) == 0;
+}
+
+struct Bad {
+  const char* field;
+  int         step;
+  long        value;
+  std::function<void(core::BankRecord&)> set;
+};
+
+void out_of_range() {
+  const Bad cases[] = {
+    {"channel",  -1,   0, [](core::BankRecord& r) { r.channel = 0; }},
+    {"channel",  -1,  17, [](core::BankRecord& r) { r.channel = 17; }},
+    {"division", -1,   0, [](core::BankRecord& r) { r.division = 0; }},
+    {"length",   -1,  65, [](core::BankRecord& r) { r.length = 65; }},
+    {"idx",       2, 129, [](core::BankRecord& r) { r.steps[2].note_index = 129; }},
+    {"vel",       0,   0, [](core::BankRecord& r) { r.steps[0].velocity = 0; }},
+    {"vel",       5, 128, [](core::BankRecord& r) { r.steps[5].velocity = 128; }},
+    {"gate",      1,   0, [](core::BankRecord& r) { r.steps[1].gate_pct = 0; }},
+    {"gate",      7, 201, [](core::BankRecord& r) { r.steps[7].gate_pct = 201; }},
+    {"oct",       3,  -9, [](core::BankRecord& r) { r.steps[3].octave = -9; }},
+    {"oct",       3,   9, [](core::BankRecord& r) { r.steps[3].octave = 9; }},
+    {"enabled",   4,   2, [](core::BankRecord& r) { r.steps[4].enabled = 2; }},
+    {"prob",      6, 101, [](core::BankRecord& r) { r.steps[6].probability = 101; }},
+    // krok za 'length' też: wchodzi do gry po wydłużeniu patternu
+    {"vel",      63, 200, [](core::BankRecord& r) { r.steps[63].velocity = 200; }},
+  };
+  for (const Bad& c : cases) {
+    core::BankRecord r = good_record();
+    c.set(r);
+    const std::string name = std::string("reject ") + c.field + " " + std::to_string(c.value);
+    core::PatternConfig p{};
+    p.length = 5;
+    const core::PatternConfig before = p;
+    core::BankRecordError err;
+    check(!core::from_bank_record(r, p, &err), name.c_str(), "accepted");
+    check(same_pattern(p, before), name.c_str(), "pattern changed");
+    check(err.field && std::strcmp(err.field, c.field) == 0 && err.step == c.step && err.value == c.value,
+          name.c_str(), std::string("reported ") + (err.field ? err.field : "(none)") +
+                        " step " + std::to_string(err.step) + " value " + std::to_string(err.value));
+  }
+
+  char buf[96];
+  core::format_bank_error(core::BankRecordError{"vel", 3, 0, 1, 127}, buf, sizeof buf);
+  check(std::string(buf) == "step 3 vel = 0 (expected 1..127)", "format", buf);
+}
+
+void boundaries() {
+  core::BankRecord r = good_record();
+  r.channel = 16;
+  r.length  = static_cast<uint16_t>(core::MAX_STEPS);
+  r.steps[0] = core::BankStep{0, 1, 1, -8, 0, 0};
+  r.steps[1] = core::BankStep{static_cast<uint8_t>(core::MAX_CHORD_NOTES), 127, 200, 8, 1, 100};
+  core::PatternConfig p{};
+  check(core::from_bank_record(r, p), "boundaries", "rejected");
+  const core::BankRecord back = core::to_bank_record(p);
+  check(std::memcmp(&back, &r, sizeof r) == 0, "boundaries", "round trip differs");
+}
+
+// Bank w pamięci (jak po mmap): slot 0 poprawny, slot 1 z velocity 0
+std::vector<unsigned char> make_bank() {
+  core::BankRecord recs[2] = {good_record(), good_record()};
+  recs[1].steps[2].velocity = 0;
+  std::vector<unsigned char> file(sizeof(core::BankHeader) + sizeof recs);
+  const auto hdr = core::make_bank_header(2);
+  std::memcpy(file.data(), &hdr, sizeof hdr);
+  std::memcpy(file.data() + sizeof hdr, recs, sizeof recs);
+  return file;
+}
+
+void bank_view() {
+  const auto file = make_bank();
+  const core::BankView v(file.data(), file.size());
+  if (!check(v.valid(), "bank view", v.error())) return;
+  core::PatternConfig p{};
+  const core::PatternConfig before = p;
+  core::BankRecordError err;
+  check(!v.load(1, p, &err), "bank view", "bad slot loaded");
+  check(same_pattern(p, before), "bank view", "bad slot changed the pattern");
+  check(err.field && std::strcmp(err.field, "vel") == 0 && err.step == 2, "bank view", "wrong reason");
+  check(v.load(0, p) && p.channel == 3 && p.length == 8, "bank view", "good slot not loaded");
+}
+
+// BankLibrary na pliku: zły slot => false + powód, szkic i silnik bez zmian
+void bank_library() {
+  const auto path = std::filesystem::temp_directory_path() /
+                    ("arp_bank_check_" + std::to_string(::getpid()) + ".bank");
+  {
+    const auto file = make_bank();
+    std::ofstream f(path, std::ios::binary);
+    f.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+  }
+  VirtualClock clock;
+  VectorMidiOut out;
+  core::PatternEngine eng(out, clock, 2);
+  core::PatternEditor editor(eng);
+  {
+    desktop_midi::BankLibrary banks(editor);
+    const core::PatternConfig before = editor.draft(0);
+    std::string msg;
+    check(!banks.load(path.string(), 1, 0, msg), "library", "bad slot loaded");
+    check(msg.find("rejected") != std::string::npos && msg.find("vel = 0") != std::string::npos,
+          "library", "message: " + msg);
+    check(same_pattern(editor.draft(0), before), "library", "draft changed");
+    eng.tick();
+    const core::PatternEngine& ceng = eng;
+    check(same_pattern(ceng.pattern(0), before), "library", "engine adopted the bad slot");
+
+    check(banks.load(path.string(), 0, 0, msg), "library", "good slot: " + msg);
+    check(editor.draft(0).channel == 3, "library", "good slot not in the draft");
+  }
+  std::filesystem::remove(path);
+}
+
+} // namespace
+
+int main() {
+  out_of_range();
+  boundaries();
+  bank_view();
+  bank_library();
+  if (g_failed) { std::printf("%d check(s) failed\n", g_failed); return 1; }
+  std::printf("all bank checks passed\n");
+  return 0;
+}
@@ -0,0 +1,190 @@
+// raw_midi_pipe – surowe MIDI przez pipe(): RawMidiOut -> bajty -> RawMidiIn (ctest).
+//
+// Bajty idą prawdziwym deskryptorem, kawałkami jak z read(): komunikat rozcięty
+// między zapisy, running status, realtime w środku SysEx, bajty danych bez
+// statusu. Do tego makeRawOut/makeRawIn na ścieżkach: brak pliku wyjściowego
+// => plik powstaje, nieotwieralna ścieżka => wyjątek, a nie abort.
+// Kod wyjścia != 0 => któryś przypadek nie przeszedł.
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <initializer_list>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "desktop/RawMidi.hpp"
+#include "ports/Wakeup.hpp"
+#include "sim/VirtualClock.hpp"
+
+namespace {
+
+using desktop_midi::InputMode;
+using desktop_midi::RawMidiIn;
+using desktop_midi::RawMidiOut;
+
+struct Ev { uint8_t status; uint8_t d1; uint8_t d2; };
+
+int g_failed = 0;
+
+bool check(bool ok, const char* name, const std::string& what) {
+  if (!ok) { std::printf("FAIL %s: %s\n", name, what.c_str()); ++g_failed; }
+  return ok;
+}
+
+std::string show(uint8_t s, uint8_t d1, uint8_t d2) {
+  char buf[32];
+  std::snprintf(buf, sizeof buf, "%02X %02X %02X", s, d1, d2);
+  return buf;
+}
+
+// Wszystko, co wejście ma teraz do oddania (Poll: read() przy pustej kolejce)
+std::vector<ports::MidiMsg> take(RawMidiIn& in) {
+  std::vector<ports::MidiMsg> got;
+  while (auto m = in.poll()) got.push_back(*m);
+  return got;
+}
+
+bool expect_msgs(const char* name, const std::vector<ports::MidiMsg>& got, std::initializer_list<Ev> want) {
+  std::size_t i = 0;
+  for (const auto& w : want) {
+    if (i >= got.size()) return check(false, name, "missing " + show(w.status, w.d1, w.d2));
+    const auto& m = got[i];
+    if (m.status != w.status || m.data1 != w.d1 || m.data2 != w.d2)
+      return check(false, name, "got " + show(m.status, m.data1, m.data2) + ", want " + show(w.status, w.d1, w.d2));
+    ++i;
+  }
+  return check(got.size() == i, name, "extra " + (i < got.size() ? show(got[i].status, got[i].data1, got[i].data2)
+                                                                 : std::string()));
+}
+
+void put(int fd, std::initializer_list<uint8_t> bytes) {
+  const std::vector<uint8_t> b(bytes);
+  if (::write(fd, b.data(), b.size()) != static_cast<ssize_t>(b.size())) std::abort();
+}
+
+struct Pipe {
+  int r = -1, w = -1;
+  Pipe() { int fd[2]; if (::pipe(fd) != 0) std::abort(); r = fd[0]; w = fd[1]; }
+};
+
+// Paczka przez koder i z powrotem: running status i NoteOff jako ON z velocity 0
+void round_trip() {
+  VirtualClock clock;
+  Pipe p;
+  RawMidiOut out(p.w);
+  RawMidiIn in(p.r, clock, InputMode::Poll);
+  const ports::MidiMsg batch[] = {
+    {0x90, 60, 100, 0}, {0x90, 64, 90, 0}, {0x80, 60, 0, 0},   // jeden status na trzy
+    {0xF8, 0, 0, 0},                                           // realtime nie kasuje statusu
+    {0x80, 64, 0, 0},
+    {0xB1, 7, 100, 0}, {0xC0, 5, 0, 0}, {0xE0, 0, 64, 0},
+    {0x80, 67, 40, 0},                                         // NoteOff z velocity zostaje NoteOff
+  };
+  out.send_batch(batch, std::size(batch));
+  expect_msgs("round trip", take(in), {
+    {0x90, 60, 100}, {0x90, 64, 90}, {0x90, 60, 0}, {0xF8, 0, 0}, {0x90, 64, 0},
+    {0xB1, 7, 100}, {0xC0, 5, 0}, {0xE0, 0, 64}, {0x80, 67, 40},
+  });
+  check(out.bytes_saved() == 3, "round trip", "bytes saved " + std::to_string(out.bytes_saved()));
+  check(out.dropped() == 0 && in.stray_bytes() == 0, "round trip", "dropped/stray");
+
+  // Bez running status i bez zamiany NoteOff: bajt w bajt to, co wysłano
+  Pipe q;
+  RawMidiOut plain(q.w, nullptr, core::MidiEncoder::Options{false, false});
+  RawMidiIn in2(q.r, clock, InputMode::Poll);
+  plain.send_batch(batch, std::size(batch));
+  std::vector<ports::MidiMsg> got = take(in2);
+  bool same = got.size() == std::size(batch);
+  for (std::size_t i = 0; same && i < got.size(); ++i)
+    same = got[i].status == batch[i].status && got[i].data1 == batch[i].data1 && got[i].data2 == batch[i].data2;
+  check(same, "round trip plain", "decoded messages differ from the batch");
+  check(plain.bytes_saved() == 0, "round trip plain", "bytes saved " + std::to_string(plain.bytes_saved()));
+}
+
+// Strumień z urządzenia kawałkami: start w połowie komunikatu, komunikat
+// rozcięty między read(), running status, realtime w SysEx, SysEx kasuje status
+void split_stream() {
+  VirtualClock clock;
+  Pipe p;
+  RawMidiIn in(p.r, clock, InputMode::Poll);
+
+  put(p.w, {0x3C, 0x40, 0x90, 0x3C});                  // 2 bajty bez statusu + pół NoteOn
+  expect_msgs("split: half message", take(in), {});
+  check(in.stray_bytes() == 2, "split: half message", "stray " + std::to_string(in.stray_bytes()));
+
+  put(p.w, {0x64, 0x40});                               // dokończenie + running status (pół)
+  expect_msgs("split: completed", take(in), {{0x90, 0x3C, 0x64}});
+  put(p.w, {0x50, 0xF0, 0x7E, 0x7F, 0xF8, 0x06});      // SysEx z zegarem w środku
+  expect_msgs("split: sysex", take(in), {{0x90, 0x40, 0x50}, {0xF8, 0, 0}});
+
+  put(p.w, {0x01, 0xFE, 0xF7, 0x3E, 0x20, 0x80, 0x3C, 0x00});
+  expect_msgs("split: after sysex", take(in), {{0xFE, 0, 0}, {0x80, 0x3C, 0x00}});
+  // treść SysEx to nie "zabłąkane" bajty; dane po F7 już tak (status skasowany)
+  check(in.stray_bytes() == 4, "split: after sysex", "stray " + std::to_string(in.stray_bytes()));
+}
+
+struct CountingWakeup final : ports::IWakeup {
+  std::atomic<int> n{0};
+  void wake() override { n.fetch_add(1); }
+};
+
+// Tryb Callback: wątek czytający budzi pętlę, kolejka oddaje komunikat
+void callback_wakes() {
+  VirtualClock clock;
+  Pipe p;
+  CountingWakeup wk;
+  RawMidiIn in(p.r, clock, InputMode::Callback);
+  check(in.set_wakeup(&wk), "callback", "set_wakeup refused");
+  put(p.w, {0x92, 0x30});
+  put(p.w, {0x7F});
+  const auto until = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (wk.n.load() == 0 && std::chrono::steady_clock::now() < until)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  check(wk.n.load() > 0, "callback", "no wakeup within 2 s");
+  expect_msgs("callback", take(in), {{0x92, 0x30, 0x7F}});
+}
+
+// Ścieżki: wyjście do nieistniejącego pliku tworzy go; zła ścieżka => wyjątek
+void paths() {
+  char dir[] = "/tmp/raw_midi_pipe.XXXXXX";
+  if (!::mkdtemp(dir)) { check(false, "paths", "mkdtemp failed"); return; }
+  const std::string file = std::string(dir) + "/out.mid.raw";
+  {
+    auto out = desktop_midi::makeRawOut(file);
+    out->send(ports::MidiMsg{0x90, 60, 100, 0});
+  }
+  std::ifstream f(file, std::ios::binary);
+  const std::vector<char> bytes((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+  check(bytes == std::vector<char>{char(0x90), char(60), char(100)}, "paths", "created file holds " +
+        std::to_string(bytes.size()) + " bytes");
+  ::unlink(file.c_str());
+
+  VirtualClock clock;
+  bool threw = false;
+  try { (void)desktop_midi::makeRawOut(std::string(dir) + "/no/such/dir"); } catch (const std::runtime_error&) { threw = true; }
+  check(threw, "paths", "makeRawOut on a missing directory did not throw");
+  threw = false;
+  try { (void)desktop_midi::makeRawIn(std::string(dir) + "/missing", clock); } catch (const std::runtime_error&) { threw = true; }
+  check(threw, "paths", "makeRawIn on a missing file did not throw");
+  ::rmdir(dir);
+}
+
+} // namespace
+
+int main() {
+  round_trip();
+  split_stream();
+  callback_wakes();
+  paths();
+  if (g_failed) { std::printf("%d check(s) failed\n", g_failed); return 1; }
+  std::printf("all raw MIDI checks passed\n");
+  return 0;
+}
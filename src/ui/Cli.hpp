@@ -1,46 +1,92 @@
 #pragma once
+#include <algorithm>
 #include <atomic>
-#include <deque>
+#include <chrono>
+#include <functional>
 #include <iostream>
-#include <mutex>
 #include <sstream>
 #include <string>
 #include <thread>
-#include "core/PatternEngine.hpp"  // do print_pattern & stałych
+#include <utility>
+#include "core/PatternEditor.hpp"  // szkice + publikacja; print_pattern & stałe
+#include "core/SpscRing.hpp"
+#include "ports/PatternStore.hpp"
+#include "ports/Wakeup.hpp"
 
 namespace ui {
 
-// Jednolity typ komendy dla CLI → głównego wątku
+// Jednolity typ komendy dla CLI → głównego wątku (help obsługuje sam wątek CLI)
 struct Command {
   enum class Type {
-    Help, Show, SetBpm,
-    SetPatDiv, SetPatLen,
+    Show, SetBpm,
+    SetPatDiv, SetPatLen, SetPatSeed,
     SetStepIdx, SetStepVel, SetStepGate, SetStepOct, SetStepProb,
     ToggleStep,
+    SetLogLevel,
+    Stats,
+    Panic,
     Quit
-  } type{Type::Help};
+  } type{Type::Show};
 
   // Proste pola parametryczne – używamy w switchu
   int a{0}, b{0}, c{0};
 };
 
-// Minimalna, bezpieczna kolejka (CLI → main). Nie jest w hot-path.
+// Odpowiedź pętli silnika na komendę – same dane. Formatuje i wypisuje wątek
+// CLI: pętla silnika (przy --rt wątek SCHED_FIFO) nie pisze na terminal.
+struct Reply {
+  Command::Type type{Command::Type::Show};
+  int      a{0};                // log: poziom; stats: jak Command::a
+  double   bpm{0};
+  bool     external_clock{false};
+  uint64_t log_dropped{0};
+};
+
+// Na te komendy pętla silnika odpowiada (CLI czeka na odpowiedź przed następną linią)
+inline bool has_reply(Command::Type t) {
+  using T = Command::Type;
+  return t == T::SetBpm || t == T::SetLogLevel || t == T::Stats || t == T::Panic;
+}
+
+// Kolejka CLI → pętla silnika: jeden producent (wątek CLI), jeden konsument.
+// Pętla silnika ani nie blokuje, ani nie alokuje przy drain() i reply().
+// Odpowiedzi idą drugim pierścieniem SPSC w stronę wątku CLI.
 class CommandQueue {
 public:
-  void push(const Command& cmd) {
-    std::lock_guard<std::mutex> lg(mu_);
-    q_.push_back(cmd);
+  static constexpr std::size_t CAPACITY = 64;
+  static constexpr std::size_t REPLIES  = 8;
+
+  // Budzik pętli głównej (opcjonalny) – komenda nie czeka na kolejny termin silnika
+  void set_wakeup(ports::IWakeup* w) { wakeup_ = w; }
+
+  // false => kolejka pełna, komenda odrzucona (człowiek przy klawiaturze nie zapcha 64 slotów)
+  bool push(const Command& cmd) {
+    const bool ok = q_.try_push(cmd);
+    wake();
+    return ok;
   }
-  // Zbierz wszystko, co jest, bez blokowania
-  std::deque<Command> drain() {
-    std::lock_guard<std::mutex> lg(mu_);
-    std::deque<Command> out;
-    out.swap(q_);
-    return out;
+  void wake() { if (wakeup_) wakeup_->wake(); }
+
+  // Obsłuż wszystko, co jest, bez blokowania
+  template<class F>
+  std::size_t drain(F&& fn) { return q_.drain(std::forward<F>(fn)); }
+
+  // Pętla silnika: odpowiedź na komendę (CLI czeka na każdą, więc miejsce jest)
+  bool reply(const Reply& r) { return replies_.try_push(r); }
+
+  // Wątek CLI: czekaj na odpowiedź; false => program się kończy
+  bool await_reply(const std::atomic<bool>& running, Reply& out) {
+    for (;;) {
+      if (auto r = replies_.try_pop()) { out = *r; return true; }
+      if (!running.load()) return false;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
   }
+
 private:
-  std::mutex mu_;
-  std::deque<Command> q_;
+  core::SpscRing<Command, CAPACITY> q_;
+  core::SpscRing<Reply, REPLIES>    replies_;
+  ports::IWakeup* wakeup_{nullptr};
 };
 
 // Pomoc: wypisz help
@@ -48,17 +94,25 @@ inline void print_help() {
   std::cout <<
     "Commands:\n"
     "  help                        - show this help\n"
-    "  show [pat]                  - show pattern (0..3), or all if omitted\n"
+    "  show [pat]                  - show pattern (0..N-1), or all if omitted\n"
     "  bpm <value>                 - set global BPM\n"
     "  div <pat> <division>        - set pattern division (1=1/4,2=1/8,4=1/16,...)\n"
     "  len <pat> <length>          - set pattern length (0.." << core::MAX_STEPS << ")\n"
-    "  idx <pat> <step> <0..8>     - set step's note index (0=REST)\n"
+    "  seed <pat> <n>              - set pattern's random seed (probability steps)\n"
+    "  idx <pat> <step> <0..128>   - set step's note index (0=REST)\n"
     "  vel <pat> <step> <1..127>   - set velocity\n"
     "  gate <pat> <step> <1..200>  - set gate percent\n"
     "  oct <pat> <step> <-8..+8>   - set octave transpose\n"
     "  prob <pat> <step> <0..100>  - set probability\n"
     "  on <pat> <step>             - enable step\n"
     "  off <pat> <step>            - disable step\n"
+    "  quant <now|step|bar>        - when pattern edits take effect (default now)\n"
+    "  load <bank> <slot> [pat]    - load pattern from a bank file at the next bar\n"
+    "                                (reloads when the file changes)\n"
+    "  save <bank> <slot> [pat]    - save pattern to a bank file slot\n"
+    "  log <0..2>                  - output log: 0=off, 1=notes, 2=all\n"
+    "  stats [json|reset]          - timing stats (lateness histograms, late steps)\n"
+    "  panic                       - note off for every sounding note (all channels)\n"
     "  quit                        - exit\n";
 }
 
@@ -67,7 +121,8 @@ inline void print_pattern(const core::PatternConfig& p, int idx) {
   std::cout << "Pattern " << idx
             << " | ch=" << (int)p.channel
             << " div=" << p.division
-            << " len=" << p.length << "\n";
+            << " len=" << p.length
+            << " seed=" << p.seed << "\n";
   for (std::size_t i = 0; i < p.length; ++i) {
     const auto& s = p.steps[i];
     std::cout << "  [" << i << "] "
@@ -81,22 +136,88 @@ inline void print_pattern(const core::PatternConfig& p, int idx) {
   }
 }
 
-// Wątek CLI – czyta stdin, zamienia na Command i wkłada do kolejki
-inline std::thread start_cli(std::atomic<bool>& running, CommandQueue& cq) {
-  return std::thread([&running, &cq](){
+// Show i edycje patternów – w wątku CLI, na szkicach edytora; edycja => publikacja.
+// false => komenda nie dotyczy patternów (idzie kolejką do pętli silnika).
+inline bool apply_edit(core::PatternEditor& ed, const Command& c, core::Quantize when) {
+  using T = Command::Type;
+  const int n = static_cast<int>(ed.size());
+  const int pat = c.a, st = c.b, v = c.c;
+  if (c.type == T::Show) {
+    const auto guard = ed.lock();
+    if (pat >= 0 && pat < n) print_pattern(ed.draft((std::size_t)pat), pat);
+    else for (int i = 0; i < n; ++i) print_pattern(ed.draft((std::size_t)i), i);
+    return true;
+  }
+  switch (c.type) {
+    case T::SetPatDiv: case T::SetPatLen: case T::SetPatSeed:
+    case T::SetStepIdx: case T::SetStepVel: case T::SetStepGate: case T::SetStepOct:
+    case T::SetStepProb: case T::ToggleStep:
+      break;
+    default:
+      return false;
+  }
+  if (pat < 0 || pat >= n) return true;
+
+  const auto guard = ed.lock();
+  auto& p = ed.draft((std::size_t)pat);
+  const bool step_ok = st >= 0 && st < (int)p.length;
+  auto& s = p.steps[step_ok ? (std::size_t)st : 0];
+  switch (c.type) {
+    case T::SetPatDiv:
+      if (c.b <= 0) return true;
+      p.division = (uint16_t)c.b;
+      std::cout << "pat " << pat << " division = " << c.b << "\n";
+      break;
+    case T::SetPatLen:
+      p.length = (std::size_t)std::clamp(c.b, 0, (int)core::MAX_STEPS);
+      std::cout << "pat " << pat << " length = " << p.length << "\n";
+      break;
+    case T::SetPatSeed:
+      p.seed = (uint32_t)c.b;
+      std::cout << "pat " << pat << " seed = " << p.seed << "\n";
+      break;
+    case T::SetStepIdx:  if (!step_ok) return true; s.note_index  = (uint8_t)std::clamp(v, 0, (int)core::MAX_CHORD_NOTES);     break;
+    case T::SetStepVel:  if (!step_ok) return true; s.velocity    = (uint8_t)std::clamp(v, 1, 127);   break;
+    case T::SetStepGate: if (!step_ok) return true; s.gate_pct    = (uint8_t)std::clamp(v, 1, 200);   break;
+    case T::SetStepOct:  if (!step_ok) return true; s.octave      = (int8_t)std::clamp(v, -8, 8);     break;
+    case T::SetStepProb: if (!step_ok) return true; s.probability = (uint8_t)std::clamp(v, 0, 100);   break;
+    case T::ToggleStep:  if (!step_ok) return true; s.enabled     = (v != 0);                        break;
+    default: break;
+  }
+  ed.publish((std::size_t)pat, when);
+  return true;
+}
+
+// Źródło linii CLI: false => koniec (EOF albo przerwanie). Domyślnie std::cin;
+// na PC przerywalne (desktop/StdinLines), żeby wyjście nie czekało na Enter.
+using ReadLine = std::function<bool(std::string&)>;
+inline bool read_cin_line(std::string& line) { return static_cast<bool>(std::getline(std::cin, line)); }
+
+// Wypisanie odpowiedzi pętli silnika (w wątku CLI)
+using OnReply = std::function<void(const Reply&)>;
+
+// Wątek CLI – czyta linie z 'read_line'; help i edycje patternów obsługuje sam
+// (PatternEditor), banki przez 'store' (jeśli jest), resztę zamienia na Command
+// i wkłada do kolejki pętli silnika; jej odpowiedź wypisuje 'on_reply'
+inline std::thread start_cli(std::atomic<bool>& running, CommandQueue& cq, core::PatternEditor& ed,
+                             ports::IPatternStore* store, OnReply on_reply, ReadLine read_line = read_cin_line) {
+  return std::thread([&running, &cq, &ed, store, on_reply = std::move(on_reply),
+                      read_line = std::move(read_line)](){
+    auto when = core::Quantize::Now;
     print_help();
     std::string line;
-    while (running.load() && std::getline(std::cin, line)) {
+    while (running.load() && read_line(line)) {
       std::istringstream iss(line);
       std::string cmd; iss >> cmd;
       if (cmd.empty()) continue;
 
       Command c;
-      if      (cmd == "help") { c.type = Command::Type::Help; }
+      if      (cmd == "help") { print_help(); continue; }
       else if (cmd == "show") { c.type = Command::Type::Show; if (!(iss >> c.a)) c.a = -1; }
       else if (cmd == "bpm")  { c.type = Command::Type::SetBpm; iss >> c.a; }
       else if (cmd == "div")  { c.type = Command::Type::SetPatDiv; iss >> c.a >> c.b; }
       else if (cmd == "len")  { c.type = Command::Type::SetPatLen; iss >> c.a >> c.b; }
+      else if (cmd == "seed") { c.type = Command::Type::SetPatSeed; iss >> c.a >> c.b; }
       else if (cmd == "idx")  { c.type = Command::Type::SetStepIdx; iss >> c.a >> c.b >> c.c; }
       else if (cmd == "vel")  { c.type = Command::Type::SetStepVel; iss >> c.a >> c.b >> c.c; }
       else if (cmd == "gate") { c.type = Command::Type::SetStepGate; iss >> c.a >> c.b >> c.c; }
@@ -104,15 +225,48 @@ inline std::thread start_cli(std::atomic<bool>& running, CommandQueue& cq) {
       else if (cmd == "prob") { c.type = Command::Type::SetStepProb; iss >> c.a >> c.b >> c.c; }
       else if (cmd == "on")   { c.type = Command::Type::ToggleStep; iss >> c.a >> c.b; c.c = 1; }
       else if (cmd == "off")  { c.type = Command::Type::ToggleStep; iss >> c.a >> c.b; c.c = 0; }
+      else if (cmd == "quant") {
+        std::string q; iss >> q;
+        if      (q == "now")  when = core::Quantize::Now;
+        else if (q == "step") when = core::Quantize::Step;
+        else if (q == "bar")  when = core::Quantize::Bar;
+        else { std::cout << "quant: now | step | bar\n"; continue; }
+        std::cout << "edits take effect: " << q << "\n";
+        continue;
+      }
+      else if (cmd == "load" || cmd == "save") {
+        std::string bank;
+        std::size_t slot = 0, pat = 0;
+        if (!(iss >> bank >> slot)) { std::cout << cmd << " <bank> <slot> [pat]\n"; continue; }
+        iss >> pat;
+        if (!store) { std::cout << "pattern banks not available\n"; continue; }
+        std::string msg;
+        const bool ok = (cmd == "load") ? store->load(bank, slot, pat, msg) : store->save(bank, slot, pat, msg);
+        std::cout << (ok ? "" : cmd + " failed: ") << msg << "\n";
+        continue;
+      }
+      else if (cmd == "log")  { c.type = Command::Type::SetLogLevel; if (!(iss >> c.a)) c.a = -1; }
+      else if (cmd == "stats") {
+        std::string sub; iss >> sub;
+        c.type = Command::Type::Stats;
+        c.a = (sub == "json") ? 1 : (sub == "reset") ? 2 : 0;
+      }
+      else if (cmd == "panic") { c.type = Command::Type::Panic; }
       else if (cmd == "quit" || cmd == "exit") {
-        c.type = Command::Type::Quit; cq.push(c); break;
+        c.type = Command::Type::Quit;
+        while (!cq.push(c)) std::this_thread::yield(); // quit nie może przepaść
+        break;
       } else {
         std::cout << "Unknown. Type 'help'.\n";
         continue;
       }
-      cq.push(c);
+      if (apply_edit(ed, c, when)) continue;
+      if (!cq.push(c)) { std::cout << "Busy – command dropped.\n"; continue; }
+      Reply r;
+      if (has_reply(c.type) && cq.await_reply(running, r) && on_reply) on_reply(r);
     }
     running.store(false);
+    cq.wake();
   });
 }
 
@@ -0,0 +1,120 @@
+#pragma once
+#include <cstdio>
+#include "core/Stats.hpp"
+
+namespace ui {
+
+/*
+ * Prezentacja statystyk czasu: tabela dla człowieka (komenda 'stats')
+ * i JSON dla maszyn ('stats json', --stats-out). Wszystko w µs.
+ */
+
+inline void print_hist_row_(std::FILE* f, const char* name, const core::LatencyHistogram& h) {
+  std::fprintf(f, "  %-11s %10llu %8llu %9.1f %7llu %7llu %8llu %9llu\n", name,
+               (unsigned long long)h.count(), (unsigned long long)h.early(), h.mean(),
+               (unsigned long long)h.percentile(0.50), (unsigned long long)h.percentile(0.99),
+               (unsigned long long)h.percentile(0.999), (unsigned long long)h.max());
+}
+
+inline void print_stats(const core::EngineStats& es, const core::OutputStats& os, std::FILE* f = stdout) {
+  std::fprintf(f, "Timing (late = sent - scheduled, us; percentiles rounded up to bucket)\n");
+  std::fprintf(f, "  %-11s %10s %8s %9s %7s %7s %8s %9s\n",
+               "", "count", "early", "mean", "p50", "p99", "p99.9", "max");
+  print_hist_row_(f, "engine on",  es.on_late);
+  print_hist_row_(f, "engine off", es.off_late);
+  print_hist_row_(f, "output on",  os.on_late);
+  print_hist_row_(f, "output off", os.off_late);
+  std::fprintf(f, "  late steps (caught up): %llu   off-queue overflows: %llu\n",
+               (unsigned long long)es.late_steps, (unsigned long long)es.off_overflows);
+  for (std::size_t i = 0; i < es.patterns.size(); ++i) {
+    const auto& p = es.patterns[i];
+    if (p.on_late.count() == 0 && p.off_late.count() == 0 && p.late_steps == 0) continue;
+    std::fprintf(f, "  pat %-3zu on n=%llu p99=%llu max=%llu | off n=%llu p99=%llu max=%llu | late steps=%llu\n", i,
+                 (unsigned long long)p.on_late.count(), (unsigned long long)p.on_late.percentile(0.99),
+                 (unsigned long long)p.on_late.max(),
+                 (unsigned long long)p.off_late.count(), (unsigned long long)p.off_late.percentile(0.99),
+                 (unsigned long long)p.off_late.max(), (unsigned long long)p.late_steps);
+  }
+}
+
+// Punktualność wybudzeń pętli (tryb --rt): faktyczne wybudzenie - termin
+inline void print_wakeup(std::FILE* f, const char* name, const core::LatencyHistogram& h, uint32_t spin_us) {
+  std::fprintf(f, "Wake-up %s (us; hybrid sleep/spin, spin margin %u us)\n", name, static_cast<unsigned>(spin_us));
+  print_hist_row_(f, "wake-up", h);
+}
+
+inline void print_hist_json_(std::FILE* f, const core::LatencyHistogram& h) {
+  std::fprintf(f, "{\"count\": %llu, \"early\": %llu, \"mean_us\": %.2f, \"p50_us\": %llu, "
+                  "\"p99_us\": %llu, \"p999_us\": %llu, \"max_us\": %llu, \"buckets\": [",
+               (unsigned long long)h.count(), (unsigned long long)h.early(), h.mean(),
+               (unsigned long long)h.percentile(0.50), (unsigned long long)h.percentile(0.99),
+               (unsigned long long)h.percentile(0.999), (unsigned long long)h.max());
+  for (std::size_t b = 0; b < core::LatencyHistogram::BUCKETS; ++b)
+    std::fprintf(f, "%s%llu", b ? ", " : "", (unsigned long long)h.bucket(b));
+  std::fprintf(f, "]}");
+}
+
+inline void print_stats_json(const core::EngineStats& es, const core::OutputStats& os, std::FILE* f = stdout,
+                             const core::LatencyHistogram* wakeup = nullptr) {
+  std::fprintf(f, "{\n  \"bucket_limits_us\": [");
+  for (std::size_t b = 0; b < core::LatencyHistogram::BUCKETS; ++b)
+    std::fprintf(f, "%s%llu", b ? ", " : "", (unsigned long long)core::LatencyHistogram::bucket_limit(b));
+  std::fprintf(f, "],\n  \"engine\": {\n    \"on\": ");
+  print_hist_json_(f, es.on_late);
+  std::fprintf(f, ",\n    \"off\": ");
+  print_hist_json_(f, es.off_late);
+  std::fprintf(f, ",\n    \"late_steps\": %llu, \"off_overflows\": %llu\n  },\n  \"output\": {\n    \"on\": ",
+               (unsigned long long)es.late_steps, (unsigned long long)es.off_overflows);
+  print_hist_json_(f, os.on_late);
+  std::fprintf(f, ",\n    \"off\": ");
+  print_hist_json_(f, os.off_late);
+  std::fprintf(f, ",\n    \"other\": %llu\n  },", (unsigned long long)os.other.load());
+  if (wakeup) {
+    std::fprintf(f, "\n  \"wakeup\": ");
+    print_hist_json_(f, *wakeup);
+    std::fprintf(f, ",");
+  }
+  std::fprintf(f, "\n  \"patterns\": [");
+  for (std::size_t i = 0; i < es.patterns.size(); ++i) {
+    const auto& p = es.patterns[i];
+    std::fprintf(f, "%s\n    {\"id\": %zu, \"late_steps\": %llu, \"on\": ", i ? "," : "", i,
+                 (unsigned long long)p.late_steps);
+    print_hist_json_(f, p.on_late);
+    std::fprintf(f, ", \"off\": ");
+    print_hist_json_(f, p.off_late);
+    std::fprintf(f, "}");
+  }
+  std::fprintf(f, "\n  ]\n}\n");
+}
+
+/*
+ * StatsSnapshot – kopia statystyk zrobiona przez pętlę silnika na komendę 'stats'.
+ * Pętla tylko kopiuje (bufory mają stały rozmiar – bez alokacji) i odpowiada
+ * przez CommandQueue; formatuje i wypisuje wątek CLI. Następną kopię pętla
+ * robi dopiero na następną komendę, a CLI czeka na odpowiedź przed kolejną –
+ * kopia nie zmienia się w trakcie wypisywania.
+ */
+struct StatsSnapshot {
+  enum Wake : std::size_t { ENGINE_LOOP = 0, SENDER = 1 };
+
+  core::EngineStats      engine;
+  core::OutputStats      output;
+  core::LatencyHistogram wakeup[2];      // punktualność wybudzeń (tryb --rt)
+  uint32_t               spin_us[2]{};
+  bool                   has_wakeup[2]{};
+  int                    json_wakeup{-1}; // który trafia do JSON (-1 => żaden)
+};
+
+inline void print_stats(const StatsSnapshot& s, bool json, std::FILE* f = stdout) {
+  if (json) {
+    print_stats_json(s.engine, s.output, f, s.json_wakeup >= 0 ? &s.wakeup[s.json_wakeup] : nullptr);
+    return;
+  }
+  print_stats(s.engine, s.output, f);
+  if (s.has_wakeup[StatsSnapshot::ENGINE_LOOP])
+    print_wakeup(f, "engine loop", s.wakeup[StatsSnapshot::ENGINE_LOOP], s.spin_us[StatsSnapshot::ENGINE_LOOP]);
+  if (s.has_wakeup[StatsSnapshot::SENDER])
+    print_wakeup(f, "sender", s.wakeup[StatsSnapshot::SENDER], s.spin_us[StatsSnapshot::SENDER]);
+}
+
+} // namespace ui